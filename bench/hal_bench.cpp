@@ -0,0 +1,938 @@
+/*
+ * Benchmarks for the HAL hot paths.
+ *
+ * Runs against SimRegmap. CPU-side metrics use a zero-latency bus so they
+ * reflect CPU cost only; bus-side metrics use a simulated 1 MHz I2C
+ * bus. One "<name> <value> <unit>" line per metric is written to
+ * bench_output.txt (or the path given as the first argument).
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/coeff_convert.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/control_table.h"
+#include "cirrus/hal/device.h"
+#include "cirrus/hal/file_util.h"
+#include "cirrus/hal/firmware_manager.h"
+#include "cirrus/hal/gain_ramp.h"
+#include "cirrus/hal/hal_core.h"
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/haptics.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/lz4_stream.h"
+#include "cirrus/hal/mailbox.h"
+#include "cirrus/hal/param_channel.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "cirrus/hal/spsc_ring.h"
+#include "cirrus/hal/symbol_table.h"
+#include "cirrus/hal/trace.h"
+#include "cirrus/hal/tuning_cache.h"
+#include "cirrus/hal/tuning_prewarm.h"
+#include "cirrus/hal/use_case.h"
+#include "cirrus/hal/wavetable.h"
+#include "cirrus/hal/wmfw.h"
+
+using namespace cirrus::hal;
+
+namespace {
+
+constexpr uint32_t kXm = 0x2800000;
+
+/* 1 MHz I2C: ~9 us per byte plus start, address and stop. */
+constexpr SimBusConfig kI2c1Mhz = {50000, 9000, 4096, false};
+
+const std::vector<DspRegion> kHaloRegions(std::begin(parts::kHaloRegions),
+                                           std::end(parts::kHaloRegions));
+
+class Report {
+public:
+    explicit Report(const char *path) : mFile(fopen(path, "w")) {}
+    ~Report()
+    {
+        if (mFile)
+            fclose(mFile);
+    }
+
+    bool ok() const { return mFile != nullptr; }
+
+    void add(const char *name, double value, const char *unit)
+    {
+        fprintf(mFile, "%s %.3f %s\n", name, value, unit);
+        printf("%-36s %12.3f %s\n", name, value, unit);
+    }
+
+private:
+    FILE *mFile;
+};
+
+double elapsedNs(uint64_t start)
+{
+    return static_cast<double>(traceNow() - start);
+}
+
+/* A Halo firmware of @regions packed-XM regions, @bytes each, back to back. */
+std::vector<uint8_t> makeWmfw(size_t regions, size_t bytes)
+{
+    std::vector<uint8_t> f(40, 0);
+
+    memcpy(f.data(), "WMFW", 4);
+    writeLe32(&f[4], 40);
+    f[10] = wmfw::kCoreHalo;
+    f[11] = 3;
+
+    for (size_t i = 0; i < regions; i++) {
+        size_t pos = f.size();
+
+        f.resize(pos + 8 + bytes, static_cast<uint8_t>(i));
+        /* bytes/3 words per region keeps the regions contiguous in packed XM */
+        writeLe32(&f[pos], static_cast<uint32_t>(i * bytes / 3));
+        f[pos + 3] = wmfw::kHaloXmPacked;
+        writeLe32(&f[pos + 4], bytes);
+    }
+
+    return f;
+}
+
+/* Append a version 2+ descriptor string with a @bytes length prefix. */
+void appendString(std::vector<uint8_t> &f, size_t bytes, const std::string &str)
+{
+    size_t pos = f.size();
+
+    f.resize(pos + ((bytes + str.size() + 3) & ~size_t(3)), 0);
+    if (bytes == 1)
+        f[pos] = static_cast<uint8_t>(str.size());
+    else
+        writeLe16(&f[pos], static_cast<uint16_t>(str.size()));
+    memcpy(&f[pos + bytes], str.data(), str.size());
+}
+
+/* A Halo firmware whose only region describes @coeffs XM controls of @algId. */
+std::vector<uint8_t> makeSymbolWmfw(uint32_t algId, size_t coeffs)
+{
+    std::vector<uint8_t> f = makeWmfw(0, 0);
+    std::vector<uint8_t> alg(4);
+    size_t pos;
+
+    writeLe32(&alg[0], algId);
+    appendString(alg, 1, "bench");
+    appendString(alg, 2, "");
+    alg.resize(alg.size() + 4);
+    writeLe32(&alg[alg.size() - 4], static_cast<uint32_t>(coeffs));
+
+    for (size_t i = 0; i < coeffs; i++) {
+        pos = alg.size();
+        alg.resize(pos + 8);
+        writeLe16(&alg[pos], static_cast<uint16_t>(i));
+        writeLe16(&alg[pos + 2], wmfw::kAdsp2Xm);
+        appendString(alg, 1, "CTRL_" + std::to_string(i));
+        appendString(alg, 1, "");
+        appendString(alg, 2, "");
+        alg.resize(alg.size() + 8);
+        writeLe16(&alg[alg.size() - 6], wmfw::kCtlReadable | wmfw::kCtlWriteable);
+        writeLe32(&alg[alg.size() - 4], 4);
+        writeLe32(&alg[pos + 4], static_cast<uint32_t>(alg.size() - pos - 8));
+    }
+
+    pos = f.size();
+    f.resize(pos + 8);
+    f[pos + 3] = static_cast<uint8_t>(wmfw::kAlgorithmData);
+    writeLe32(&f[pos + 4], static_cast<uint32_t>(alg.size()));
+    f.insert(f.end(), alg.begin(), alg.end());
+
+    return f;
+}
+
+/* A tuning of @blocks absolute-address blocks, @bytes each. */
+std::vector<uint8_t> makeBin(size_t blocks, size_t bytes)
+{
+    std::vector<uint8_t> f(12, 0);
+
+    memcpy(f.data(), "WMDR", 4);
+    writeLe32(&f[4], 12);
+    f[11] = 2;
+
+    for (size_t i = 0; i < blocks; i++) {
+        size_t pos = f.size();
+
+        f.resize(pos + 20 + bytes, static_cast<uint8_t>(i));
+        writeLe16(&f[pos], static_cast<uint16_t>(i * bytes));
+        writeLe16(&f[pos + 2], wmfw::kAbsolute << 8);
+        writeLe32(&f[pos + 16], bytes);
+    }
+
+    return f;
+}
+
+/* Greedy LZ4 block encoder, enough to produce frames for the bench. */
+void lz4CompressBlock(const uint8_t *in, size_t len, std::vector<uint8_t> &out)
+{
+    constexpr size_t kHashBits = 12;
+    std::vector<uint32_t> table(size_t(1) << kHashBits, UINT32_MAX);
+    size_t anchor = 0, pos = 0;
+
+    auto putLength = [&out](size_t n) {
+        for (; n >= 255; n -= 255)
+            out.push_back(255);
+        out.push_back(static_cast<uint8_t>(n));
+    };
+    auto emit = [&](size_t lit, size_t match, size_t offset) {
+        uint8_t token = static_cast<uint8_t>(std::min<size_t>(lit, 15) << 4);
+
+        if (match)
+            token |= static_cast<uint8_t>(std::min<size_t>(match - 4, 15));
+        out.push_back(token);
+        if (lit >= 15)
+            putLength(lit - 15);
+        out.insert(out.end(), in + anchor, in + anchor + lit);
+        if (!match)
+            return;
+        out.push_back(offset & 0xff);
+        out.push_back(offset >> 8);
+        if (match - 4 >= 15)
+            putLength(match - 4 - 15);
+    };
+
+    /* The format wants the last match to start 12 bytes from the end. */
+    while (len >= 13 && pos + 12 <= len) {
+        uint32_t word;
+
+        memcpy(&word, in + pos, 4);
+        uint32_t slot = (word * 2654435761u) >> (32 - kHashBits);
+        uint32_t cand = table[slot];
+        table[slot] = static_cast<uint32_t>(pos);
+
+        if (cand == UINT32_MAX || pos - cand > 65535 || memcmp(in + cand, in + pos, 4)) {
+            pos++;
+            continue;
+        }
+
+        size_t match = 4;
+        while (pos + match + 5 < len && in[cand + match] == in[pos + match])
+            match++;
+        emit(pos - anchor, match, pos - cand);
+        pos += match;
+        anchor = pos;
+    }
+
+    emit(len - anchor, 0, 0);
+}
+
+/* An LZ4 frame of independent 64 KiB blocks without checksums. */
+std::vector<uint8_t> lz4Frame(const std::vector<uint8_t> &data)
+{
+    constexpr size_t kBlock = 64 * 1024;
+    std::vector<uint8_t> f = {0x04, 0x22, 0x4d, 0x18, 0x60, 0x40};
+
+    f.push_back((xxh32({&f[4], 2}) >> 8) & 0xff);
+
+    for (size_t pos = 0; pos < data.size(); pos += kBlock) {
+        size_t len = std::min(kBlock, data.size() - pos), at = f.size();
+
+        f.resize(at + 4);
+        lz4CompressBlock(data.data() + pos, len, f);
+        writeLe32(&f[at], static_cast<uint32_t>(f.size() - at - 4));
+    }
+
+    f.resize(f.size() + 4, 0);
+    return f;
+}
+
+void benchFirmware(Report &report)
+{
+    constexpr int kIterations = 200;
+    std::vector<uint8_t> image = makeWmfw(256, 1536);
+    ByteView view = {image.data(), image.size()};
+    SimRegmap regmap;
+    Dsp dsp(regmap, wmfw::kCoreHalo, kHaloRegions, "bench");
+    WmfwFile wmfw;
+    uint64_t start;
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        wmfw.parse(view);
+    double parseNs = elapsedNs(start) / kIterations;
+
+    report.add("wmfw_parse_time", parseNs / 1000.0, "us");
+    report.add("wmfw_parse_throughput", image.size() / parseNs * 1000.0, "MB/s");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        dsp.invalidateCache();
+        dsp.loadFirmware(wmfw);
+    }
+    double loadNs = elapsedNs(start) / kIterations;
+
+    report.add("firmware_download_time", loadNs / 1000.0, "us");
+    report.add("firmware_download_throughput", image.size() / loadNs * 1000.0, "MB/s");
+    report.add("firmware_download_transactions",
+               static_cast<double>(regmap.transactions()) / kIterations, "count");
+
+    regmap.setConfig(kI2c1Mhz);
+    regmap.resetStats();
+    dsp.invalidateCache();
+    dsp.loadFirmware(wmfw);
+    report.add("firmware_download_i2c_bus_time", regmap.busNs() / 1e6, "ms");
+    regmap.setConfig({});
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        dsp.loadFirmware(wmfw);
+    report.add("firmware_resident_check_time", elapsedNs(start) / kIterations / 1000.0, "us");
+}
+
+void benchCoefficients(Report &report)
+{
+    constexpr int kIterations = 500;
+    std::vector<uint8_t> image = makeBin(128, 64);
+    SimRegmap regmap;
+    Dsp dsp(regmap, wmfw::kCoreHalo, kHaloRegions, "bench");
+    BinFile bin;
+    uint64_t start;
+
+    bin.parse({image.data(), image.size()});
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        dsp.invalidateCache();
+        dsp.loadCoefficients(bin);
+    }
+    report.add("coefficient_download_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        dsp.loadCoefficients(bin);
+    report.add("coefficient_unchanged_time", elapsedNs(start) / kIterations / 1000.0, "us");
+}
+
+void benchCoeffConvert(Report &report)
+{
+    constexpr size_t kWords = 65536;
+    constexpr int kIterations = 200;
+    std::vector<float> floats(kWords);
+    std::vector<int32_t> ints(kWords);
+    std::vector<uint8_t> out(kWords * 4);
+    uint64_t start;
+
+    for (size_t i = 0; i < kWords; i++) {
+        floats[i] = static_cast<float>(i % 2001) / 1000.0f - 1.0f;
+        ints[i] = static_cast<int32_t>(i * 2654435761u);
+    }
+
+    printf("coefficient conversion: %s\n", coeffConvertImpl());
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        floatToDsp(floats.data(), kWords, 23, out.data());
+    report.add("coeff_float_to_dsp_throughput",
+               kWords * kIterations / elapsedNs(start) * 1000.0, "Mwords/s");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        intToDsp(ints.data(), kWords, out.data());
+    report.add("coeff_int_to_dsp_throughput",
+               kWords * kIterations / elapsedNs(start) * 1000.0, "Mwords/s");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        packDsp24(ints.data(), kWords, out.data());
+    report.add("coeff_pack24_throughput", kWords * kIterations / elapsedNs(start) * 1000.0,
+               "Mwords/s");
+}
+
+void benchControlLookup(Report &report)
+{
+    constexpr int kControls = 600;
+    constexpr int kRounds = 2000;
+    std::vector<std::string> names;
+    ControlTable table;
+    uint64_t start;
+    uint32_t sum = 0;
+
+    for (int i = 0; i < kControls; i++) {
+        names.push_back("DSP1 Protection cd CTRL_" + std::to_string(i));
+        table.insert(names.back(), 0, {static_cast<uint32_t>(i + 1), 1, 1, 0});
+    }
+
+    start = traceNow();
+    for (int r = 0; r < kRounds; r++)
+        for (const std::string &name : names)
+            sum += table.find(name)->numid;
+
+    report.add("control_lookup_time", elapsedNs(start) / (kRounds * kControls), "ns");
+    if (!sum)
+        printf("unexpected lookup result\n");
+}
+
+void benchSymbolLookup(Report &report)
+{
+    constexpr uint32_t kAlgId = 0xcd;
+    constexpr int kControls = 600;
+    constexpr int kRounds = 2000;
+    std::vector<uint8_t> image = makeSymbolWmfw(kAlgId, kControls);
+    std::vector<std::string> names;
+    SymbolTable symbols;
+    WmfwFile wmfw;
+    uint64_t start;
+    uint32_t sum = 0;
+
+    wmfw.parse({image.data(), image.size()});
+
+    start = traceNow();
+    for (int r = 0; r < 100; r++)
+        symbols.parse(wmfw);
+    report.add("symbol_index_build_time", elapsedNs(start) / 100 / 1000.0, "us");
+
+    for (int i = 0; i < kControls; i++)
+        names.push_back("CTRL_" + std::to_string(i));
+
+    start = traceNow();
+    for (int r = 0; r < kRounds; r++)
+        for (const std::string &name : names)
+            sum += symbols.find(kAlgId, name)->len;
+
+    report.add("symbol_lookup_time", elapsedNs(start) / (kRounds * kControls), "ns");
+    if (sum != 4u * kRounds * kControls)
+        printf("unexpected symbol lookup result\n");
+}
+
+void benchParamRing(Report &report)
+{
+    constexpr size_t kItems = 4000000;
+    SpscRing<ParamUpdate, ParamChannel::kRingSize> ring;
+    ParamUpdate update = {};
+    uint64_t start;
+
+    start = traceNow();
+    std::thread consumer([&ring] {
+        ParamUpdate item;
+        size_t got = 0;
+
+        while (got < kItems) {
+            if (ring.pop(&item))
+                got++;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    for (size_t i = 0; i < kItems; i++) {
+        update.value = i;
+        while (!ring.push(update))
+            std::this_thread::yield();
+    }
+    consumer.join();
+
+    report.add("param_ring_throughput", kItems / elapsedNs(start) * 1000.0, "Mitems/s");
+}
+
+void benchHaptics(Report &report)
+{
+    constexpr int kEffects = 256;
+    constexpr int kIterations = 20000;
+    char path[] = "/tmp/cirrus-bench-XXXXXX";
+    WavetableWriter writer;
+    SimRegmap regmap;
+    Haptics haptics(regmap, {kXm, 4096 * 4, 0x13020, 1});
+    uint64_t start;
+    int fd;
+
+    for (int i = 0; i < kEffects; i++)
+        writer.add(WaveEffect::kPwle, std::vector<int32_t>(64 + i, i), 20);
+
+    fd = mkstemp(path);
+    if (fd < 0 || writer.write(path) < 0 || haptics.loadWavetable(path) < 0) {
+        printf("failed to create bench wavetable\n");
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    close(fd);
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        haptics.perform(i % kEffects);
+    report.add("haptic_trigger_upload_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        haptics.perform(7);
+    report.add("haptic_trigger_cached_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    /* An eight-section composition, replayed from the compiled program. */
+    HapticComposition composition;
+    for (uint8_t i = 0; i < 8; i++)
+        composition.sections.push_back({i, 80, 0, 0, 20});
+
+    haptics.perform(composition);
+    regmap.resetStats();
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        haptics.perform(composition);
+    report.add("haptic_composite_trigger_time", elapsedNs(start) / kIterations / 1000.0, "us");
+    report.add("haptic_composite_trigger_transactions",
+               static_cast<double>(regmap.transactions()) / kIterations, "count");
+
+    unlink(path);
+}
+
+/* Path switch: tear down and rebuild 64 controls and 16 coefficient sets. */
+void benchTuningSwitch(Report &report)
+{
+    constexpr int kIterations = 100;
+    std::vector<uint8_t> tuning = makeBin(512, 256);
+    std::string path = "/tmp/cirrus-bench-headset.bin";
+    std::shared_ptr<const BinFile> staged;
+    SimRegmap regmap;
+    Dsp dsp(regmap, wmfw::kCoreHalo, kHaloRegions, "bench");
+    TuningPrewarmer prewarmer;
+    uint64_t start, ns = 0;
+
+    if (writeFileAtomic(path, tuning.data(), tuning.size()) < 0) {
+        printf("failed to create bench tuning\n");
+        return;
+    }
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        BinFile bin;
+        dsp.invalidateCache();
+        bin.open(path);
+        dsp.loadCoefficients(bin);
+    }
+    report.add("tuning_switch_cold_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    for (int i = 0; i < kIterations; i++) {
+        prewarmer.drop(path);
+        prewarmer.hint(path);
+        prewarmer.take(path, &staged);
+        dsp.invalidateCache();
+
+        start = traceNow();
+        prewarmer.apply(dsp, path);
+        ns += traceNow() - start;
+    }
+    report.add("tuning_switch_prewarmed_time", static_cast<double>(ns) / kIterations / 1000.0,
+               "us");
+
+    unlink(path.c_str());
+}
+
+void benchUseCase(Report &report)
+{
+    constexpr int kIterations = 2000;
+    constexpr size_t kControls = 64, kSets = 16, kCoeffs = 64;
+    std::vector<float> coeffs(kCoeffs, 0.25f);
+    long values[2] = {1, 1};
+    UseCaseState state;
+    uint64_t start;
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        state.reset();
+        state.setName("speaker-playback");
+        state.reserve(kControls, kSets);
+        for (size_t c = 0; c < kControls; c++)
+            state.addControl({static_cast<uint32_t>(c), 0, 2, 0}, values, 2);
+        for (size_t s = 0; s < kSets; s++)
+            state.addCoefficients(kXm + s * kCoeffs * 4, coeffs.data(), kCoeffs, 23);
+    }
+    report.add("use_case_rebuild_time", elapsedNs(start) / kIterations / 1000.0, "us");
+    report.add("use_case_arena_bytes", state.arena().capacity(), "bytes");
+
+    /* Re-applying the same path: every control is answered by the shadow. */
+    ControlShadow shadow;
+    Mixer mixer;
+
+    for (const ControlSetting &setting : state.controls())
+        shadow.update(setting.ctl, setting.values, setting.count);
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++)
+        state.applyControls(mixer, shadow);
+    report.add("path_reapply_time", elapsedNs(start) / kIterations / 1000.0, "us");
+    report.add("path_reapply_writes", shadow.written(), "count");
+}
+
+/* Per-process start-up: open and hash the files versus bind from the cache. */
+void benchTuningCache(Report &report)
+{
+    constexpr int kIterations = 200;
+    std::vector<uint8_t> fw = makeWmfw(256, 1536);
+    std::vector<uint8_t> tuning = makeBin(128, 64);
+    std::string fwPath = "/tmp/cirrus-bench-fw.wmfw", binPath = "/tmp/cirrus-bench-tuning.bin";
+    std::string cachePath = "/tmp/cirrus-bench-tuning.ctc";
+    TuningCacheWriter writer;
+    uint64_t start;
+
+    if (writeFileAtomic(fwPath, fw.data(), fw.size()) < 0 ||
+        writeFileAtomic(binPath, tuning.data(), tuning.size()) < 0 ||
+        writer.addFirmware("fw", fwPath) < 0 || writer.addTuning("tuning", binPath) < 0 ||
+        writer.write(cachePath) < 0) {
+        printf("failed to create bench tuning cache\n");
+        return;
+    }
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        WmfwFile wmfw;
+        BinFile bin;
+        wmfw.open(fwPath);
+        bin.open(binPath);
+        wmfw.hash();
+    }
+    report.add("tuning_files_open_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        TuningCache cache;
+        WmfwFile wmfw;
+        BinFile bin;
+        cache.open(cachePath);
+        cache.firmware("fw", &wmfw);
+        cache.tuning("tuning", &bin);
+        wmfw.hash();
+    }
+    report.add("tuning_cache_open_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    unlink(fwPath.c_str());
+    unlink(binPath.c_str());
+    unlink(cachePath.c_str());
+}
+
+/* An eight-command haptic sequence through the pipelined mailbox. */
+void benchMailbox(Report &report)
+{
+    constexpr uint32_t kCommands = 8;
+    constexpr uint32_t kQueue = kXm + 0x1000;
+    constexpr uint32_t kQueueWords = 32;
+    SimRegmap regmap(kI2c1Mhz);
+    Mailbox mailbox(regmap, {kQueue, kQueueWords, kQueue + kQueueWords * 4,
+                             kQueue + kQueueWords * 4 + 4, 0, 0, 10000});
+
+    /* Read the ring state once, as after a firmware load. */
+    mailbox.post(0);
+    mailbox.flush();
+    regmap.resetStats();
+
+    for (uint32_t i = 0; i < kCommands; i++)
+        mailbox.post(0x01000000 | i);
+    mailbox.flush();
+
+    report.add("mailbox_8cmd_transactions", regmap.transactions(), "count");
+    report.add("mailbox_8cmd_bus_time", regmap.busNs() / 1000.0, "us");
+}
+
+/* A 20-step volume ramp on eight amps over two buses, with and without broadcast. */
+void benchGainRamp(Report &report)
+{
+    constexpr int kAmps = 8;
+    constexpr uint32_t kSteps = 20;
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<Device *> amps;
+    SimRegmap broadcast[2];
+    BusScheduler scheduler;
+
+    for (int i = 0; i < kAmps; i++) {
+        devices.push_back(std::make_unique<Device>(
+                descriptorOf<Part::kCs35l41>(), "amp" + std::to_string(i),
+                "i2c-" + std::to_string(i % 2), std::make_unique<SimRegmap>()));
+        amps.push_back(devices.back().get());
+    }
+
+    for (bool useBroadcast : {false, true}) {
+        GainRamp ramp(scheduler, amps);
+
+        if (useBroadcast) {
+            ramp.setBroadcast("i2c-0", broadcast[0]);
+            ramp.setBroadcast("i2c-1", broadcast[1]);
+        }
+
+        /* Alternate directions so every step changes the gain. */
+        ramp.start(useBroadcast ? 0 : -20000, kSteps, 1);
+        ramp.wait();
+        ramp.start(useBroadcast ? -20000 : 0, kSteps, 1);
+        ramp.wait();
+        report.add(useBroadcast ? "gain_ramp_8amp_broadcast_writes_per_step"
+                                : "gain_ramp_8amp_writes_per_step",
+                   static_cast<double>(ramp.writes()) / kSteps, "count");
+    }
+}
+
+/* Four amps on two buses, brought up in parallel versus all on one bus. */
+void benchBringUp(Report &report)
+{
+    constexpr int kDevices = 4;
+    const SimBusConfig bus = {50000, 9000, 4096, true};
+    std::vector<uint8_t> image = makeWmfw(16, 1536);
+    char path[] = "/tmp/cirrus-bench-XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    if (fd < 0 || writeFileAtomic(path, image.data(), image.size()) < 0) {
+        printf("failed to create bench firmware\n");
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+    close(fd);
+
+    for (int buses : {1, 2}) {
+        std::vector<std::unique_ptr<Device>> devices;
+        std::vector<DeviceFirmware> set;
+        BusScheduler scheduler;
+        uint64_t start;
+
+        for (int i = 0; i < kDevices; i++) {
+            devices.push_back(std::make_unique<Device>(
+                    descriptorOf<Part::kCs35l41>(), "amp" + std::to_string(i),
+                    "i2c-" + std::to_string(i % buses), std::make_unique<SimRegmap>(bus)));
+            set.push_back({devices.back().get(), path, ""});
+        }
+
+        start = traceNow();
+        bringUpDevices(scheduler, set);
+        report.add(buses == 1 ? "bringup_4amp_1bus_time" : "bringup_4amp_2bus_time",
+                   elapsedNs(start) / 1e6, "ms");
+    }
+
+    unlink(path);
+}
+
+void benchHalCore(Report &report)
+{
+    constexpr int kTriggers = 1000;
+    const SimBusConfig bus = {50000, 9000, 4096, true};
+    std::vector<uint8_t> image = makeWmfw(16, 1536);
+    std::string path = "/tmp/cirrus-bench-core.wmfw";
+    HalCore core;
+    uint64_t start;
+
+    if (writeFileAtomic(path, image.data(), image.size()) < 0) {
+        printf("failed to create bench firmware\n");
+        return;
+    }
+
+    core.addDevice(std::make_unique<Device>(descriptorOf<Part::kCs35l41>(), "amp0", "i2c-0",
+                                            std::make_unique<SimRegmap>(bus)));
+    core.addDevice(std::make_unique<Device>(descriptorOf<Part::kCs40l26>(), "haptics", "i2c-1",
+                                            std::make_unique<SimRegmap>()));
+
+    start = traceNow();
+    for (int i = 0; i < kTriggers; i++)
+        core.lock("haptics")->regmap().write(kXm, i);
+    report.add("hal_core_locked_write_time", elapsedNs(start) / kTriggers, "ns");
+
+    /* Haptic triggers on one device while another is in a long download. */
+    std::thread download([&core, &path] { core.lock("amp0")->loadFirmware(path, ""); });
+    usleep(1000);
+
+    start = traceNow();
+    for (int i = 0; i < kTriggers; i++)
+        core.lock("haptics")->regmap().write(kXm, i);
+    report.add("hal_core_write_during_download_time", elapsedNs(start) / kTriggers, "ns");
+
+    download.join();
+    unlink(path.c_str());
+}
+
+void benchTelemetry(Report &report)
+{
+    constexpr int kWrites = 200000;
+    auto sim = std::make_unique<SimRegmap>();
+    SimRegmap *raw = sim.get();
+    Device device(descriptorOf<Part::kCs35l41>(), "amp0", "i2c-0", std::move(sim));
+    uint64_t start, sum = 0;
+    double rawNs;
+
+    start = traceNow();
+    for (int i = 0; i < kWrites; i++)
+        raw->write(kXm, i);
+    rawNs = elapsedNs(start) / kWrites;
+
+    start = traceNow();
+    for (int i = 0; i < kWrites; i++)
+        device.regmap().write(kXm, i);
+    report.add("telemetry_write_overhead", elapsedNs(start) / kWrites - rawNs, "ns");
+
+    start = traceNow();
+    for (int i = 0; i < kWrites; i++)
+        sum += device.telemetry().bus.transactions;
+    report.add("telemetry_query_time", elapsedNs(start) / kWrites, "ns");
+    if (sum != static_cast<uint64_t>(kWrites) * kWrites)
+        printf("unexpected telemetry count\n");
+}
+
+void benchLazyFirmware(Report &report)
+{
+    const SimBusConfig bus = {50000, 9000, 4096, true};
+    std::vector<uint8_t> image = makeWmfw(16, 1536);
+    std::string path = "/tmp/cirrus-bench-call.wmfw";
+    std::vector<std::unique_ptr<Device>> devices;
+    std::vector<DeviceFirmware> needs;
+    BusScheduler scheduler;
+    uint64_t start;
+
+    if (writeFileAtomic(path, image.data(), image.size()) < 0) {
+        printf("failed to create bench firmware\n");
+        return;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        devices.push_back(std::make_unique<Device>(
+                descriptorOf<Part::kCs35l41>(), "amp" + std::to_string(i),
+                "i2c-" + std::to_string(i), std::make_unique<SimRegmap>(bus)));
+        needs.push_back({devices.back().get(), path, ""});
+    }
+
+    {
+        FirmwareManager manager(scheduler);
+
+        manager.declare("voice-call", needs);
+
+        start = traceNow();
+        manager.acquire("voice-call");
+        report.add("stream_open_cold_time", elapsedNs(start) / 1e6, "ms");
+        manager.release("voice-call");
+
+        /* Ringing: the download happens before the call is answered. */
+        manager.prefetch("voice-call");
+        scheduler.wait();
+
+        start = traceNow();
+        manager.acquire("voice-call");
+        report.add("stream_open_prefetched_time", elapsedNs(start) / 1e6, "ms");
+        manager.release("voice-call");
+    }
+
+    unlink(path.c_str());
+}
+
+void benchCompressedFirmware(Report &report)
+{
+    constexpr int kIterations = 200;
+    std::vector<uint8_t> image = makeWmfw(256, 1536);
+    std::vector<uint8_t> frame = lz4Frame(image);
+    SimRegmap regmap;
+    Dsp dsp(regmap, wmfw::kCoreHalo, kHaloRegions, "bench");
+    WmfwFile wmfw;
+    Lz4Stream stream;
+    uint64_t start;
+
+    report.add("firmware_lz4_ratio", static_cast<double>(frame.size()) / image.size(), "ratio");
+
+    wmfw.parse({image.data(), image.size()});
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        dsp.invalidateCache();
+        dsp.loadFirmware(wmfw);
+    }
+    report.add("firmware_plain_load_time", elapsedNs(start) / kIterations / 1000.0, "us");
+
+    start = traceNow();
+    for (int i = 0; i < kIterations; i++) {
+        dsp.invalidateCache();
+        stream.parse({frame.data(), frame.size()});
+        dsp.loadFirmware(stream);
+    }
+    report.add("firmware_lz4_load_time", elapsedNs(start) / kIterations / 1000.0, "us");
+}
+
+void benchSuspendResume(Report &report)
+{
+    const DeviceDescriptor &desc = descriptorOf<Part::kCs35l41>();
+    std::vector<uint8_t> image = makeWmfw(16, 1536);
+    std::string path = "/tmp/cirrus-bench-resume.wmfw";
+    auto owned = std::make_unique<SimRegmap>(kI2c1Mhz);
+    SimRegmap &regmap = *owned;
+    Device device(desc, "amp", "i2c-0", std::move(owned));
+
+    if (writeFileAtomic(path, image.data(), image.size()) < 0) {
+        printf("failed to create bench firmware\n");
+        return;
+    }
+
+    /* The use case setup: every retained register moved off its default. */
+    auto configure = [&] {
+        for (const RegDefault &r : desc.retained)
+            device.regmap().write(r.reg, ~r.val);
+    };
+    /* What suspend does to the part: configuration back to reset values. */
+    auto lose = [&] {
+        for (const RegDefault &r : desc.retained)
+            regmap.poke(r.reg, r.val);
+    };
+
+    device.loadFirmware(path, "");
+    configure();
+    device.powerUp();
+
+    device.suspend();
+    lose();
+    regmap.resetStats();
+    device.dsp().invalidateCache();
+    configure();
+    device.loadFirmware(path, "");
+    device.powerUp();
+    report.add("resume_full_init_bus_time", regmap.busNs() / 1e6, "ms");
+    report.add("resume_full_init_transactions", static_cast<double>(regmap.transactions()),
+               "count");
+
+    device.suspend();
+    report.add("suspend_snapshot_size", static_cast<double>(device.snapshotBytes()), "bytes");
+    lose();
+    regmap.resetStats();
+    device.resume();
+    report.add("resume_snapshot_bus_time", regmap.busNs() / 1e6, "ms");
+    report.add("resume_snapshot_transactions", static_cast<double>(regmap.transactions()),
+               "count");
+
+    unlink(path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Report report(argc > 1 ? argv[1] : "bench_output.txt");
+
+    if (!report.ok()) {
+        perror("bench output");
+        return 1;
+    }
+
+#if !defined(__ANDROID__)
+    logSetLevel('W');
+#endif
+
+    benchFirmware(report);
+    benchCoefficients(report);
+    benchCoeffConvert(report);
+    benchControlLookup(report);
+    benchSymbolLookup(report);
+    benchParamRing(report);
+    benchTuningCache(report);
+    benchTuningSwitch(report);
+    benchUseCase(report);
+    benchHaptics(report);
+    benchMailbox(report);
+    benchGainRamp(report);
+    benchBringUp(report);
+    benchLazyFirmware(report);
+    benchCompressedFirmware(report);
+    benchTelemetry(report);
+    benchHalCore(report);
+    benchSuspendResume(report);
+
+    return 0;
+}
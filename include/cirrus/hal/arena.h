@@ -0,0 +1,118 @@
+/*
+ * Bump allocator for state that lives exactly as long as a use case.
+ *
+ * Allocation is a pointer increment within a block; reset() releases
+ * everything at once by rewinding to the first block. Blocks are kept for
+ * the next use case, so once the arena has grown to fit the largest
+ * routing/tuning set, a path switch makes no heap calls at all. Nothing
+ * is destroyed on reset(), so only trivially destructible objects may be
+ * created in it.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cirrus::hal {
+
+class Arena {
+public:
+    static constexpr size_t kDefaultBlockSize = 16 * 1024;
+
+    explicit Arena(size_t blockSize = kDefaultBlockSize) : mBlockSize(blockSize) {}
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /* Never fails; throws std::bad_alloc like operator new. */
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "reset() runs no destructors");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /* Uninitialised storage for @count objects of @T. */
+    template <typename T>
+    T *allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "reset() runs no destructors");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /*
+     * Release every allocation. Blocks of the standard size are kept;
+     * oversized ones made for single large requests are freed.
+     */
+    void reset();
+
+    /* Bytes handed out since the last reset, and bytes held in blocks. */
+    size_t used() const { return mUsed; }
+    size_t capacity() const { return mCapacity; }
+
+private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    void *allocateFrom(Block &block, size_t size, size_t align);
+
+    size_t mBlockSize;
+    std::vector<Block> mBlocks;
+    size_t mCurrent = 0;
+    size_t mOffset = 0;
+    size_t mUsed = 0;
+    size_t mCapacity = 0;
+};
+
+/* Standard allocator adaptor; deallocation is a no-op until reset(). */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(Arena &arena) : mArena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : mArena(other.arena())
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        return static_cast<T *>(mArena->allocate(sizeof(T) * count, alignof(T)));
+    }
+    void deallocate(T *, size_t) {}
+
+    Arena *arena() const { return mArena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return mArena == other.arena();
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const
+    {
+        return mArena != other.arena();
+    }
+
+private:
+    Arena *mArena;
+};
+
+/* Reserve up front: growth leaves the old buffer in the arena until reset. */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace cirrus::hal
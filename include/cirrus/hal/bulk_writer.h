@@ -0,0 +1,72 @@
+/*
+ * Coalescing writer for DSP memory and register downloads.
+ *
+ * Writes to consecutive addresses are merged into a single run and issued
+ * as rawWrite() calls sized to the bus limit, so a firmware made of many
+ * small blocks costs a handful of bus transactions instead of one per
+ * block. Queued data is borrowed, not copied: it must stay valid until the
+ * next flush(). Only runs made of several pieces are staged into a bounce
+ * buffer; a run backed by one view is written straight from it. The queue
+ * of views keeps its capacity across flushes, so once it has grown (or
+ * been reserve()d) to the largest run, writes of views never allocate.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+class BulkWriter {
+public:
+    explicit BulkWriter(Regmap &regmap);
+
+    BulkWriter(const BulkWriter &) = delete;
+    BulkWriter &operator=(const BulkWriter &) = delete;
+
+    /* Queue @data for @reg. Returns 0 or a negative errno from the bus. */
+    int write(uint32_t reg, ByteView data);
+    /* Queue a single register value; it is copied. */
+    int write(uint32_t reg, uint32_t val);
+
+    /* Issue everything still queued. */
+    int flush();
+
+    /* Make room for @views queued views up front. */
+    void reserve(size_t views) { mRun.reserve(views); }
+
+    /* Bus transactions and payload bytes issued since construction. */
+    size_t transactions() const { return mTransactions; }
+    size_t bytes() const { return mBytes; }
+
+private:
+    int emit(size_t len);
+    int drain(bool all);
+    void popHead();
+    void reset();
+
+    Regmap &mRegmap;
+    size_t mMaxWrite;
+
+    uint32_t mRunReg = 0;
+    size_t mRunBytes = 0;
+    /* Queued views; mRun[mHead] is the next to go out, from mHeadOffset. */
+    std::vector<ByteView> mRun;
+    size_t mHead = 0;
+    size_t mHeadOffset = 0;
+
+    std::vector<uint8_t> mStage;
+    /* Backing store for single values; deque keeps queued views stable. */
+    std::deque<std::array<uint8_t, 4>> mValues;
+
+    size_t mTransactions = 0;
+    size_t mBytes = 0;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,59 @@
+/*
+ * Per-bus work queues.
+ *
+ * Each bus gets one worker thread, created on first use. Jobs submitted for
+ * the same bus run strictly in submission order; jobs on different buses
+ * run concurrently. This lets several amplifiers be brought up at once
+ * without two transactions ever contending for one controller.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cirrus::hal {
+
+class BusScheduler {
+public:
+    /* A unit of bus work. Returns 0 or a negative errno. */
+    using Job = std::function<int()>;
+
+    BusScheduler() = default;
+    ~BusScheduler();
+
+    BusScheduler(const BusScheduler &) = delete;
+    BusScheduler &operator=(const BusScheduler &) = delete;
+
+    /* Queue @job behind everything already queued on @bus. */
+    void submit(const std::string &bus, Job job);
+
+    /*
+     * Block until every submitted job has finished. Returns the first error
+     * reported by a job since the previous wait(), or 0.
+     */
+    int wait();
+
+private:
+    struct Queue {
+        std::deque<Job> jobs;
+        std::thread worker;
+    };
+
+    void run(Queue *queue);
+
+    std::mutex mLock;
+    std::condition_variable mWork;
+    std::condition_variable mIdle;
+    std::map<std::string, std::unique_ptr<Queue>> mQueues;
+    size_t mPending = 0;
+    int mError = 0;
+    bool mStopping = false;
+};
+
+} // namespace cirrus::hal
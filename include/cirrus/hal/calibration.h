@@ -0,0 +1,65 @@
+/*
+ * Persistent speaker-protection calibration for CS35L4x amplifiers.
+ *
+ * Results for every amp are kept in one small binary file (.ccal), all
+ * fields little-endian:
+ *
+ *   header   magic "CCAL", u16 version, u16 entry count,
+ *            u64 XXH64 of the entries
+ *   entry    u64 amp uid, u32 ReDC, u32 ambient temperature,
+ *            u32 status, u32 checksum
+ *
+ * At boot the values are written back to the firmware without running a
+ * calibration and without any text parsing: the file is validated with a
+ * single hash and each amp gets one coalesced write.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/dsp.h"
+
+namespace cirrus::hal {
+
+struct Calibration {
+    /* Identifies the amp, e.g. its OTP unique id. */
+    uint64_t uid;
+    uint32_t redc;
+    uint32_t ambient;
+    uint32_t status;
+    uint32_t checksum;
+};
+
+/* Where the protection algorithm keeps the values, as XM word offsets. */
+struct CalibrationLayout {
+    uint32_t algId;
+    uint32_t redc;
+    uint32_t ambient;
+    uint32_t status;
+    uint32_t checksum;
+};
+
+class CalibrationStore {
+public:
+    static constexpr uint16_t kVersion = 1;
+
+    /* Read @path. A missing file is not an error and yields no entries. */
+    int load(const std::string &path);
+    int save(const std::string &path) const;
+
+    const Calibration *find(uint64_t uid) const;
+    /* Add or replace the entry for @cal.uid. */
+    void update(const Calibration &cal);
+
+    const std::vector<Calibration> &entries() const { return mEntries; }
+
+private:
+    std::vector<Calibration> mEntries;
+};
+
+/* Write @cal into the running firmware on @dsp in one batched transfer. */
+int restoreCalibration(Dsp &dsp, const CalibrationLayout &layout, const Calibration &cal);
+
+} // namespace cirrus::hal
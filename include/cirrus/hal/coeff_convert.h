@@ -0,0 +1,35 @@
+/*
+ * Conversion of tuning coefficients into DSP memory format.
+ *
+ * The DSP holds 24-bit words, big-endian on the bus: either one word per
+ * 32-bit register (unpacked XM/YM) or four words per three registers
+ * (packed XM/YM, 3 bytes per word). These routines are vectorised with
+ * NEON on AArch64 and SSE2/SSSE3 on x86, and fall back to scalar code
+ * elsewhere; every implementation produces identical output.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cirrus::hal {
+
+/*
+ * Scale floats by 2^@fracBits, round to nearest and saturate to signed
+ * 24 bits, as big-endian 32-bit words. NaN saturates to the minimum.
+ */
+void floatToDsp(const float *in, size_t count, unsigned fracBits, uint8_t *out);
+
+/* Low 24 bits of each value as big-endian 32-bit words. */
+void intToDsp(const int32_t *in, size_t count, uint8_t *out);
+
+/* Low 24 bits of each value as packed big-endian 3-byte words. */
+void packDsp24(const int32_t *in, size_t count, uint8_t *out);
+
+/* Big-endian 32-bit words back to sign-extended 24-bit values. */
+void dspToInt(const uint8_t *in, size_t count, int32_t *out);
+
+/* Name of the implementation selected for this CPU. */
+const char *coeffConvertImpl();
+
+} // namespace cirrus::hal
@@ -0,0 +1,48 @@
+/*
+ * One-shot completion for asynchronous HAL operations.
+ *
+ * The result is published through an eventfd, so a caller can wait() on it
+ * directly or add fd() to its own poll loop alongside stream and IRQ
+ * descriptors. The fd stays readable once signalled until reset().
+ */
+#pragma once
+
+#include <atomic>
+
+namespace cirrus::hal {
+
+class Completion {
+public:
+    Completion() = default;
+    ~Completion();
+
+    Completion(const Completion &) = delete;
+    Completion &operator=(const Completion &) = delete;
+
+    int open();
+    void close();
+
+    int fd() const { return mFd; }
+
+    /* Record @result (0 or a negative errno) and wake any waiters. */
+    void signal(int result);
+
+    bool done() const { return mDone.load(std::memory_order_acquire); }
+    int result() const { return mResult.load(std::memory_order_relaxed); }
+
+    /*
+     * Block for up to @timeoutMs (-1 for ever) until signalled. Returns the
+     * signalled result, or -ETIMEDOUT.
+     */
+    int wait(int timeoutMs = -1);
+
+    /* Rearm for another operation. Must not race with signal(). */
+    void reset();
+
+private:
+    int mFd = -1;
+    std::atomic<int> mResult{0};
+    std::atomic<bool> mDone{false};
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,36 @@
+/*
+ * Fast non-cryptographic content hash (XXH64) used to recognise firmware
+ * and tuning data that is already resident on a device, and XXH32, the
+ * checksum of the LZ4 frame format.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cirrus/hal/mapped_file.h"
+
+namespace cirrus::hal {
+
+uint64_t contentHash(ByteView data, uint64_t seed = 0);
+
+/* Incremental XXH32 over data that arrives in pieces. */
+class Xxh32 {
+public:
+    explicit Xxh32(uint32_t seed = 0) { reset(seed); }
+
+    void reset(uint32_t seed = 0);
+    void update(ByteView data);
+    uint32_t digest() const;
+
+private:
+    uint32_t mSeed;
+    uint32_t mAcc[4];
+    uint8_t mBuf[16];
+    size_t mBuffered;
+    uint64_t mTotal;
+};
+
+uint32_t xxh32(ByteView data, uint32_t seed = 0);
+
+} // namespace cirrus::hal
@@ -0,0 +1,63 @@
+/*
+ * Shadow of the last values written to ALSA controls.
+ *
+ * Applying a route through the shadow compares each target value with the
+ * last one written and only issues the controls that differ, back to back
+ * in path order. A control the shadow has not seen is always written.
+ * Writes that bypass the shadow make it stale: invalidate() the affected
+ * controls, or clear() everything after a firmware load or card reset.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cirrus/hal/control_table.h"
+#include "cirrus/hal/mixer.h"
+
+namespace cirrus::hal {
+
+struct ControlSetting {
+    ControlInfo ctl;
+    const long *values;
+    uint32_t count;
+};
+
+class ControlShadow {
+public:
+    void clear();
+    void invalidate(uint32_t numid);
+
+    /* True if @values are known to be what @ctl currently holds. */
+    bool matches(const ControlInfo &ctl, const long *values, size_t count) const;
+    void update(const ControlInfo &ctl, const long *values, size_t count);
+
+    /*
+     * Write the settings that differ from the shadow. Stops at the first
+     * failure, leaving that control unknown.
+     */
+    int apply(Mixer &mixer, const ControlSetting *settings, size_t count);
+
+    /* Controls written and skipped by apply() since the last clear(). */
+    size_t written() const { return mWritten; }
+    size_t skipped() const { return mSkipped; }
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t count;
+        /* Slots reserved at offset; count may be smaller. */
+        uint32_t capacity;
+        bool valid;
+    };
+
+    /* Indexed by numid, which the kernel hands out densely from 1. */
+    std::vector<Entry> mEntries;
+    std::vector<long> mValues;
+
+    size_t mWritten = 0;
+    size_t mSkipped = 0;
+};
+
+} // namespace cirrus::hal
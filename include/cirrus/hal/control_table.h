@@ -0,0 +1,59 @@
+/*
+ * Name-keyed lookup table for ALSA controls.
+ *
+ * Built once from the card's control list so routing code can resolve a
+ * control such as "AMP PCM Gain" or "DSP1 Firmware" in O(1) instead of
+ * scanning hundreds of DSP-generated controls on every path change.
+ * Entries live in one array and their names in one string pool; the
+ * open-addressed index only holds entry numbers.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cirrus::hal {
+
+struct ControlInfo {
+    uint32_t numid;
+    /* SNDRV_CTL_ELEM_TYPE_* */
+    int type;
+    uint32_t count;
+    /* SNDRV_CTL_ELEM_ACCESS_* */
+    uint32_t access;
+};
+
+class ControlTable {
+public:
+    void clear();
+    void reserve(size_t count);
+
+    /* Add a control; a later entry with the same name and index wins. */
+    void insert(std::string_view name, uint32_t index, const ControlInfo &info);
+
+    const ControlInfo *find(std::string_view name, uint32_t index = 0) const;
+
+    size_t size() const { return mEntries.size(); }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint32_t nameOffset;
+        uint32_t nameLen;
+        uint32_t index;
+        ControlInfo info;
+    };
+
+    static uint32_t hashOf(std::string_view name, uint32_t index);
+    size_t probe(std::string_view name, uint32_t index, uint32_t hash) const;
+    void rehash(size_t slots);
+
+    std::vector<Entry> mEntries;
+    std::string mNames;
+    /* Entry number plus one; zero marks an empty slot. Size is a power of 2. */
+    std::vector<uint32_t> mSlots;
+};
+
+} // namespace cirrus::hal
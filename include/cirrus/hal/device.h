@@ -0,0 +1,138 @@
+/*
+ * A Cirrus Logic device instance: its descriptor, bus, register map and DSP.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/completion.h"
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/regmap.h"
+#include "cirrus/hal/register_snapshot.h"
+#include "cirrus/hal/telemetry.h"
+
+namespace cirrus::hal {
+
+class Device {
+public:
+    /* Called on the bus worker with 0 or a negative errno. */
+    using PowerCallback = std::function<void(Device &device, int result)>;
+
+    /*
+     * @bus names the physical bus (e.g. "i2c-2"); devices that share a bus
+     * must use the same name so their work is serialised. @desc must have
+     * static storage duration, e.g. descriptorOf<Part::kCs35l41>().
+     * @regmap is wrapped in an InstrumentedRegmap for telemetry().
+     */
+    Device(const DeviceDescriptor &desc, std::string name, std::string bus,
+           std::unique_ptr<Regmap> regmap);
+
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
+
+    const DeviceDescriptor &descriptor() const { return mDesc; }
+    const std::string &name() const { return mName; }
+    const std::string &bus() const { return mBus; }
+    Regmap &regmap() { return *mRegmap; }
+    Dsp &dsp() { return mDsp; }
+    const Dsp &dsp() const { return mDsp; }
+
+    /* Bus counters and the last DSP load sample; never touches the bus. */
+    DeviceTelemetry telemetry() const;
+    void resetTelemetry() { mRegmap->resetCounters(); }
+
+    /*
+     * Where the running firmware publishes its load, e.g. a MIPS counter
+     * found through a SymbolTable: @reg reads @fullScale at 100%. Cleared
+     * by a firmware load.
+     */
+    void setDspLoadSource(uint32_t reg, uint32_t fullScale);
+    /* Read the load back from the DSP; -ENODATA without a source. */
+    int sampleDspLoad();
+
+    /* Check the device ID register matches the descriptor; -ENODEV if not. */
+    int probe();
+
+    /* Run the descriptor's power sequences; powerUp() also starts the DSP. */
+    int powerUp();
+    int powerDown();
+
+    /*
+     * Queue a power sequence on this device's bus and return immediately;
+     * its polls and delays then block only the bus worker. Transitions on
+     * different buses overlap, so several amps can be powered at once.
+     * The device must outlive the transition.
+     */
+    void powerUpAsync(BusScheduler &scheduler, PowerCallback done);
+    void powerDownAsync(BusScheduler &scheduler, PowerCallback done);
+    /* As above, signalling @done; it must be open() and reset(). */
+    void powerUpAsync(BusScheduler &scheduler, Completion &done);
+    void powerDownAsync(BusScheduler &scheduler, Completion &done);
+
+    /*
+     * Keep @len bytes of DSP state at @reg across suspend(), e.g. a
+     * volatile control found through a SymbolTable. Cleared by a firmware
+     * load.
+     */
+    void retainOnSuspend(uint32_t reg, uint32_t len);
+
+    /*
+     * Capture the descriptor's retained registers that differ from reset,
+     * and the retained DSP state, then run powerDown(). The DSP memory is
+     * expected to survive, so the Dsp's residency cache stays valid.
+     */
+    int suspend();
+    /*
+     * Restore the snapshot in one coalesced burst, then run powerUp().
+     * Pass @powerLost if the supply was cut while suspended: the Dsp's
+     * residency cache is dropped, so the next load rewrites everything.
+     * -ENODATA if suspend() did not take one.
+     */
+    int resume(bool powerLost = false);
+    /* Size of the pending snapshot in bytes of register data. */
+    size_t snapshotBytes() const { return mSnapshot.bytes(); }
+
+    /*
+     * Download @wmfwPath and, if not empty, the tuning in @binPath. The DSP
+     * core is stopped first unless the same firmware is already resident.
+     * Paths ending in .lz4 are streamed through an Lz4Stream.
+     */
+    int loadFirmware(const std::string &wmfwPath, const std::string &binPath);
+
+private:
+    const DeviceDescriptor &mDesc;
+    std::string mName;
+    std::string mBus;
+    std::unique_ptr<InstrumentedRegmap> mRegmap;
+    Dsp mDsp;
+
+    uint32_t mLoadReg = 0;
+    uint32_t mLoadFullScale = 0;
+    std::atomic<int32_t> mLoadPermille{-1};
+
+    std::vector<std::pair<uint32_t, uint32_t>> mRetainedDsp;
+    RegisterSnapshot mSnapshot;
+    bool mSuspended = false;
+};
+
+struct DeviceFirmware {
+    Device *device;
+    std::string wmfw;
+    std::string bin;
+};
+
+/*
+ * Load firmware onto every device in @set, running devices on different
+ * buses in parallel and devices sharing a bus in the order given. Returns
+ * the first error encountered; all devices are attempted regardless.
+ */
+int bringUpDevices(BusScheduler &scheduler, const std::vector<DeviceFirmware> &set);
+
+} // namespace cirrus::hal
@@ -0,0 +1,309 @@
+/*
+ * Compile-time descriptions of the supported Cirrus Logic parts.
+ *
+ * Everything the HAL needs to know about a part (identification, DSP
+ * memory map, control names, power sequences, interrupt sources, gain
+ * field, registers to keep across suspend) lives in constexpr tables, one
+ * PartTraits specialisation per part. A Device binds to its descriptor
+ * once at construction, so nothing on the register access path searches
+ * a table or compares strings to work out which part it is.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+/* Constexpr view of a static table. */
+template <typename T>
+struct Table {
+    const T *data;
+    size_t size;
+
+    template <size_t N>
+    constexpr Table(const T (&array)[N]) : data(array), size(N) {}
+    constexpr Table() : data(nullptr), size(0) {}
+
+    constexpr const T *begin() const { return data; }
+    constexpr const T *end() const { return data + size; }
+    constexpr const T &operator[](size_t i) const { return data[i]; }
+};
+
+struct PowerStep {
+    enum Op : uint8_t {
+        /* reg = (reg & ~mask) | val */
+        kUpdate,
+        /* reg = val without reading it first, e.g. to ack W1C status bits */
+        kWrite,
+        /* Wait until (reg & mask) == val, polling every 1 ms for up to us */
+        kPoll,
+        /* Sleep for us microseconds */
+        kDelay,
+    };
+
+    Op op;
+    uint32_t reg;
+    uint32_t mask;
+    uint32_t val;
+    uint32_t us;
+};
+
+enum class IrqEvent : uint8_t {
+    kOverTemperature,
+    kShortCircuit,
+    kMailbox,
+    kHapticComplete,
+    kCount,
+};
+
+/* @event is pending while (reg & mask) != 0; writing mask back clears it. */
+struct IrqBit {
+    IrqEvent event;
+    uint32_t reg;
+    uint32_t mask;
+};
+
+/* A register lost in suspend and the value it holds after reset. */
+struct RegDefault {
+    uint32_t reg;
+    uint32_t val;
+};
+
+/*
+ * Digital volume as a signed two's complement field of @stepMdB units.
+ * reg == 0 means the part has no register gain (CS40L2x gain is set
+ * through the firmware).
+ */
+struct GainField {
+    uint32_t reg;
+    uint32_t mask;
+    uint8_t shift;
+    int32_t stepMdB;
+    int32_t minMdB;
+    int32_t maxMdB;
+};
+
+struct DeviceDescriptor {
+    const char *part;
+    uint32_t devidReg;
+    uint32_t devid;
+
+    uint8_t core;
+    Table<DspRegion> regions;
+    uint32_t coreControlReg;
+
+    /* ALSA control names exposed by the upstream codec driver. */
+    const char *firmwareControl;
+    const char *gainControl;
+
+    Table<PowerStep> powerUp;
+    Table<PowerStep> powerDown;
+
+    Table<IrqBit> irqs;
+
+    GainField gain;
+
+    /*
+     * Configuration registers a RegisterSnapshot carries across suspend,
+     * in ascending address order. Power sequence, core control and
+     * interrupt status registers are left to powerUp().
+     */
+    Table<RegDefault> retained;
+};
+
+enum class Part : uint8_t {
+    kCs35l41,
+    kCs35l45,
+    kCs40l25,
+    kCs40l26,
+};
+
+template <Part P>
+struct PartTraits;
+
+namespace parts {
+
+/* Every supported part uses the same Halo Core memory map. */
+inline constexpr DspRegion kHaloRegions[] = {
+        {wmfw::kHaloPmPacked, 0x03800000}, {wmfw::kHaloXmPacked, 0x02000000},
+        {wmfw::kHaloYmPacked, 0x02c00000}, {wmfw::kAdsp2Xm, 0x02800000},
+        {wmfw::kAdsp2Ym, 0x03400000},
+};
+
+inline constexpr uint32_t kHaloCoreControl = 0x02bc1000;
+inline constexpr uint32_t kHaloCoreEnable = 0x00000001;
+inline constexpr uint32_t kHaloCoreReset = 0x00000200;
+
+inline constexpr uint32_t kCs35l41PwrCtrl1 = 0x00002014;
+inline constexpr uint32_t kCs35l41GlobalEn = 0x00000001;
+inline constexpr uint32_t kCs35l41PupDone = 1u << 24;
+inline constexpr uint32_t kCs35l41PdnDone = 1u << 23;
+
+/* IRQ1 status registers are write-1-to-clear on every supported part. */
+inline constexpr uint32_t kIrq1Status1 = 0x00010010;
+inline constexpr uint32_t kIrq1Status2 = 0x00010014;
+inline constexpr uint32_t kAmpShortErr = 1u << 31;
+inline constexpr uint32_t kTempErr = 1u << 17;
+inline constexpr uint32_t kBstShortErr = 1u << 8;
+inline constexpr uint32_t kDspVirtual1Mbox = 1u << 20;
+inline constexpr uint32_t kDspVirtual2Mbox = 1u << 21;
+
+inline constexpr IrqBit kAmpIrqs[] = {
+        {IrqEvent::kOverTemperature, kIrq1Status1, kTempErr},
+        {IrqEvent::kShortCircuit, kIrq1Status1, kAmpShortErr | kBstShortErr},
+        {IrqEvent::kMailbox, kIrq1Status2, kDspVirtual2Mbox},
+};
+
+/* Haptic firmware raises virtual mailbox 1 when playback completes. */
+inline constexpr IrqBit kHapticIrqs[] = {
+        {IrqEvent::kOverTemperature, kIrq1Status1, kTempErr},
+        {IrqEvent::kShortCircuit, kIrq1Status1, kAmpShortErr | kBstShortErr},
+        {IrqEvent::kMailbox, kIrq1Status2, kDspVirtual2Mbox},
+        {IrqEvent::kHapticComplete, kIrq1Status2, kDspVirtual1Mbox},
+};
+
+inline constexpr PowerStep kCs35l41PowerUp[] = {
+        {PowerStep::kWrite, kIrq1Status1, kCs35l41PupDone, kCs35l41PupDone, 0},
+        {PowerStep::kUpdate, kCs35l41PwrCtrl1, kCs35l41GlobalEn, kCs35l41GlobalEn, 0},
+        {PowerStep::kPoll, kIrq1Status1, kCs35l41PupDone, kCs35l41PupDone, 100000},
+        {PowerStep::kUpdate, kHaloCoreControl, kHaloCoreEnable | kHaloCoreReset,
+         kHaloCoreEnable | kHaloCoreReset, 0},
+};
+
+inline constexpr PowerStep kCs35l41PowerDown[] = {
+        {PowerStep::kUpdate, kHaloCoreControl, kHaloCoreEnable, 0, 0},
+        {PowerStep::kWrite, kIrq1Status1, kCs35l41PdnDone, kCs35l41PdnDone, 0},
+        {PowerStep::kUpdate, kCs35l41PwrCtrl1, kCs35l41GlobalEn, 0, 0},
+        {PowerStep::kPoll, kIrq1Status1, kCs35l41PdnDone, kCs35l41PdnDone, 100000},
+};
+
+/* CS35L45 and the CS40L2x haptic parts share the global enable layout. */
+inline constexpr uint32_t kGlobalEnables = 0x00002014;
+inline constexpr uint32_t kGlobalEn = 0x00000001;
+
+inline constexpr PowerStep kHaloPowerUp[] = {
+        {PowerStep::kUpdate, kGlobalEnables, kGlobalEn, kGlobalEn, 0},
+        {PowerStep::kDelay, 0, 0, 0, 3000},
+        {PowerStep::kUpdate, kHaloCoreControl, kHaloCoreEnable | kHaloCoreReset,
+         kHaloCoreEnable | kHaloCoreReset, 0},
+};
+
+inline constexpr PowerStep kHaloPowerDown[] = {
+        {PowerStep::kUpdate, kHaloCoreControl, kHaloCoreEnable, 0, 0},
+        {PowerStep::kUpdate, kGlobalEnables, kGlobalEn, 0, 0},
+        {PowerStep::kDelay, 0, 0, 0, 1000},
+};
+
+inline constexpr RegDefault kCs35l41Retained[] = {
+        /* PWR_CTRL2, PWR_CTRL3 */
+        {0x00002018, 0x00000000}, {0x0000201c, 0x01000010},
+        /* Serial port enables, rate, format, tristate and TX slots */
+        {0x00004800, 0x00000000}, {0x00004804, 0x00000028}, {0x00004808, 0x18180200},
+        {0x0000480c, 0x00000002}, {0x00004810, 0x03020100},
+        /* RX slots and word lengths */
+        {0x00004820, 0x00000100}, {0x00004830, 0x00000018}, {0x00004840, 0x00000018},
+        /* DAC, ASP TX and DSP RX source routing */
+        {0x00004c00, 0x00000008}, {0x00004c20, 0x00000018}, {0x00004c24, 0x00000019},
+        {0x00004c28, 0x00000020}, {0x00004c2c, 0x00000021}, {0x00004c40, 0x00000008},
+        {0x00004c44, 0x00000009}, {0x00004c48, 0x00000018}, {0x00004c4c, 0x00000019},
+        /* AMP_DIG_VOL_CTRL, AMP_GAIN_CTRL */
+        {0x00006000, 0x00008000}, {0x00006c04, 0x00000000},
+        /* IRQ1_MASK1, IRQ1_MASK2 */
+        {0x00010110, 0xffffffff}, {0x00010114, 0xffffffff},
+};
+
+inline constexpr RegDefault kCs35l45Retained[] = {
+        /* ASP enables, control and frame slots */
+        {0x00004800, 0x00000000}, {0x00004804, 0x00000028}, {0x00004808, 0x18180200},
+        {0x0000480c, 0x00000002}, {0x00004810, 0x03020100},
+        /* AMP_PCM_CONTROL */
+        {0x00004b00, 0x00000000},
+        /* DAC, ASP TX and DSP RX source routing */
+        {0x00004c00, 0x00000008}, {0x00004c20, 0x00000018}, {0x00004c24, 0x00000019},
+        {0x00004c28, 0x00000020}, {0x00004c2c, 0x00000021}, {0x00004c40, 0x00000008},
+        {0x00004c44, 0x00000009},
+        /* IRQ1_MASK1, IRQ1_MASK2 */
+        {0x00010110, 0xffffffff}, {0x00010114, 0xffffffff},
+};
+
+/* Haptic parts keep most of their configuration in firmware. */
+inline constexpr RegDefault kHapticRetained[] = {
+        /* DSP1 RX sources for the I2S haptic input */
+        {0x00004c40, 0x00000008}, {0x00004c44, 0x00000009},
+        /* IRQ1_MASK1, IRQ1_MASK2 */
+        {0x00010110, 0xffffffff}, {0x00010114, 0xffffffff},
+};
+
+inline constexpr GainField kCs35l41Gain = {0x00006000, 0x00003ff8, 3, 125, -102000, 12000};
+inline constexpr GainField kCs35l45Gain = {0x00004b00, 0x000007ff, 0, 125, -102000, 12000};
+inline constexpr GainField kNoGain = {};
+
+} // namespace parts
+
+template <>
+struct PartTraits<Part::kCs35l41> {
+    static constexpr DeviceDescriptor descriptor = {
+            "cs35l41", 0x00000000, 0x035a40, wmfw::kCoreHalo, parts::kHaloRegions,
+            parts::kHaloCoreControl, "DSP1 Firmware", "AMP PCM Gain",
+            parts::kCs35l41PowerUp, parts::kCs35l41PowerDown, parts::kAmpIrqs,
+            parts::kCs35l41Gain, parts::kCs35l41Retained,
+    };
+};
+
+template <>
+struct PartTraits<Part::kCs35l45> {
+    static constexpr DeviceDescriptor descriptor = {
+            "cs35l45", 0x00000000, 0x35a450, wmfw::kCoreHalo, parts::kHaloRegions,
+            parts::kHaloCoreControl, "DSP1 Firmware", "AMP PCM Gain",
+            parts::kHaloPowerUp, parts::kHaloPowerDown, parts::kAmpIrqs,
+            parts::kCs35l45Gain, parts::kCs35l45Retained,
+    };
+};
+
+template <>
+struct PartTraits<Part::kCs40l25> {
+    static constexpr DeviceDescriptor descriptor = {
+            "cs40l25", 0x00000000, 0x40a250, wmfw::kCoreHalo, parts::kHaloRegions,
+            parts::kHaloCoreControl, "DSP1 Firmware", "AMP Gain",
+            parts::kHaloPowerUp, parts::kHaloPowerDown, parts::kHapticIrqs,
+            parts::kNoGain, parts::kHapticRetained,
+    };
+};
+
+template <>
+struct PartTraits<Part::kCs40l26> {
+    static constexpr DeviceDescriptor descriptor = {
+            "cs40l26", 0x00000000, 0x40a260, wmfw::kCoreHalo, parts::kHaloRegions,
+            parts::kHaloCoreControl, "DSP1 Firmware", "AMP Gain",
+            parts::kHaloPowerUp, parts::kHaloPowerDown, parts::kHapticIrqs,
+            parts::kNoGain, parts::kHapticRetained,
+    };
+};
+
+template <Part P>
+constexpr const DeviceDescriptor &descriptorOf()
+{
+    return PartTraits<P>::descriptor;
+}
+
+/* For parts chosen at run time, e.g. from a board configuration file. */
+constexpr const DeviceDescriptor &descriptorOf(Part part)
+{
+    switch (part) {
+    case Part::kCs35l41:
+        return descriptorOf<Part::kCs35l41>();
+    case Part::kCs35l45:
+        return descriptorOf<Part::kCs35l45>();
+    case Part::kCs40l25:
+        return descriptorOf<Part::kCs40l25>();
+    case Part::kCs40l26:
+    default:
+        return descriptorOf<Part::kCs40l26>();
+    }
+}
+
+} // namespace cirrus::hal
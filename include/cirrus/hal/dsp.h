@@ -0,0 +1,134 @@
+/*
+ * Firmware download to a Cirrus Logic ADSP2 or Halo Core DSP.
+ *
+ * Region payloads are streamed from the mapped .wmfw/.bin image through a
+ * BulkWriter, so blocks that land at consecutive addresses go out as one
+ * bus transfer.
+ *
+ * The Dsp remembers a content hash of the firmware and of every
+ * coefficient block it has written. Reloading the resident firmware is a
+ * no-op and a tuning change only writes the blocks that differ. Whoever
+ * resets or powers off the core must call invalidateCache().
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cirrus/hal/regmap.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+class BulkWriter;
+class Lz4Stream;
+
+struct DspRegion {
+    uint16_t type;
+    uint32_t base;
+};
+
+/* Algorithm entry from the firmware ID header; bases are in DSP words. */
+struct DspAlgorithm {
+    uint32_t id;
+    uint32_t version;
+    uint32_t xmBase;
+    uint32_t ymBase;
+    uint32_t zmBase;
+};
+
+class Dsp {
+public:
+    /* @regmap's regStride() must be 4 for a Halo core and 2 for ADSP1/ADSP2. */
+    Dsp(Regmap &regmap, uint8_t core, std::vector<DspRegion> regions, std::string name);
+
+    Regmap &regmap() const { return mRegmap; }
+    uint8_t core() const { return mCore; }
+    const std::string &name() const { return mName; }
+
+    /* Translate a word offset in a memory region to a register address. */
+    int regionToReg(uint16_t type, uint32_t offset, uint32_t *reg) const;
+
+    /*
+     * Write every memory and absolute region of @wmfw, unless it is already
+     * resident. The caller is responsible for holding the core in reset
+     * while a download runs; firmwareResident() tells whether one will.
+     */
+    int loadFirmware(const WmfwFile &wmfw);
+    bool firmwareResident(const WmfwFile &wmfw) const;
+
+    /*
+     * As above for an LZ4-compressed image, decoded one block at a time
+     * straight into the bus writer. Residency is keyed on the compressed
+     * image, so it does not match the same firmware loaded uncompressed.
+     */
+    int loadFirmware(Lz4Stream &wmfw);
+    bool firmwareResident(const Lz4Stream &wmfw) const;
+
+    /* Read the algorithm list the running firmware publishes in XM. */
+    int readAlgorithms();
+
+    /*
+     * Write @bin using the algorithm bases from readAlgorithms(). Blocks
+     * whose contents already match what was last written are skipped.
+     */
+    int loadCoefficients(const BinFile &bin);
+    int loadCoefficients(Lz4Stream &bin);
+
+    /* Forget what is resident, e.g. after a reset or loss of power. */
+    void invalidateCache();
+
+    uint32_t firmwareId() const { return mFwId; }
+    const std::vector<DspAlgorithm> &algorithms() const { return mAlgorithms; }
+    const DspAlgorithm *findAlgorithm(uint32_t id) const;
+
+    /*
+     * Translate a word offset in algorithm @algId's block of memory @type,
+     * using the bases from readAlgorithms().
+     */
+    int algorithmToReg(uint32_t algId, uint16_t type, uint32_t offset, uint32_t *reg) const;
+
+    /* Resolve a .bin block to its target register. */
+    int blockToReg(const BinBlock &blk, uint32_t *reg) const;
+
+private:
+    struct BlockRecord {
+        uint32_t len;
+        uint64_t hash;
+    };
+
+    struct LoadState {
+        std::vector<std::pair<uint32_t, BlockRecord>> written;
+        size_t skipped = 0;
+    };
+
+    void recordBlock(uint32_t reg, const BlockRecord &record);
+    int writeRegion(BulkWriter &writer, const WmfwRegion &region);
+    int streamRegion(BulkWriter &writer, Lz4Stream &stream, uint8_t type, uint32_t offset,
+                     uint32_t len);
+    int queueBlock(BulkWriter &writer, const BinBlock &blk, uint64_t hash, LoadState &state);
+    int finishCoefficients(BulkWriter &writer, const LoadState &state, const std::string &name);
+
+    /* Memory region types are small, so bases are indexed directly by type. */
+    static constexpr size_t kRegionTypes = wmfw::kHaloYmPacked + 1;
+    static constexpr uint32_t kNoRegion = UINT32_MAX;
+
+    Regmap &mRegmap;
+    uint8_t mCore;
+    std::array<uint32_t, kRegionTypes> mBases;
+    std::string mName;
+
+    uint32_t mFwId = 0;
+    std::vector<DspAlgorithm> mAlgorithms;
+
+    bool mFirmwareValid = false;
+    uint64_t mFirmwareHash = 0;
+    /* Coefficient blocks written since the firmware load, by register. */
+    std::map<uint32_t, BlockRecord> mBlocks;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,19 @@
+/*
+ * File helpers shared by the HAL's persistent formats.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace cirrus::hal {
+
+/*
+ * Replace @path with @len bytes of @data. The data is written to a
+ * temporary file, synced and renamed over @path, so readers that have the
+ * old file mapped keep a consistent view and a crash never leaves a torn
+ * file behind.
+ */
+int writeFileAtomic(const std::string &path, const void *data, size_t len);
+
+} // namespace cirrus::hal
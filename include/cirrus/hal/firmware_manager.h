@@ -0,0 +1,102 @@
+/*
+ * On-demand firmware loading per use case.
+ *
+ * Each use case declares the firmware and tuning it needs on which
+ * devices. Nothing is downloaded at boot: the first acquire() of a use
+ * case (normally when its first stream opens) downloads whatever is not
+ * already resident and powers the devices up, and the last release()
+ * powers them down again. When the need can be predicted, e.g. a call
+ * that is still ringing, prefetch() queues the downloads on the bus
+ * workers in the background, so the later acquire() only waits for the
+ * power-up. Devices shared by several active use cases must agree on
+ * their firmware.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/device.h"
+
+namespace cirrus::hal {
+
+class FirmwareManager {
+public:
+    explicit FirmwareManager(BusScheduler &scheduler);
+    /* Waits for queued downloads and power transitions. */
+    ~FirmwareManager();
+
+    FirmwareManager(const FirmwareManager &) = delete;
+    FirmwareManager &operator=(const FirmwareManager &) = delete;
+
+    /*
+     * Declare (or replace) what @useCase needs; -EBUSY while it is
+     * acquired. Devices must outlive the manager.
+     */
+    int declare(const std::string &useCase, std::vector<DeviceFirmware> needs);
+
+    /*
+     * Start downloading @useCase's firmware without powering anything up.
+     * Returns at once; devices held by another use case with different
+     * firmware are left alone.
+     */
+    int prefetch(const std::string &useCase);
+
+    /*
+     * Make sure every device @useCase needs has its firmware and is
+     * powered, blocking until it is. -EBUSY if an active use case holds
+     * one of the devices with different firmware. Calls nest.
+     */
+    int acquire(const std::string &useCase);
+
+    /* Drop one acquire(); devices nobody holds any more are powered down. */
+    int release(const std::string &useCase);
+
+    /* Firmware downloads issued so far, including prefetches. */
+    size_t downloads() const;
+
+private:
+    struct Slot {
+        /* Firmware a queued job will leave resident, empty if none. */
+        std::string wantWmfw;
+        std::string wantBin;
+        /* State as of the last job that ran on the device. */
+        std::string wmfw;
+        std::string bin;
+        bool powered = false;
+        unsigned users = 0;
+    };
+
+    struct UseCase {
+        std::vector<DeviceFirmware> needs;
+        unsigned acquired = 0;
+    };
+
+    struct Pending {
+        size_t left = 0;
+        int error = 0;
+    };
+
+    Slot &slotOf(Device *device) { return mSlots[device]; }
+    void submit(Device *device, bool power, const DeviceFirmware &need, Pending *pending);
+    void submitPowerDown(Device *device);
+    int bringUp(Device *device, bool power, const DeviceFirmware &need);
+    void finish(Pending *pending, int ret);
+    int releaseLocked(UseCase &useCase);
+
+    BusScheduler &mScheduler;
+
+    mutable std::mutex mLock;
+    std::condition_variable mDone;
+    std::map<std::string, UseCase> mUseCases;
+    std::map<Device *, Slot> mSlots;
+    size_t mQueued = 0;
+    size_t mDownloads = 0;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,106 @@
+/*
+ * Synchronised gain ramps across a group of amplifiers.
+ *
+ * A ramp is computed for every amp in the group up front, then played one
+ * step at a time on a pacing thread. Each step is issued to all buses at
+ * once through the BusScheduler and the next step only starts when every
+ * bus has finished the current one, so channels never drift apart by more
+ * than a step. On a bus with a broadcast Regmap (e.g. an I2C broadcast
+ * address the amps are configured to answer), a step that has the same
+ * value for every amp on that bus is a single write. Otherwise each amp
+ * costs one plain register write: the rest of the gain register is read
+ * once at the start of the ramp, so steps never read-modify-write.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/device.h"
+
+namespace cirrus::hal {
+
+class GainRamp {
+public:
+    static constexpr uint32_t kDefaultStepMs = 2;
+
+    /* Every amp in @amps must have a register gain field. */
+    GainRamp(BusScheduler &scheduler, std::vector<Device *> amps);
+    ~GainRamp();
+
+    GainRamp(const GainRamp &) = delete;
+    GainRamp &operator=(const GainRamp &) = delete;
+
+    /* Broadcast target for the amps on @bus; it must outlive the ramp. */
+    void setBroadcast(const std::string &bus, Regmap &regmap);
+
+    /*
+     * Ramp each amp from its current gain to targets[i] (in milli-dB) over
+     * @durationMs, in steps of @stepMs. Returns at once; -EBUSY while a
+     * ramp is running.
+     */
+    int start(const std::vector<int32_t> &targets, uint32_t durationMs,
+              uint32_t stepMs = kDefaultStepMs);
+    int start(int32_t target, uint32_t durationMs, uint32_t stepMs = kDefaultStepMs);
+
+    /* Stop after the current step; the amps keep the gain reached. */
+    void cancel() { mCancel.store(true); }
+
+    /* Block until the ramp ends. Returns its first error, or 0. */
+    int wait();
+
+    bool active() const { return mActive.load(); }
+
+    /* Bus writes issued by the last ramp, including broadcasts. */
+    size_t writes() const { return mWrites.load(); }
+
+private:
+    struct Amp {
+        Device *device;
+        const GainField *field;
+        /* Gain register with the gain field cleared. */
+        uint32_t base;
+        /* Register value last written or read. */
+        uint32_t last;
+        int32_t fromMdB;
+        int32_t toMdB;
+    };
+
+    struct Bus {
+        std::string name;
+        Regmap *broadcast = nullptr;
+        std::vector<size_t> amps;
+        /* Per-amp register values for the step being written. */
+        std::vector<uint32_t> vals;
+    };
+
+    void run(uint32_t steps, uint32_t stepMs);
+    int runOnBuses(const std::function<int(Bus &)> &job);
+    int prepare();
+    int writeStep(Bus &bus, uint32_t step, uint32_t steps);
+    uint32_t encode(const Amp &amp, int32_t mdB) const;
+
+    BusScheduler &mScheduler;
+    std::vector<Amp> mAmps;
+    std::vector<Bus> mBuses;
+
+    std::thread mThread;
+    std::atomic<bool> mActive{false};
+    std::atomic<bool> mCancel{false};
+    std::atomic<size_t> mWrites{0};
+    int mError = 0;
+    bool mSupported = true;
+
+    std::mutex mLock;
+    std::condition_variable mStepDone;
+    size_t mOutstanding = 0;
+};
+
+} // namespace cirrus::hal
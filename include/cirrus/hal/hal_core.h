@@ -0,0 +1,104 @@
+/*
+ * Device registry shared by concurrent HAL clients.
+ *
+ * The audio HAL, haptics HAL and calibration daemon can all reach the
+ * same devices. Each device registered here gets its own reader/writer
+ * lock: anything that touches the bus or changes device state takes it
+ * exclusively, while queries of cached state (descriptor, telemetry,
+ * resident firmware, algorithm list) share it. A long firmware download
+ * on one amp therefore only holds that amp; clients of other devices,
+ * on the same bus or another, never wait for it. The registry itself is
+ * only locked exclusively while devices are added or removed.
+ *
+ * The locks are opt-in. FirmwareManager, GainRamp, IrqMonitor and Mixer
+ * are built on a Device or ALSA card directly and never take them: they
+ * rely on BusScheduler ordering jobs per bus, not on these locks. A
+ * process whose devices are shared through a HalCore must drive them
+ * from inside lock() or submit(), or keep those helpers to devices no
+ * other client of the registry touches.
+ */
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/device.h"
+
+namespace cirrus::hal {
+
+class HalCore {
+    struct Node {
+        std::unique_ptr<Device> device;
+        std::shared_mutex lock;
+    };
+
+public:
+    /* Locked access to one device; empty if the device is not registered. */
+    template <typename Lock, typename D>
+    class Access {
+    public:
+        Access() = default;
+
+        explicit operator bool() const { return mNode != nullptr; }
+        D &operator*() const { return *mNode->device; }
+        D *operator->() const { return mNode->device.get(); }
+
+    private:
+        friend class HalCore;
+
+        explicit Access(std::shared_ptr<Node> node) : mNode(std::move(node)), mLock(mNode->lock) {}
+        Access(std::shared_ptr<Node> node, std::try_to_lock_t)
+            : mNode(std::move(node)), mLock(mNode->lock, std::try_to_lock)
+        {
+            if (!mLock.owns_lock())
+                mNode.reset();
+        }
+
+        std::shared_ptr<Node> mNode;
+        Lock mLock;
+    };
+
+    using DeviceLock = Access<std::unique_lock<std::shared_mutex>, Device>;
+    using DeviceReadLock = Access<std::shared_lock<std::shared_mutex>, const Device>;
+
+    /* Called on the bus worker with the device locked exclusively. */
+    using Job = std::function<int(Device &device)>;
+
+    HalCore() = default;
+
+    HalCore(const HalCore &) = delete;
+    HalCore &operator=(const HalCore &) = delete;
+
+    /* Register @device under its name; -EEXIST if the name is taken. */
+    int addDevice(std::unique_ptr<Device> device);
+    /* Unregister @name once no client holds it; -ENODEV if unknown. */
+    int removeDevice(const std::string &name);
+    std::vector<std::string> deviceNames() const;
+
+    /* Block until @name is free, then hold it exclusively. */
+    DeviceLock lock(const std::string &name) const;
+    /* As lock(), but empty instead of waiting if another client holds it. */
+    DeviceLock tryLock(const std::string &name) const;
+    /* Hold @name for queries that do not touch the bus. */
+    DeviceReadLock lockShared(const std::string &name) const;
+
+    /*
+     * Queue @job on @name's bus worker; the device lock is taken when the
+     * job runs, not while it waits. -ENODEV if @name is not registered.
+     */
+    int submit(BusScheduler &scheduler, const std::string &name, Job job) const;
+
+private:
+    std::shared_ptr<Node> find(const std::string &name) const;
+
+    mutable std::shared_mutex mRegistryLock;
+    std::map<std::string, std::shared_ptr<Node>> mDevices;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,87 @@
+/*
+ * Streaming playback of PCM or PWLE haptic waveforms on CS40L2x parts.
+ *
+ * The firmware exposes a ring of 24-bit words in XM that it plays from,
+ * together with a host-owned write index and a firmware-owned read index.
+ * The ring is treated as two halves: play() writes only the first chunk,
+ * starts playback straight away and hands the rest of the waveform to a
+ * feeder thread that refills each half as the firmware drains it. The
+ * host-side staging buffers and the bus writer's queue are sized once,
+ * when the stream is created, so refills never allocate.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+struct HapticStreamConfig {
+    /* Ring in unpacked XM, one 24-bit word per register. */
+    uint32_t ringReg;
+    uint32_t ringWords;
+    uint32_t writeIndexReg;
+    uint32_t readIndexReg;
+    /* Written to start and stop playback. */
+    uint32_t controlReg;
+    uint32_t startValue;
+    uint32_t stopValue;
+    /* Playback rate in words per second, used to pace refills; not 0. */
+    uint32_t rate;
+};
+
+class HapticStream {
+public:
+    /*
+     * Produce up to @max words of waveform into @words; return the number
+     * produced, 0 at the end of the waveform.
+     */
+    using Source = std::function<size_t(int32_t *words, size_t max)>;
+
+    /* @firstChunk words are written before playback starts. */
+    HapticStream(Regmap &regmap, const HapticStreamConfig &config, size_t firstChunk);
+    ~HapticStream();
+
+    HapticStream(const HapticStream &) = delete;
+    HapticStream &operator=(const HapticStream &) = delete;
+
+    /*
+     * Start playing @source. Returns once the first chunk is playing, or
+     * -EINVAL if the configured rate is 0.
+     */
+    int play(Source source);
+    /* Stop playback and wait for the feeder to exit. */
+    int stop();
+
+    bool active() const { return mActive.load(); }
+    /* Times the feeder fell behind the firmware since play(). */
+    size_t underruns() const { return mUnderruns.load(); }
+
+private:
+    int fill(size_t words, bool *done);
+    void feed();
+
+    Regmap &mRegmap;
+    BulkWriter mWriter;
+    HapticStreamConfig mConfig;
+    size_t mFirstChunk;
+
+    Source mSource;
+    std::vector<int32_t> mSamples;
+    std::vector<uint8_t> mStage;
+    uint32_t mWriteIndex = 0;
+
+    std::thread mFeeder;
+    std::atomic<bool> mActive{false};
+    std::atomic<bool> mStopping{false};
+    std::atomic<size_t> mUnderruns{0};
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,106 @@
+/*
+ * Effect playback for CS40L2x haptic drivers.
+ *
+ * Effects come from a precompiled Wavetable that is mapped and indexed
+ * once, when it is loaded, and stays cached across triggers. Triggering an
+ * effect uploads its payload into the firmware's effect slot, unless the
+ * slot already holds it, then writes the trigger command.
+ *
+ * Composed effects (primitives with amplitudes, repeats and gaps) are
+ * compiled on the host into one composite program, cached under a hash
+ * of the composition and played by the firmware from a single trigger,
+ * so their timing no longer depends on host scheduling.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cirrus/hal/regmap.h"
+#include "cirrus/hal/wavetable.h"
+
+namespace cirrus::hal {
+
+struct HapticsConfig {
+    /* Firmware RAM that plays uploaded effects. */
+    uint32_t slotReg;
+    uint32_t slotBytes;
+    /* Register that starts playback of the effect slot. */
+    uint32_t triggerReg;
+    uint32_t triggerValue;
+};
+
+/* One section of a composite effect; packs to 6 bytes with no padding. */
+struct HapticPrimitive {
+    /* Firmware wavetable entry to play. */
+    uint8_t index;
+    /* Percent of full scale, 0-100. */
+    uint8_t amplitude;
+    /* Extra plays of this section. */
+    uint8_t repeat;
+    uint8_t flags;
+    /* Silence after the section, in milliseconds. */
+    uint16_t delayMs;
+};
+
+struct HapticComposition {
+    std::vector<HapticPrimitive> sections;
+    /* Extra plays of the whole sequence. */
+    uint8_t repeat = 0;
+};
+
+/*
+ * Compile @composition into composite program words, in the CS40L2x
+ * section layout: a header word (repeat << 8 | section count), then two
+ * words per section (amplitude << 16 | index << 8 | repeat, and
+ * flags << 16 | delay).
+ */
+int compileComposition(const HapticComposition &composition, std::vector<int32_t> *words);
+
+uint64_t compositionHash(const HapticComposition &composition);
+
+class Haptics {
+public:
+    Haptics(Regmap &regmap, const HapticsConfig &config);
+
+    Regmap &regmap() const { return mRegmap; }
+    const HapticsConfig &config() const { return mConfig; }
+
+    int loadWavetable(const std::string &path);
+    const Wavetable &wavetable() const { return mWavetable; }
+
+    /* Play effect @index from the wavetable. */
+    int perform(uint32_t index);
+
+    /*
+     * Play @composition with one trigger, compiling it on first use. If the
+     * slot already holds it, this is a single register write.
+     */
+    int perform(const HapticComposition &composition);
+
+    /* Forget the slot contents, e.g. after a DSP reset. */
+    void invalidate() { mLoaded = false; }
+
+    /* Compiled programs kept for reuse. */
+    size_t programs() const { return mPrograms.size(); }
+
+private:
+    static constexpr size_t kMaxPrograms = 64;
+
+    int upload(ByteView data);
+
+    Regmap &mRegmap;
+    HapticsConfig mConfig;
+    Wavetable mWavetable;
+
+    /* What the slot holds: a wavetable index, or a program hash. */
+    bool mLoaded = false;
+    bool mLoadedProgram = false;
+    uint64_t mLoadedKey = 0;
+
+    std::unordered_map<uint64_t, std::vector<uint8_t>> mPrograms;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,106 @@
+/*
+ * Event-driven interrupt handling.
+ *
+ * Device status registers are only read when an interrupt source fires:
+ * a sysfs attribute (e.g. a GPIO "value" configured for edges), a kernel
+ * uevent, or any readable descriptor such as an eventfd signalled by a
+ * driver shim. One monitor thread sleeps in poll() on all of them. When a
+ * source fires, the status registers named in the device's descriptor are
+ * read and acknowledged on the device's bus worker, so this never races
+ * other bus work, and handlers subscribed to each pending event are run.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cirrus/hal/bus_scheduler.h"
+#include "cirrus/hal/device.h"
+
+namespace cirrus::hal {
+
+const char *irqEventName(IrqEvent event);
+
+class IrqMonitor {
+public:
+    /* Runs on the device's bus worker; must not block. */
+    using Handler = std::function<void(Device &device, IrqEvent event)>;
+
+    explicit IrqMonitor(BusScheduler &scheduler);
+    ~IrqMonitor();
+
+    IrqMonitor(const IrqMonitor &) = delete;
+    IrqMonitor &operator=(const IrqMonitor &) = delete;
+
+    /*
+     * Sources are registered before start(). addSysfs() opens @path and
+     * waits for POLLPRI; addUevent() matches uevents with a field equal to
+     * @match (e.g. "DRIVER=cs35l41"); addFd() drains a readable @fd, which
+     * stays owned by the caller.
+     */
+    int addSysfs(Device &device, const std::string &path);
+    int addUevent(Device &device, const std::string &match);
+    int addFd(Device &device, int fd);
+
+    /* May be called at any time; handlers run in subscription order. */
+    void subscribe(IrqEvent event, Handler handler);
+
+    int start();
+    void stop();
+
+    /* Service @device as if its interrupt had fired. */
+    void trigger(Device &device);
+
+    uint64_t count(IrqEvent event) const
+    {
+        return mCounts[static_cast<size_t>(event)].load(std::memory_order_relaxed);
+    }
+
+private:
+    enum class SourceKind : uint8_t { kSysfs, kUevent, kFd };
+
+    struct Target {
+        Device *device;
+        /* Set while a service job is queued, so bursts coalesce. */
+        std::atomic<bool> queued{false};
+    };
+
+    struct Source {
+        SourceKind kind;
+        int fd;
+        bool owned;
+        Target *target;
+        std::string match;
+    };
+
+    Target *targetFor(Device &device);
+    bool drain(const Source &source);
+    void service(Target *target);
+    void dispatch(Device &device, IrqEvent event);
+    void run();
+
+    BusScheduler &mScheduler;
+    std::mutex mJobLock;
+    std::condition_variable mJobsIdle;
+    size_t mJobs = 0;
+
+    std::vector<std::unique_ptr<Target>> mTargets;
+    std::vector<Source> mSources;
+
+    std::mutex mHandlerLock;
+    std::vector<Handler> mHandlers[static_cast<size_t>(IrqEvent::kCount)];
+    std::atomic<uint64_t> mCounts[static_cast<size_t>(IrqEvent::kCount)] = {};
+
+    int mWakeFd = -1;
+    std::atomic<bool> mRunning{false};
+    std::thread mThread;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,138 @@
+/*
+ * I/V sense and temperature capture through an mmap'd ALSA PCM.
+ *
+ * The amps' sense data (voltage, current and temperature channels, as
+ * routed by the codec driver's capture DAI) is captured into the kernel's
+ * DMA buffer, which is mapped straight into the process together with the
+ * stream's status and control pages. Nothing copies the samples: each
+ * IvReader keeps its own position and is handed pointers into the mapped
+ * buffer. Readers take no locks and make no syscalls except to sleep in
+ * wait(), so any number can attach without disturbing playback or each
+ * other.
+ *
+ * The stream is configured never to stop on overrun. A reader that falls
+ * more than a buffer behind loses data; release() reports it and the
+ * reader resynchronises to the newest period.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct snd_pcm_mmap_status;
+struct snd_pcm_mmap_control;
+
+namespace cirrus::hal {
+
+struct IvCaptureConfig {
+    enum Format : uint8_t {
+        kS16,
+        kS32,
+    };
+
+    unsigned card;
+    unsigned device;
+    unsigned channels;
+    unsigned rate;
+    Format format;
+    unsigned periodFrames;
+    unsigned periods;
+};
+
+class IvCapture {
+public:
+    IvCapture() = default;
+    ~IvCapture();
+
+    IvCapture(const IvCapture &) = delete;
+    IvCapture &operator=(const IvCapture &) = delete;
+
+    /* Open, configure and map /dev/snd/pcmC<card>D<device>c. */
+    int open(const IvCaptureConfig &config);
+    void close();
+
+    int start();
+    int stop();
+
+    const IvCaptureConfig &config() const { return mConfig; }
+    size_t frameBytes() const { return mFrameBytes; }
+    size_t bufferFrames() const { return mBufferFrames; }
+    /* Positions run from 0 to boundary() - 1 and then wrap. */
+    size_t boundary() const { return mBoundary; }
+
+    /*
+     * Frames the hardware has written, modulo boundary(). Lock-free and
+     * syscall-free when the status page could be mapped; otherwise it is
+     * fetched with SNDRV_PCM_IOCTL_SYNC_PTR.
+     */
+    size_t position() const;
+
+    const uint8_t *frame(size_t pos) const
+    {
+        return mBuffer + pos % mBufferFrames * mFrameBytes;
+    }
+
+    /*
+     * Sleep until at least a period beyond the current position has been
+     * captured, or @timeoutMs passes. Returns 0, -ETIMEDOUT or -errno.
+     */
+    int wait(int timeoutMs) const;
+
+private:
+    int setHwParams();
+    int setSwParams();
+    int mapBuffers();
+
+    IvCaptureConfig mConfig = {};
+    int mFd = -1;
+    size_t mFrameBytes = 0;
+    size_t mBufferFrames = 0;
+    size_t mBoundary = 0;
+
+    uint8_t *mBuffer = nullptr;
+    size_t mBufferBytes = 0;
+    volatile struct snd_pcm_mmap_status *mStatus = nullptr;
+    volatile struct snd_pcm_mmap_control *mControl = nullptr;
+    bool mSyncPtr = false;
+};
+
+class IvReader {
+public:
+    /* Attach at the newest captured frame; @capture must be open. */
+    explicit IvReader(const IvCapture &capture);
+
+    /*
+     * Point @data at the oldest unread frames and return how many there
+     * are, up to the end of the buffer (call again after release() for
+     * the part that wraps). If the reader has already been overrun it
+     * first skips ahead to the newest period. Real-time safe.
+     */
+    size_t acquire(const uint8_t **data);
+
+    /*
+     * Consume @frames. Returns false if the capture overran the reader
+     * while it held them, i.e. the data may have been overwritten; the
+     * reader then skips ahead to the newest period.
+     */
+    bool release(size_t frames);
+
+    /* Frames waiting, capped at what the DMA cannot yet be overwriting. */
+    size_t available() const;
+
+    size_t overruns() const { return mOverruns; }
+
+    int wait(int timeoutMs) const { return mCapture.wait(timeoutMs); }
+
+private:
+    size_t lag(size_t hw) const;
+    /* Most frames a reader can trail by before the DMA reaches them. */
+    size_t limit() const;
+    void resync(size_t hw);
+
+    const IvCapture &mCapture;
+    size_t mPos;
+    size_t mOverruns = 0;
+};
+
+} // namespace cirrus::hal
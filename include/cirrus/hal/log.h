@@ -0,0 +1,40 @@
+/*
+ * Logging helpers for the Cirrus Logic HAL.
+ *
+ * On Android the macros forward to liblog so messages land in logcat under
+ * the caller's LOG_TAG. Host builds print to stderr instead, filtered by
+ * logSetLevel().
+ */
+#pragma once
+
+#ifndef LOG_TAG
+#define LOG_TAG "cirrus-hal"
+#endif
+
+#if defined(__ANDROID__)
+
+#include <log/log.h>
+
+#define CIRRUS_LOGE(...) ALOGE(__VA_ARGS__)
+#define CIRRUS_LOGW(...) ALOGW(__VA_ARGS__)
+#define CIRRUS_LOGI(...) ALOGI(__VA_ARGS__)
+#define CIRRUS_LOGD(...) ALOGD(__VA_ARGS__)
+
+#else
+
+namespace cirrus::hal {
+
+void logPrint(char level, const char *tag, const char *fmt, ...)
+        __attribute__((format(printf, 3, 4)));
+
+/* Drop messages less severe than @level ('E', 'W', 'I' or 'D'). */
+void logSetLevel(char level);
+
+} // namespace cirrus::hal
+
+#define CIRRUS_LOGE(...) ::cirrus::hal::logPrint('E', LOG_TAG, __VA_ARGS__)
+#define CIRRUS_LOGW(...) ::cirrus::hal::logPrint('W', LOG_TAG, __VA_ARGS__)
+#define CIRRUS_LOGI(...) ::cirrus::hal::logPrint('I', LOG_TAG, __VA_ARGS__)
+#define CIRRUS_LOGD(...) ::cirrus::hal::logPrint('D', LOG_TAG, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * Streaming decoder for LZ4-framed firmware and tuning images.
+ *
+ * A compressed .wmfw or .bin (as written by `lz4`, conventionally named
+ * *.wmfw.lz4 / *.bin.lz4) is mapped whole, but only decoded one LZ4 block
+ * at a time into a buffer the size of the frame's maximum block, plus the
+ * 64 KiB history window when blocks are linked. The loaders in Dsp take
+ * views straight out of that buffer and hand them to the BulkWriter, so
+ * the decompressed image never exists in memory in full.
+ *
+ * The frame header and any block checksums are verified before a block
+ * is used. The content checksum can only be checked at the end of the
+ * frame, after the data has been written, so a mismatch fails the load
+ * instead of preventing it. Residency is keyed on the XXH64 of the
+ * compressed frame. Dictionaries are not supported.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/mapped_file.h"
+
+namespace cirrus::hal {
+
+/* True if @image starts with the LZ4 frame magic. */
+bool isLz4Frame(ByteView image);
+
+class Lz4Stream {
+public:
+    /* Runs before a new block overwrites the buffer; returns 0 or an errno. */
+    using BlockHook = std::function<int()>;
+
+    /* Map and open the frame in @path. Returns 0 or a negative errno. */
+    int open(const std::string &path);
+    /* Decode a frame owned by the caller; it must outlive this object. */
+    int parse(ByteView frame);
+
+    const std::string &name() const { return mName; }
+    void setName(std::string name) { mName = std::move(name); }
+    ByteView image() const { return mImage; }
+    /* XXH64 of the compressed frame, computed on first use. */
+    uint64_t hash() const;
+
+    /* Set the hook, e.g. to flush a BulkWriter still borrowing views. */
+    void setBlockHook(BlockHook hook) { mHook = std::move(hook); }
+
+    /*
+     * Decoded bytes not yet consumed, up to the end of the current block,
+     * decoding the next block when the current one is used up. Empty at
+     * the end of the frame. Views stay valid until the next block is
+     * decoded.
+     */
+    int peek(ByteView *data);
+    void consume(size_t len) { mPos += len; }
+
+    /* Copy up to @len bytes across blocks; returns the count or an errno. */
+    int read(void *data, size_t len);
+    /* Discard exactly @len bytes; -EINVAL if the frame ends first. */
+    int skip(size_t len);
+
+    /* Decoded bytes consumed so far. */
+    uint64_t position() const { return mConsumed + mPos - mStart; }
+
+private:
+    int decodeBlock();
+
+    MappedFile mFile;
+    ByteView mImage;
+    std::string mName;
+    BlockHook mHook;
+    mutable uint64_t mHash = 0;
+    mutable bool mHashValid = false;
+
+    /* Compressed input position and frame flags. */
+    size_t mIn = 0;
+    bool mLinked = false;
+    bool mBlockChecksum = false;
+    bool mContentChecksum = false;
+    bool mEnded = true;
+    Xxh32 mContentHash;
+
+    /* History window (linked blocks only) followed by the current block. */
+    std::vector<uint8_t> mBuf;
+    size_t mStart = 0;
+    size_t mEnd = 0;
+    size_t mPos = 0;
+    uint64_t mConsumed = 0;
+};
+
+} // namespace cirrus::hal
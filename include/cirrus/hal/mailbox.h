@@ -0,0 +1,81 @@
+/*
+ * Host-to-DSP command mailbox.
+ *
+ * Commands (haptic play/stop, protection mode changes, calibration
+ * triggers) are queued with post() and sent by flush(). Firmware that
+ * exposes a command queue in DSP memory is fed in pipelined mode: every
+ * queued command is written into the ring in one burst and published with
+ * a single write index update, without waiting for acks in between. The
+ * read index is only fetched again when the cached copy says the ring is
+ * full. Firmware with only the single-register mailbox gets one write and
+ * ack poll per command.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+struct MailboxConfig {
+    /* Command ring in DSP memory; queueWords == 0 selects single-register mode. */
+    uint32_t queueReg;
+    uint32_t queueWords;
+    /* Ring indices, in words. The host owns the write index. */
+    uint32_t writeIndexReg;
+    uint32_t readIndexReg;
+    /*
+     * Single-register mode: commands are written here and the firmware
+     * clears it to acknowledge. Pipelined mode: optional doorbell, written
+     * with doorbellValue after each flush when not 0.
+     */
+    uint32_t mailboxReg;
+    uint32_t doorbellValue;
+    uint32_t ackTimeoutUs;
+};
+
+class Mailbox {
+public:
+    Mailbox(Regmap &regmap, const MailboxConfig &config);
+
+    Mailbox(const Mailbox &) = delete;
+    Mailbox &operator=(const Mailbox &) = delete;
+
+    const MailboxConfig &config() const { return mConfig; }
+
+    /* Queue @command to go out with the next flush(). */
+    void post(uint32_t command) { mPending.push_back(command); }
+    size_t pending() const { return mPending.size(); }
+
+    /*
+     * Send every queued command. Commands that could not be written stay
+     * queued for the next flush. In single-register mode a command that
+     * was written but not acknowledged is dropped, not retried, and the
+     * error (e.g. -ETIMEDOUT) is returned.
+     */
+    int flush();
+
+    /* Flush, then wait until the firmware has consumed everything sent. */
+    int sync();
+
+    /* Drop the cached ring state, e.g. after the firmware restarts. */
+    void invalidate() { mSynced = false; }
+
+private:
+    int flushQueue();
+    int flushRegister();
+    int readIndex(uint32_t *index);
+    int waitForSpace(size_t *space);
+
+    Regmap &mRegmap;
+    MailboxConfig mConfig;
+    std::vector<uint32_t> mPending;
+
+    bool mSynced = false;
+    uint32_t mWriteIndex = 0;
+    uint32_t mReadIndex = 0;
+};
+
+} // namespace cirrus::hal
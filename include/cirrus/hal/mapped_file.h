@@ -0,0 +1,48 @@
+/*
+ * Read-only memory mapping of a firmware or tuning file.
+ *
+ * The mapping is private and never written, so pages are shared with the
+ * page cache and released as soon as the object goes away.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cirrus::hal {
+
+/* Borrowed view of bytes owned by someone else, typically a MappedFile. */
+struct ByteView {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    ByteView sub(size_t offset, size_t len) const { return {data + offset, len}; }
+};
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /* Map @path read-only. Returns 0 or a negative errno. */
+    int open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return mData != nullptr; }
+    ByteView view() const { return {mData, mSize}; }
+    const std::string &path() const { return mPath; }
+
+private:
+    const uint8_t *mData = nullptr;
+    size_t mSize = 0;
+    std::string mPath;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,63 @@
+/*
+ * Minimal ALSA control interface over /dev/snd/controlC<card>.
+ *
+ * Controls are enumerated once into a ControlTable and then addressed by
+ * numid, so a name lookup never goes back to the kernel. Call refresh()
+ * after loading DSP firmware, which adds and removes coefficient controls.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "cirrus/hal/control_table.h"
+
+namespace cirrus::hal {
+
+class Mixer {
+public:
+    Mixer() = default;
+    ~Mixer();
+
+    Mixer(const Mixer &) = delete;
+    Mixer &operator=(const Mixer &) = delete;
+
+    int open(unsigned card);
+    void close();
+
+    /* Re-enumerate the card's controls. */
+    int refresh();
+
+    const ControlInfo *find(std::string_view name, uint32_t index = 0) const
+    {
+        return mControls.find(name, index);
+    }
+
+    /*
+     * Integer, boolean and enumerated controls, @count values. Elements
+     * past @count keep their current value.
+     */
+    int setValues(const ControlInfo &ctl, const long *values, size_t count);
+    int getValues(const ControlInfo &ctl, long *values, size_t count);
+
+    /*
+     * Byte controls, including TLV-backed DSP coefficient controls. A
+     * short non-TLV write keeps the bytes past @len.
+     */
+    int setBytes(const ControlInfo &ctl, const void *data, size_t len);
+    int getBytes(const ControlInfo &ctl, void *data, size_t len);
+
+    /* Convenience for single-value controls; sets element 0 only. */
+    int set(std::string_view name, long value);
+
+    const ControlTable &controls() const { return mControls; }
+
+private:
+    int tlv(unsigned long request, const ControlInfo &ctl, void *data, size_t len);
+
+    int mFd = -1;
+    ControlTable mControls;
+};
+
+} // namespace cirrus::hal
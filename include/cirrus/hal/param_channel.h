@@ -0,0 +1,97 @@
+/*
+ * Non-blocking parameter updates from the audio thread.
+ *
+ * The render path posts gain, mute and tuning changes into a lock-free
+ * ring; a dedicated control thread drains it, keeps only the latest value
+ * for each control element and writes every touched control once. post()
+ * takes no lock, and it only makes a syscall (a non-blocking eventfd
+ * write) when the control thread is asleep.
+ *
+ * Each write reads the control back first and merges in only the
+ * posted elements, so the rest keep whatever another client, a firmware
+ * reload or the kernel left there. If that read fails, the control's
+ * pending updates are dropped rather than written over unknown values.
+ *
+ * The control thread is the only user of the Mixer while it runs.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "cirrus/hal/mixer.h"
+#include "cirrus/hal/spsc_ring.h"
+
+namespace cirrus::hal {
+
+struct ParamUpdate {
+    enum Kind : uint8_t {
+        /* value[element] of an integer, boolean or enumerated control */
+        kValue,
+        /* Big-endian 32-bit word @element of a byte (coefficient) control */
+        kWord,
+    };
+
+    ControlInfo ctl;
+    Kind kind;
+    uint32_t element;
+    long value;
+};
+
+class ParamChannel {
+public:
+    static constexpr size_t kRingSize = 256;
+
+    ParamChannel();
+    ~ParamChannel();
+
+    ParamChannel(const ParamChannel &) = delete;
+    ParamChannel &operator=(const ParamChannel &) = delete;
+
+    int start(Mixer &mixer);
+    void stop();
+
+    /* Real-time safe. Returns false if the ring is full. */
+    bool post(const ParamUpdate &update);
+    bool setValue(const ControlInfo &ctl, long value, uint32_t element = 0);
+    bool setWord(const ControlInfo &ctl, uint32_t word, uint32_t element = 0);
+
+    /* Updates rejected because the ring was full. */
+    size_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+private:
+    /* Posted values of one control since its last write. */
+    struct Shadow {
+        ControlInfo ctl;
+        bool dirty = false;
+        std::vector<long> values;
+        std::vector<uint8_t> bytes;
+        /* Per element, or per word of a byte control. */
+        std::vector<bool> posted;
+    };
+
+    void run();
+    void apply(const ParamUpdate &update);
+    int writeBack(Shadow &shadow);
+    int flush();
+    void wake();
+
+    Mixer *mMixer = nullptr;
+    int mEventFd = -1;
+    std::thread mThread;
+    std::atomic<bool> mRunning{false};
+    std::atomic<bool> mSleeping{false};
+    std::atomic<size_t> mDropped{0};
+
+    SpscRing<ParamUpdate, kRingSize> mRing;
+    /* Control-thread only. */
+    std::map<uint32_t, Shadow> mShadows;
+    std::vector<Shadow *> mDirty;
+    std::vector<long> mCurrentValues;
+    std::vector<uint8_t> mCurrentBytes;
+};
+
+} // namespace cirrus::hal
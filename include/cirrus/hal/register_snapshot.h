@@ -0,0 +1,59 @@
+/*
+ * Compact register state captured on suspend and restored on resume.
+ *
+ * A snapshot keeps only the registers that differ from their reset value,
+ * plus any ranges of DSP state captured verbatim, as runs of consecutive
+ * registers in device byte order. restore() writes them all through one
+ * BulkWriter, so adjacent runs merge and the whole state goes back in a
+ * handful of bus transactions instead of replaying the register writes,
+ * firmware parsing and tuning that produced it. A short stretch of default
+ * registers between two changed ones is kept in the run: rewriting a reset
+ * value is harmless and cheaper than starting another transaction.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+class RegisterSnapshot {
+public:
+    /* Default registers kept inside a run rather than splitting it. */
+    static constexpr size_t kMaxFill = 2;
+
+    void clear();
+
+    /*
+     * Read the registers in @defaults, which must be in ascending address
+     * order, and keep those that differ from their reset value.
+     */
+    int captureRegisters(Regmap &regmap, Table<RegDefault> defaults);
+    /* Keep @len bytes at @reg as they are, e.g. firmware state in XM. */
+    int captureRange(Regmap &regmap, uint32_t reg, uint32_t len);
+
+    /* Write everything back in capture order, coalesced. */
+    int restore(Regmap &regmap) const;
+
+    bool empty() const { return mRuns.empty(); }
+    size_t runs() const { return mRuns.size(); }
+    size_t bytes() const { return mData.size(); }
+
+private:
+    struct Run {
+        uint32_t reg;
+        uint32_t offset;
+        uint32_t len;
+    };
+
+    void append(uint32_t reg, const uint8_t *data, size_t len);
+
+    std::vector<Run> mRuns;
+    std::vector<uint8_t> mData;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,125 @@
+/*
+ * Register map abstraction used for all device access.
+ *
+ * Registers are addressed the way the device datasheet numbers them and
+ * raw data is always in device (big-endian) byte order, which is also the
+ * order DSP payloads are stored in firmware files.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cirrus::hal {
+
+class Regmap {
+public:
+    virtual ~Regmap() = default;
+
+    virtual int read(uint32_t reg, uint32_t *val) = 0;
+    virtual int write(uint32_t reg, uint32_t val) = 0;
+
+    /*
+     * Transfer @len bytes starting at @reg in a single bus transaction.
+     * @len must be a multiple of valBytes() and no larger than maxRawWrite().
+     */
+    virtual int rawRead(uint32_t reg, void *data, size_t len) = 0;
+    virtual int rawWrite(uint32_t reg, const void *data, size_t len) = 0;
+
+    /* Largest payload one rawWrite() may carry on this bus. */
+    virtual size_t maxRawWrite() const = 0;
+
+    /* Bytes per register and address increment between registers. */
+    virtual unsigned valBytes() const { return 4; }
+    virtual unsigned regStride() const { return 4; }
+
+    /* Address of the register @bytes into a raw transfer starting at @reg. */
+    uint32_t advance(uint32_t reg, size_t bytes) const
+    {
+        return reg + static_cast<uint32_t>(bytes / valBytes() * regStride());
+    }
+
+    int updateBits(uint32_t reg, uint32_t mask, uint32_t val);
+};
+
+/*
+ * Register access through i2c-dev, using the 32-bit address / 32-bit value
+ * big-endian protocol of Halo Core parts. Each rawWrite() is one I2C_RDWR.
+ */
+class I2cRegmap : public Regmap {
+public:
+    static constexpr size_t kDefaultMaxWrite = 4096;
+
+    I2cRegmap() = default;
+    ~I2cRegmap() override;
+
+    I2cRegmap(const I2cRegmap &) = delete;
+    I2cRegmap &operator=(const I2cRegmap &) = delete;
+
+    /*
+     * Open @dev (e.g. "/dev/i2c-2") for the device at @addr. @maxWrite caps
+     * the transfer size for controllers with a limited FIFO or DMA length.
+     */
+    int open(const std::string &dev, uint16_t addr, size_t maxWrite = kDefaultMaxWrite);
+    void close();
+
+    int read(uint32_t reg, uint32_t *val) override;
+    int write(uint32_t reg, uint32_t val) override;
+    int rawRead(uint32_t reg, void *data, size_t len) override;
+    int rawWrite(uint32_t reg, const void *data, size_t len) override;
+    size_t maxRawWrite() const override { return mMaxWrite; }
+    unsigned regStride() const override { return mRegStride; }
+
+    /* Address step per register: 4 on Halo Core parts, 2 on ADSP2 parts. */
+    void setRegStride(unsigned stride) { mRegStride = stride; }
+
+private:
+    int mFd = -1;
+    uint16_t mAddr = 0;
+    unsigned mRegStride = 4;
+    size_t mMaxWrite = kDefaultMaxWrite;
+    std::vector<uint8_t> mTxBuf;
+};
+
+/*
+ * Register access through spidev. Halo Core SPI framing is a 32-bit address
+ * with bit 31 set for reads, 16 bits of padding, then big-endian data.
+ */
+class SpiRegmap : public Regmap {
+public:
+    static constexpr size_t kDefaultMaxWrite = 4096;
+
+    SpiRegmap() = default;
+    ~SpiRegmap() override;
+
+    SpiRegmap(const SpiRegmap &) = delete;
+    SpiRegmap &operator=(const SpiRegmap &) = delete;
+
+    /* Open @dev (e.g. "/dev/spidev1.0"). @maxWrite as for I2cRegmap. */
+    int open(const std::string &dev, uint32_t speedHz, size_t maxWrite = kDefaultMaxWrite);
+    void close();
+
+    int read(uint32_t reg, uint32_t *val) override;
+    int write(uint32_t reg, uint32_t val) override;
+    int rawRead(uint32_t reg, void *data, size_t len) override;
+    int rawWrite(uint32_t reg, const void *data, size_t len) override;
+    size_t maxRawWrite() const override { return mMaxWrite; }
+    unsigned regStride() const override { return mRegStride; }
+
+    /* As for I2cRegmap. */
+    void setRegStride(unsigned stride) { mRegStride = stride; }
+
+private:
+    int transfer(size_t len);
+
+    int mFd = -1;
+    uint32_t mSpeedHz = 0;
+    unsigned mRegStride = 4;
+    size_t mMaxWrite = kDefaultMaxWrite;
+    std::vector<uint8_t> mTxBuf;
+    std::vector<uint8_t> mRxBuf;
+};
+
+} // namespace cirrus::hal
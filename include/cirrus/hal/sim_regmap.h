@@ -0,0 +1,98 @@
+/*
+ * In-process simulation of an I2C/SPI attached Halo Core device.
+ *
+ * Registers and DSP memory are backed by a sparse 32-bit word store, so
+ * firmware downloads and read-backs behave like the real part. Each
+ * transaction is charged a configurable latency, either on a virtual
+ * clock (deterministic, for measuring transaction counts and bus time) or
+ * by actually sleeping (for exercising the scheduler's concurrency).
+ * Bursts larger than the configured limit are rejected, and failures can
+ * be injected by transaction number or address range. Registers are 4
+ * bytes apart by default; ADSP2 parts step their addresses by 2.
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+struct SimBusConfig {
+    /* Fixed cost of every transaction, e.g. start/address/stop on I2C. */
+    uint64_t transactionNs = 0;
+    /* Cost per payload byte, e.g. 9 bit times on I2C. */
+    uint64_t byteNs = 0;
+    size_t maxBurst = 4096;
+    /* Sleep for the simulated time instead of only accounting for it. */
+    bool realTime = false;
+};
+
+class SimRegmap : public Regmap {
+public:
+    explicit SimRegmap(const SimBusConfig &config = {}, unsigned regStride = 4);
+
+    int read(uint32_t reg, uint32_t *val) override;
+    int write(uint32_t reg, uint32_t val) override;
+    int rawRead(uint32_t reg, void *data, size_t len) override;
+    int rawWrite(uint32_t reg, const void *data, size_t len) override;
+    size_t maxRawWrite() const override { return mConfig.maxBurst; }
+    unsigned regStride() const override { return mRegStride; }
+
+    void setConfig(const SimBusConfig &config);
+
+    /* Direct access to the backing store; not charged or counted. */
+    uint32_t peek(uint32_t reg) const;
+    void poke(uint32_t reg, uint32_t val);
+    void clear();
+
+    /* Fail transaction number @nth (1-based, counted from now) with @err. */
+    void failTransaction(size_t nth, int err = -EIO);
+    /* Fail every transaction touching [@first, @last] with @err. */
+    void failRange(uint32_t first, uint32_t last, int err = -EIO);
+    void clearFailures();
+
+    size_t transactions() const;
+    size_t bytesWritten() const;
+    size_t bytesRead() const;
+    /* Simulated time spent on the bus. */
+    uint64_t busNs() const;
+    void resetStats();
+
+private:
+    static constexpr unsigned kPageShift = 12;
+
+    /* Account for one transfer; @ns is set to how long to occupy the bus. */
+    int transact(uint32_t reg, size_t len, bool write, uint64_t *ns);
+    void occupyBus(uint64_t ns);
+    uint32_t *word(uint32_t reg);
+
+    const unsigned mRegStride;
+
+    /* Serialises transfers; mLock guards the store and statistics. */
+    std::mutex mBusLock;
+    mutable std::mutex mLock;
+    SimBusConfig mConfig;
+    std::unordered_map<uint32_t, std::unique_ptr<uint32_t[]>> mPages;
+
+    size_t mTransactions = 0;
+    size_t mBytesWritten = 0;
+    size_t mBytesRead = 0;
+    uint64_t mBusNs = 0;
+
+    size_t mFailAt = 0;
+    int mFailAtErr = 0;
+    struct FailRange {
+        uint32_t first;
+        uint32_t last;
+        int err;
+    };
+    std::vector<FailRange> mFailRanges;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,60 @@
+/*
+ * Bounded single-producer/single-consumer ring.
+ *
+ * push() and pop() are wait-free and never enter the kernel, so the
+ * producer side is safe to call from a real-time audio thread. Exactly one
+ * thread may push and exactly one thread may pop.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace cirrus::hal {
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of 2");
+    static_assert(std::is_trivially_copyable_v<T>, "elements are copied by value");
+
+public:
+    bool push(const T &item)
+    {
+        size_t head = mHead.load(std::memory_order_relaxed);
+
+        if (head - mTail.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        mItems[head & (Capacity - 1)] = item;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *item)
+    {
+        size_t tail = mTail.load(std::memory_order_relaxed);
+
+        if (tail == mHead.load(std::memory_order_acquire))
+            return false;
+
+        *item = mItems[tail & (Capacity - 1)];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return mTail.load(std::memory_order_acquire) == mHead.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    /* Producer and consumer indices on separate cache lines. */
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+    alignas(64) T mItems[Capacity];
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,97 @@
+/*
+ * Firmware control symbols indexed by (algorithm ID, coefficient name).
+ *
+ * The algorithm data regions of a .wmfw describe every coefficient the
+ * firmware exposes: which algorithm it belongs to, which memory it lives
+ * in, its word offset from the algorithm base and its length. The codec
+ * driver turns each of these into an ALSA control; tools that adjust
+ * hundreds of coefficients can instead parse them once into a sorted
+ * table, bind it to the running Dsp and read and write DSP memory
+ * directly, with a binary search in place of control enumeration.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+
+namespace cirrus::hal {
+
+class BulkWriter;
+class Dsp;
+class Regmap;
+class WmfwFile;
+
+namespace wmfw {
+
+/* Coefficient access flags; a control with no flags is fully accessible. */
+constexpr uint16_t kCtlReadable = 0x0001;
+constexpr uint16_t kCtlWriteable = 0x0002;
+constexpr uint16_t kCtlVolatile = 0x0004;
+constexpr uint16_t kCtlSys = 0x8000;
+
+} // namespace wmfw
+
+struct DspSymbol {
+    uint32_t algId;
+    uint32_t nameOffset;
+    uint32_t nameLen;
+    /* Memory region type and word offset from the algorithm's base in it. */
+    uint16_t type;
+    uint32_t offset;
+    /* Bytes */
+    uint32_t len;
+    uint16_t flags;
+    uint16_t ctlType;
+    /* Register address once bound, otherwise SymbolTable::kUnbound */
+    uint32_t reg;
+};
+
+class SymbolTable {
+public:
+    static constexpr uint32_t kUnbound = UINT32_MAX;
+
+    void clear();
+
+    /* Index the coefficient descriptors of @wmfw. Returns 0 or a negative errno. */
+    int parse(const WmfwFile &wmfw);
+
+    /*
+     * Resolve every symbol against the algorithm bases @dsp read from the
+     * running firmware. Symbols of algorithms the firmware does not list
+     * are left unbound. Returns the number bound; parse and bind again
+     * after a firmware change.
+     */
+    size_t bind(const Dsp &dsp);
+
+    const DspSymbol *find(uint32_t algId, std::string_view name) const;
+    std::string_view name(const DspSymbol &sym) const
+    {
+        return {mNames.data() + sym.nameOffset, sym.nameLen};
+    }
+
+    size_t size() const { return mSymbols.size(); }
+    const std::vector<DspSymbol> &symbols() const { return mSymbols; }
+
+    /*
+     * Access the first @len bytes of @sym as raw big-endian DSP words.
+     * @len must be a whole number of words and at most sym.len.
+     */
+    int read(const DspSymbol &sym, void *data, size_t len) const;
+    int write(const DspSymbol &sym, ByteView data) const;
+    /* Queue a write so that a batch of symbols goes out in one flush(). */
+    int write(BulkWriter &writer, const DspSymbol &sym, ByteView data) const;
+
+private:
+    int parseRegion(ByteView data, uint8_t version);
+    int check(const DspSymbol &sym, size_t len, uint16_t mode) const;
+
+    std::vector<DspSymbol> mSymbols;
+    std::string mNames;
+    Regmap *mRegmap = nullptr;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,72 @@
+/*
+ * Per-device bus and DSP load counters for fleet monitoring.
+ *
+ * Every Device routes its register access through an InstrumentedRegmap,
+ * which counts transactions, payload bytes, errors and the time callers
+ * spent blocked in the bus backend. Counters are relaxed atomics bumped
+ * once per transaction, so reading them never touches the bus or takes a
+ * lock. DSP load is firmware specific: where the firmware publishes it,
+ * Device::sampleDspLoad() reads it back and telemetry() reports the last
+ * sample.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+class Device;
+
+struct BusCounters {
+    uint64_t transactions;
+    uint64_t readBytes;
+    uint64_t writeBytes;
+    uint64_t errors;
+    /* Wall time spent inside the bus backend. */
+    uint64_t blockedNs;
+};
+
+struct DeviceTelemetry {
+    BusCounters bus;
+    /* Last DSP load sample in 1/1000 of capacity, or -1 if not available. */
+    int32_t dspLoadPermille;
+};
+
+class InstrumentedRegmap : public Regmap {
+public:
+    explicit InstrumentedRegmap(std::unique_ptr<Regmap> inner);
+
+    int read(uint32_t reg, uint32_t *val) override;
+    int write(uint32_t reg, uint32_t val) override;
+    int rawRead(uint32_t reg, void *data, size_t len) override;
+    int rawWrite(uint32_t reg, const void *data, size_t len) override;
+    size_t maxRawWrite() const override { return mInner->maxRawWrite(); }
+    unsigned valBytes() const override { return mInner->valBytes(); }
+    unsigned regStride() const override { return mInner->regStride(); }
+
+    Regmap &inner() { return *mInner; }
+
+    BusCounters counters() const;
+    void resetCounters();
+
+private:
+    void account(uint64_t start, int ret, size_t readBytes, size_t writeBytes);
+
+    std::unique_ptr<Regmap> mInner;
+    std::atomic<uint64_t> mTransactions{0};
+    std::atomic<uint64_t> mReadBytes{0};
+    std::atomic<uint64_t> mWriteBytes{0};
+    std::atomic<uint64_t> mErrors{0};
+    std::atomic<uint64_t> mBlockedNs{0};
+};
+
+/* Text dump, one line per device, in the style of traceDump(). */
+std::string telemetryDump(const std::vector<Device *> &devices);
+
+} // namespace cirrus::hal
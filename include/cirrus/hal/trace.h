@@ -0,0 +1,74 @@
+/*
+ * HAL-wide trace points and latency histograms.
+ *
+ * A TraceScope around an operation costs two CLOCK_MONOTONIC reads and a
+ * few relaxed atomic increments into that operation's histogram; nothing
+ * locks. When trace markers are enabled, each scope is also emitted as an
+ * atrace begin/end pair on trace_marker, which systrace and Perfetto show
+ * as slices.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace cirrus::hal {
+
+enum class TraceOp : uint8_t {
+    kFirmwareLoad,
+    kCoefficientLoad,
+    kControlWrite,
+    kPowerUp,
+    kPowerDown,
+    kHapticTrigger,
+    kMailboxFlush,
+    kSuspend,
+    kResume,
+    kCount,
+};
+
+const char *traceOpName(TraceOp op);
+
+uint64_t traceNow();
+
+struct TraceStats {
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    /* Upper bounds of the buckets holding the median and 99th percentile. */
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+};
+
+/* Record one sample directly, for operations that cannot use a scope. */
+void traceRecord(TraceOp op, uint64_t ns);
+TraceStats traceStats(TraceOp op);
+void traceReset();
+
+/* Text dump of every histogram, one line per operation. */
+std::string traceDump();
+int traceDump(int fd);
+
+/*
+ * Mirror scopes to the kernel trace_marker file. Off by default. Once
+ * opened, the file stays open until exit so racing scopes stay safe.
+ */
+int traceSetMarkers(bool enable);
+
+class TraceScope {
+public:
+    explicit TraceScope(TraceOp op, const char *label = nullptr);
+    ~TraceScope();
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    TraceOp mOp;
+    /* Where this scope's begin marker went, or -1; its end goes there too. */
+    int mMarkerFd;
+    uint64_t mStart;
+};
+
+} // namespace cirrus::hal
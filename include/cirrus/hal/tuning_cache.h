@@ -0,0 +1,114 @@
+/*
+ * Shared, read-only tuning cache (.ctc).
+ *
+ * One process (normally the audio HAL service) validates every firmware
+ * and tuning file once and publishes them, with their content hashes, in
+ * a single position-independent cache file. Other processes (haptics
+ * service, factory calibration tool) map the same file read-only, so its
+ * pages are shared through the page cache rather than each process
+ * opening, reading and hashing its own copies.
+ *
+ * Layout, all fields little-endian:
+ *
+ *   header   magic "CTUN", u16 version, u16 header size, u32 entry count,
+ *            u32 string table size, u64 XXH64 of the index and strings,
+ *            u64 reserved
+ *   index    one 32-byte entry per file, sorted by name:
+ *            u16 kind, u16 reserved, u32 name offset, u32 name length,
+ *            u32 image offset, u32 image size, u32 reserved,
+ *            u64 XXH64 of the image
+ *   strings  entry names, not terminated
+ *   images   the original file images, each 16-byte aligned
+ *
+ * Offsets are relative to the start of the file, so it can be mapped at
+ * any address.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+struct TuningEntry {
+    enum Kind : uint16_t {
+        kFirmware = 1,
+        kTuning = 2,
+    };
+
+    Kind kind;
+    std::string_view name;
+    ByteView image;
+    uint64_t hash;
+};
+
+class TuningCache {
+public:
+    static constexpr uint16_t kVersion = 1;
+
+    int open(const std::string &path);
+    /* Use an image owned by the caller; it must outlive this object. */
+    int parse(ByteView image);
+
+    size_t size() const { return mCount; }
+    int entry(uint32_t index, TuningEntry *entry) const;
+
+    /* Binary search by name; -ENOENT if absent. */
+    int find(std::string_view name, TuningEntry *entry) const;
+
+    /*
+     * Bind @wmfw or @bin to the cached image named @name. The headers are
+     * decoded in place; the firmware hash is taken from the cache. The
+     * first bind of each image checks it against that hash and fails with
+     * -EBADMSG on a mismatch.
+     */
+    int firmware(std::string_view name, WmfwFile *wmfw) const;
+    int tuning(std::string_view name, BinFile *bin) const;
+
+private:
+    int indexOf(std::string_view name, uint32_t *index) const;
+    int findKind(std::string_view name, TuningEntry::Kind kind, TuningEntry *entry) const;
+
+    MappedFile mFile;
+    ByteView mImage;
+    const uint8_t *mIndex = nullptr;
+    const char *mStrings = nullptr;
+    uint32_t mCount = 0;
+    /* Images whose hash has been checked; racing checks are harmless. */
+    std::unique_ptr<std::atomic<bool>[]> mVerified;
+};
+
+/* Builds a .ctc from firmware and tuning files. */
+class TuningCacheWriter {
+public:
+    /*
+     * Add the file at @path under @name, validating it first. Adding a
+     * name twice replaces the earlier file.
+     */
+    int addFirmware(const std::string &name, const std::string &path);
+    int addTuning(const std::string &name, const std::string &path);
+
+    std::vector<uint8_t> serialize() const;
+    int write(const std::string &path) const;
+
+private:
+    struct Entry {
+        TuningEntry::Kind kind;
+        std::string name;
+        std::vector<uint8_t> image;
+        uint64_t hash;
+    };
+
+    int add(TuningEntry::Kind kind, const std::string &name, const std::string &path);
+
+    std::vector<Entry> mEntries;
+};
+
+} // namespace cirrus::hal
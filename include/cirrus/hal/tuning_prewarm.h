@@ -0,0 +1,94 @@
+/*
+ * Background staging of the next tuning.
+ *
+ * Most of a tuning switch is spent before the first bus write: mapping
+ * the .bin, walking its blocks and hashing every payload to find out
+ * which ones differ from what is resident. When the framework can see a
+ * transition coming (headset removal, a call being answered), hint() does
+ * that work on a background thread and keeps the parsed, hashed file in
+ * memory. apply() then only resolves block addresses and issues the
+ * batched write.
+ *
+ * A small number of tunings stay staged; the least recently used one
+ * that is not still being staged makes room for a new hint.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+class TuningPrewarmer {
+public:
+    static constexpr size_t kDefaultCapacity = 4;
+
+    explicit TuningPrewarmer(size_t capacity = kDefaultCapacity);
+    ~TuningPrewarmer();
+
+    TuningPrewarmer(const TuningPrewarmer &) = delete;
+    TuningPrewarmer &operator=(const TuningPrewarmer &) = delete;
+
+    /* Stage @path in the background if it is not staged already. */
+    void hint(const std::string &path);
+
+    /*
+     * The staged file for @path, waiting for a staging in progress; a
+     * tuning that was never hinted is staged on the caller's thread.
+     */
+    int take(const std::string &path, std::shared_ptr<const BinFile> *bin);
+
+    /*
+     * Switch @dsp to the tuning in @path. Call it wherever @dsp is
+     * normally driven from, e.g. its bus worker.
+     */
+    int apply(Dsp &dsp, const std::string &path);
+
+    /* Forget a staged tuning, e.g. after the file was replaced. */
+    void drop(const std::string &path);
+    void clear();
+
+    /* take() calls served from a hint, and those that had to stage. */
+    size_t hits() const;
+    size_t misses() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const BinFile> bin;
+        bool ready = false;
+        int result = 0;
+        uint64_t used = 0;
+        /* Staging queued for an older entry of the same path is dropped. */
+        uint64_t generation = 0;
+    };
+
+    static int stage(const std::string &path, std::shared_ptr<const BinFile> *bin);
+    void run();
+    void evict();
+
+    size_t mCapacity;
+
+    mutable std::mutex mLock;
+    std::condition_variable mWork;
+    std::condition_variable mStaged;
+    std::map<std::string, Entry> mEntries;
+    std::deque<std::pair<std::string, uint64_t>> mQueue;
+    uint64_t mClock = 0;
+    uint64_t mGeneration = 0;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+    bool mStopping = false;
+    std::thread mThread;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,74 @@
+/*
+ * Routing and tuning state for one use case.
+ *
+ * A use case (speaker playback, voice call, haptics only, ...) is built
+ * as an ordered list of control settings and a list of converted
+ * coefficient buffers, all carved out of one Arena. Tearing it down is a
+ * single reset(); building the next one reuses the same memory, so path
+ * switches do not churn the heap.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "cirrus/hal/arena.h"
+#include "cirrus/hal/control_shadow.h"
+#include "cirrus/hal/mapped_file.h"
+#include "cirrus/hal/mixer.h"
+#include "cirrus/hal/regmap.h"
+
+namespace cirrus::hal {
+
+struct CoefficientSetting {
+    uint32_t reg;
+    /* Big-endian DSP words, owned by the use case. */
+    ByteView data;
+};
+
+class UseCaseState {
+public:
+    explicit UseCaseState(size_t blockSize = Arena::kDefaultBlockSize);
+
+    UseCaseState(const UseCaseState &) = delete;
+    UseCaseState &operator=(const UseCaseState &) = delete;
+
+    /* Tear down the current use case; everything it returned is invalid. */
+    void reset();
+
+    void setName(std::string_view name);
+    std::string_view name() const { return mName; }
+
+    /* Size the lists for the coming use case to avoid regrowth. */
+    void reserve(size_t controls, size_t coefficients);
+
+    /* Values are copied into the use case. */
+    void addControl(const ControlInfo &ctl, const long *values, size_t count);
+    /* Set every element of @ctl to @value. */
+    void addControl(const ControlInfo &ctl, long value);
+
+    /* Converted to DSP words now, so applying them is a plain write. */
+    void addCoefficients(uint32_t reg, const float *values, size_t count, unsigned fracBits);
+    void addCoefficients(uint32_t reg, const int32_t *values, size_t count);
+
+    const ArenaVector<ControlSetting> &controls() const { return mControls; }
+    const ArenaVector<CoefficientSetting> &coefficients() const { return mCoefficients; }
+
+    /* Write every control in order; stops at the first error. */
+    int applyControls(Mixer &mixer) const;
+    /* As above, skipping controls @shadow says already hold their value. */
+    int applyControls(Mixer &mixer, ControlShadow &shadow) const;
+    /* Write every coefficient buffer, coalesced into as few bursts as possible. */
+    int applyCoefficients(Regmap &regmap) const;
+
+    Arena &arena() { return mArena; }
+
+private:
+    Arena mArena;
+    std::string_view mName;
+    ArenaVector<ControlSetting> mControls;
+    ArenaVector<CoefficientSetting> mCoefficients;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,86 @@
+/*
+ * Precompiled haptic wavetable (.cwt) with a fixed-size effect index.
+ *
+ * Layout, all fields little-endian:
+ *
+ *   header   magic "CWTB", u16 version, u16 header size, u32 effect count,
+ *            u32 index offset, u32 data offset, u32 data size,
+ *            u64 XXH64 of the index
+ *   index    one 16-byte entry per effect, in effect order:
+ *            u16 type, u16 flags, u32 data offset, u32 length, u32 duration
+ *   data     effect payloads, stored as big-endian 32-bit DSP words so they
+ *            can be uploaded without conversion
+ *
+ * The file is mapped and its index validated once; after that fetching an
+ * effect is a bounds-checked array access and uploading it writes straight
+ * from the mapping.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+
+namespace cirrus::hal {
+
+struct WaveEffect {
+    enum Type : uint16_t {
+        kPcm = 1,
+        kPwle = 2,
+        kComposite = 3,
+    };
+
+    uint16_t type;
+    uint16_t flags;
+    /* Playback length in milliseconds, 0 if open-ended. */
+    uint32_t duration;
+    ByteView data;
+};
+
+class Wavetable {
+public:
+    static constexpr uint16_t kVersion = 1;
+
+    int open(const std::string &path);
+    /* Use an image owned by the caller; it must outlive this object. */
+    int parse(ByteView image);
+
+    size_t size() const { return mCount; }
+
+    /* O(1) lookup; returns -EINVAL if @index is out of range. */
+    int effect(uint32_t index, WaveEffect *effect) const;
+
+private:
+    MappedFile mFile;
+    ByteView mImage;
+    const uint8_t *mIndex = nullptr;
+    const uint8_t *mData = nullptr;
+    uint32_t mCount = 0;
+};
+
+/* Builds .cwt images, e.g. from the effect library at build time. */
+class WavetableWriter {
+public:
+    /* Append an effect of 24-bit DSP words; returns its index. */
+    uint32_t add(uint16_t type, const std::vector<int32_t> &words, uint32_t duration,
+                 uint16_t flags = 0);
+
+    std::vector<uint8_t> serialize() const;
+    int write(const std::string &path) const;
+
+private:
+    struct Entry {
+        uint16_t type;
+        uint16_t flags;
+        uint32_t offset;
+        uint32_t length;
+        uint32_t duration;
+    };
+
+    std::vector<Entry> mEntries;
+    std::vector<uint8_t> mData;
+};
+
+} // namespace cirrus::hal
@@ -0,0 +1,137 @@
+/*
+ * In-place parsers for Cirrus Logic DSP firmware (.wmfw) and coefficient
+ * (.bin) files.
+ *
+ * Files are memory mapped and their block headers are decoded where they
+ * sit; payloads are handed out as ByteViews into the mapping so they can be
+ * written to DSP memory without an intermediate heap copy. A view is only
+ * valid while the file object that produced it is alive.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+
+namespace cirrus::hal {
+
+namespace wmfw {
+
+/* DSP core types, as found in the .wmfw header. */
+constexpr uint8_t kCoreAdsp1 = 1;
+constexpr uint8_t kCoreAdsp2 = 2;
+constexpr uint8_t kCoreHalo = 4;
+
+/* Region types. In .bin files the text/absolute types are shifted up by 8. */
+constexpr uint16_t kAdsp1Pm = 2;
+constexpr uint16_t kAdsp1Dm = 3;
+constexpr uint16_t kAdsp2Pm = 2;
+constexpr uint16_t kAdsp2Zm = 4;
+constexpr uint16_t kAdsp2Xm = 5;
+constexpr uint16_t kAdsp2Ym = 6;
+constexpr uint16_t kHaloPmPacked = 0x10;
+constexpr uint16_t kHaloXmPacked = 0x11;
+constexpr uint16_t kHaloYmPacked = 0x12;
+constexpr uint16_t kAbsolute = 0xf0;
+constexpr uint16_t kAlgorithmData = 0xf2;
+constexpr uint16_t kMetadata = 0xfc;
+constexpr uint16_t kNameText = 0xfe;
+constexpr uint16_t kInfoText = 0xff;
+
+} // namespace wmfw
+
+struct WmfwRegion {
+    uint8_t type;
+    /* Word offset into the region, or a register address for kAbsolute. */
+    uint32_t offset;
+    ByteView data;
+};
+
+class WmfwFile {
+public:
+    /* Map and parse @path. Returns 0 or a negative errno. */
+    int open(const std::string &path);
+    /* Parse an image owned by the caller; it must outlive this object. */
+    int parse(ByteView image);
+
+    uint8_t core() const { return mCore; }
+    uint8_t version() const { return mVersion; }
+    uint16_t revision() const { return mRevision; }
+    uint64_t timestamp() const { return mTimestamp; }
+    uint32_t checksum() const { return mChecksum; }
+    ByteView image() const { return mImage; }
+    /* Path the file was opened from, used in log messages. */
+    const std::string &name() const { return mName; }
+    /* Label log messages for an image handed to parse(). */
+    void setName(std::string name) { mName = std::move(name); }
+
+    /* XXH64 of image(), computed on first use unless already supplied. */
+    uint64_t hash() const;
+    void setHash(uint64_t hash)
+    {
+        mHash = hash;
+        mHashValid = true;
+    }
+
+    /* All regions in file order, including text and algorithm metadata. */
+    const std::vector<WmfwRegion> &regions() const { return mRegions; }
+
+private:
+    MappedFile mFile;
+    ByteView mImage;
+    std::string mName;
+    std::vector<WmfwRegion> mRegions;
+    uint8_t mCore = 0;
+    uint8_t mVersion = 0;
+    uint16_t mRevision = 0;
+    uint64_t mTimestamp = 0;
+    uint32_t mChecksum = 0;
+    mutable uint64_t mHash = 0;
+    mutable bool mHashValid = false;
+};
+
+struct BinBlock {
+    uint16_t type;
+    uint16_t offset;
+    uint32_t algId;
+    uint32_t algVersion;
+    uint32_t sampleRate;
+    ByteView data;
+};
+
+class BinFile {
+public:
+    /* Map and parse @path. Returns 0 or a negative errno. */
+    int open(const std::string &path);
+    /* Parse an image owned by the caller; it must outlive this object. */
+    int parse(ByteView image);
+
+    uint8_t revision() const { return mRevision; }
+    ByteView image() const { return mImage; }
+    /* Path the file was opened from, used in log messages. */
+    const std::string &name() const { return mName; }
+    /* Label log messages for an image handed to parse(). */
+    void setName(std::string name) { mName = std::move(name); }
+
+    const std::vector<BinBlock> &blocks() const { return mBlocks; }
+
+    /*
+     * XXH64 of each block's payload, parallel to blocks(). Computed on
+     * first use, so call it ahead of time to take hashing off the load.
+     */
+    const std::vector<uint64_t> &blockHashes() const;
+
+private:
+    MappedFile mFile;
+    ByteView mImage;
+    std::string mName;
+    std::vector<BinBlock> mBlocks;
+    uint8_t mRevision = 0;
+    mutable std::vector<uint64_t> mBlockHashes;
+    mutable bool mBlockHashesValid = false;
+};
+
+} // namespace cirrus::hal
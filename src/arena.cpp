@@ -0,0 +1,65 @@
+#include "cirrus/hal/arena.h"
+
+#include <algorithm>
+
+namespace cirrus::hal {
+
+void *Arena::allocateFrom(Block &block, size_t size, size_t align)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    uintptr_t start = (base + mOffset + align - 1) & ~(uintptr_t(align) - 1);
+
+    if (start + size > base + block.size)
+        return nullptr;
+
+    mUsed += start + size - (base + mOffset);
+    mOffset = start + size - base;
+    return reinterpret_cast<void *>(start);
+}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    void *p;
+
+    if (!size)
+        size = 1;
+
+    if (mCurrent < mBlocks.size()) {
+        p = allocateFrom(mBlocks[mCurrent], size, align);
+        if (p)
+            return p;
+    }
+
+    /* Move on to the next retained block, or add one. */
+    while (++mCurrent < mBlocks.size()) {
+        mOffset = 0;
+        p = allocateFrom(mBlocks[mCurrent], size, align);
+        if (p)
+            return p;
+    }
+
+    size_t blockSize = std::max(mBlockSize, size + align);
+    mBlocks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize});
+    mCapacity += blockSize;
+    mCurrent = mBlocks.size() - 1;
+    mOffset = 0;
+
+    return allocateFrom(mBlocks[mCurrent], size, align);
+}
+
+void Arena::reset()
+{
+    auto oversized = [this](const Block &block) { return block.size > mBlockSize; };
+
+    for (const Block &block : mBlocks) {
+        if (oversized(block))
+            mCapacity -= block.size;
+    }
+    mBlocks.erase(std::remove_if(mBlocks.begin(), mBlocks.end(), oversized), mBlocks.end());
+
+    mCurrent = 0;
+    mOffset = 0;
+    mUsed = 0;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,156 @@
+#define LOG_TAG "cirrus-bulk-writer"
+
+#include "cirrus/hal/bulk_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+BulkWriter::BulkWriter(Regmap &regmap)
+    : mRegmap(regmap),
+      mMaxWrite(regmap.maxRawWrite() - regmap.maxRawWrite() % regmap.valBytes())
+{
+    if (!mMaxWrite)
+        CIRRUS_LOGE("Bus transfers of %zu bytes cannot hold a %u byte register",
+                    regmap.maxRawWrite(), regmap.valBytes());
+    mStage.resize(mMaxWrite);
+}
+
+int BulkWriter::write(uint32_t reg, ByteView data)
+{
+    int ret;
+
+    if (data.empty())
+        return 0;
+
+    /* Nothing could ever be emitted, so drain() would never finish. */
+    if (!mMaxWrite)
+        return -EINVAL;
+
+    if (data.size % mRegmap.valBytes()) {
+        CIRRUS_LOGE("Write of %zu bytes to 0x%x is not register aligned", data.size, reg);
+        return -EINVAL;
+    }
+
+    if (mRunBytes && reg != mRegmap.advance(mRunReg, mRunBytes)) {
+        ret = drain(true);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (!mRunBytes) {
+        mRunReg = reg;
+        mRun.clear();
+        mHead = 0;
+        mHeadOffset = 0;
+    }
+
+    mRun.push_back(data);
+    mRunBytes += data.size;
+
+    return drain(false);
+}
+
+int BulkWriter::write(uint32_t reg, uint32_t val)
+{
+    std::array<uint8_t, 4> &buf = mValues.emplace_back();
+
+    writeBe32(buf.data(), val);
+    return write(reg, ByteView{buf.data(), buf.size()});
+}
+
+int BulkWriter::flush()
+{
+    int ret = drain(true);
+
+    mValues.clear();
+    return ret;
+}
+
+int BulkWriter::drain(bool all)
+{
+    int ret;
+
+    while (mRunBytes && mRunBytes >= mMaxWrite) {
+        ret = emit(mMaxWrite);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (all && mRunBytes) {
+        ret = emit(mRunBytes);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+void BulkWriter::popHead()
+{
+    mHead++;
+    mHeadOffset = 0;
+
+    /* Drop sent views once they are half the queue, keeping its capacity. */
+    if (mHead == mRun.size() || mHead * 2 >= mRun.capacity()) {
+        mRun.erase(mRun.begin(), mRun.begin() + mHead);
+        mHead = 0;
+    }
+}
+
+int BulkWriter::emit(size_t len)
+{
+    const ByteView &head = mRun[mHead];
+    const uint8_t *src;
+    size_t done = 0;
+    int ret;
+
+    if (head.size - mHeadOffset >= len) {
+        src = head.data + mHeadOffset;
+        mHeadOffset += len;
+        if (mHeadOffset == head.size)
+            popHead();
+    } else {
+        while (done < len) {
+            const ByteView &seg = mRun[mHead];
+            size_t n = std::min(seg.size - mHeadOffset, len - done);
+
+            memcpy(mStage.data() + done, seg.data + mHeadOffset, n);
+            done += n;
+            mHeadOffset += n;
+            if (mHeadOffset == seg.size)
+                popHead();
+        }
+        src = mStage.data();
+    }
+
+    ret = mRegmap.rawWrite(mRunReg, src, len);
+    if (ret < 0) {
+        CIRRUS_LOGE("Bulk write of %zu bytes to 0x%x failed: %d", len, mRunReg, ret);
+        reset();
+        return ret;
+    }
+
+    mRunReg = mRegmap.advance(mRunReg, len);
+    mRunBytes -= len;
+    mTransactions++;
+    mBytes += len;
+
+    return 0;
+}
+
+void BulkWriter::reset()
+{
+    mRun.clear();
+    mHead = 0;
+    mRunBytes = 0;
+    mHeadOffset = 0;
+    mValues.clear();
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,73 @@
+#define LOG_TAG "cirrus-bus-scheduler"
+
+#include "cirrus/hal/bus_scheduler.h"
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+BusScheduler::~BusScheduler()
+{
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        mStopping = true;
+    }
+    mWork.notify_all();
+
+    for (auto &entry : mQueues)
+        entry.second->worker.join();
+}
+
+void BusScheduler::submit(const std::string &bus, Job job)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    std::unique_ptr<Queue> &queue = mQueues[bus];
+
+    if (!queue) {
+        queue = std::make_unique<Queue>();
+        queue->worker = std::thread(&BusScheduler::run, this, queue.get());
+    }
+
+    queue->jobs.push_back(std::move(job));
+    mPending++;
+    mWork.notify_all();
+}
+
+int BusScheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    int ret;
+
+    mIdle.wait(lock, [this] { return mPending == 0; });
+
+    ret = mError;
+    mError = 0;
+    return ret;
+}
+
+void BusScheduler::run(Queue *queue)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    for (;;) {
+        mWork.wait(lock, [this, queue] { return mStopping || !queue->jobs.empty(); });
+        /* Finish outstanding work even when shutting down. */
+        if (queue->jobs.empty())
+            return;
+
+        Job job = std::move(queue->jobs.front());
+        queue->jobs.pop_front();
+
+        lock.unlock();
+        int ret = job();
+        lock.lock();
+
+        if (ret < 0 && !mError)
+            mError = ret;
+
+        if (--mPending == 0)
+            mIdle.notify_all();
+    }
+}
+
+} // namespace cirrus::hal
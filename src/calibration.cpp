@@ -0,0 +1,148 @@
+#define LOG_TAG "cirrus-calibration"
+
+#include "cirrus/hal/calibration.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/file_util.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/mapped_file.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kEntrySize = 24;
+
+} // namespace
+
+int CalibrationStore::load(const std::string &path)
+{
+    MappedFile file;
+    const uint8_t *p;
+    uint16_t count;
+    int ret;
+
+    mEntries.clear();
+
+    /* Nothing has been calibrated yet, e.g. on first boot. */
+    if (access(path.c_str(), F_OK) < 0 && errno == ENOENT)
+        return 0;
+
+    ret = file.open(path);
+    if (ret < 0)
+        return ret;
+
+    ByteView image = file.view();
+    p = image.data;
+
+    if (image.size < kHeaderSize || memcmp(p, "CCAL", 4) != 0 || readLe16(p + 4) != kVersion) {
+        CIRRUS_LOGE("%s: not a version %u calibration file", path.c_str(), kVersion);
+        return -EINVAL;
+    }
+
+    count = readLe16(p + 6);
+    if (image.size != kHeaderSize + count * kEntrySize ||
+        contentHash(image.sub(kHeaderSize, count * kEntrySize)) != readLe64(p + 8)) {
+        CIRRUS_LOGE("%s: calibration data is corrupt", path.c_str());
+        return -EINVAL;
+    }
+
+    mEntries.resize(count);
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t *e = p + kHeaderSize + i * kEntrySize;
+
+        mEntries[i] = {readLe64(e), readLe32(e + 8), readLe32(e + 12), readLe32(e + 16),
+                       readLe32(e + 20)};
+    }
+
+    return 0;
+}
+
+int CalibrationStore::save(const std::string &path) const
+{
+    std::vector<uint8_t> image(kHeaderSize + mEntries.size() * kEntrySize);
+    uint8_t *p = image.data();
+
+    memcpy(p, "CCAL", 4);
+    writeLe16(p + 4, kVersion);
+    writeLe16(p + 6, mEntries.size());
+
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        uint8_t *e = p + kHeaderSize + i * kEntrySize;
+
+        writeLe64(e, mEntries[i].uid);
+        writeLe32(e + 8, mEntries[i].redc);
+        writeLe32(e + 12, mEntries[i].ambient);
+        writeLe32(e + 16, mEntries[i].status);
+        writeLe32(e + 20, mEntries[i].checksum);
+    }
+
+    writeLe64(p + 8, contentHash({p + kHeaderSize, mEntries.size() * kEntrySize}));
+
+    return writeFileAtomic(path, image.data(), image.size());
+}
+
+const Calibration *CalibrationStore::find(uint64_t uid) const
+{
+    for (const Calibration &cal : mEntries)
+        if (cal.uid == uid)
+            return &cal;
+    return nullptr;
+}
+
+void CalibrationStore::update(const Calibration &cal)
+{
+    for (Calibration &entry : mEntries) {
+        if (entry.uid == cal.uid) {
+            entry = cal;
+            return;
+        }
+    }
+
+    mEntries.push_back(cal);
+}
+
+int restoreCalibration(Dsp &dsp, const CalibrationLayout &layout, const Calibration &cal)
+{
+    const DspAlgorithm *alg = dsp.findAlgorithm(layout.algId);
+    BulkWriter writer(dsp.regmap());
+    uint32_t base;
+    int ret;
+
+    if (!alg) {
+        CIRRUS_LOGE("%s: no calibration algorithm 0x%x", dsp.name().c_str(), layout.algId);
+        return -ENOENT;
+    }
+
+    ret = dsp.regionToReg(wmfw::kAdsp2Xm, alg->xmBase, &base);
+    if (ret < 0)
+        return ret;
+
+    /* Queued in address order so adjacent values share one transfer. */
+    std::pair<uint32_t, uint32_t> values[] = {
+            {layout.redc, cal.redc},
+            {layout.ambient, cal.ambient},
+            {layout.status, cal.status},
+            {layout.checksum, cal.checksum},
+    };
+    std::sort(std::begin(values), std::end(values));
+
+    for (const auto &v : values) {
+        ret = writer.write(dsp.regmap().advance(base, v.first * 4), v.second);
+        if (ret < 0)
+            return ret;
+    }
+
+    return writer.flush();
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,186 @@
+#include "cirrus/hal/coeff_convert.h"
+
+#include <cmath>
+
+#include "cirrus/hal/byte_order.h"
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr float kMin24 = -8388608.0f;
+constexpr float kMax24 = 8388607.0f;
+
+int32_t floatTo24(float v, float scale)
+{
+    float x = v * scale;
+
+    /* Same NaN and clamp ordering as the vector max/min below. */
+    if (!(x >= kMin24))
+        x = kMin24;
+    if (x > kMax24)
+        x = kMax24;
+
+    return static_cast<int32_t>(std::nearbyint(x));
+}
+
+void pack24(uint8_t *out, int32_t v)
+{
+    out[0] = static_cast<uint8_t>(v >> 16);
+    out[1] = static_cast<uint8_t>(v >> 8);
+    out[2] = static_cast<uint8_t>(v);
+}
+
+#if defined(__aarch64__)
+
+/* Byte order for four big-endian words, and for four packed 3-byte words. */
+const uint8_t kBswap[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+const uint8_t kPack[16] = {2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, 0xff, 0xff, 0xff, 0xff};
+
+inline void storeBe(uint8_t *out, int32x4_t v)
+{
+    uint8x16_t b = vreinterpretq_u8_s32(vandq_s32(v, vdupq_n_s32(0xffffff)));
+
+    vst1q_u8(out, vqtbl1q_u8(b, vld1q_u8(kBswap)));
+}
+
+#elif defined(__SSE2__)
+
+inline __m128i bswap32(__m128i v)
+{
+    __m128i lo = _mm_or_si128(_mm_slli_epi32(v, 24), _mm_srli_epi32(v, 24));
+    __m128i mid = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v, 8), _mm_set1_epi32(0xff0000)),
+                               _mm_and_si128(_mm_srli_epi32(v, 8), _mm_set1_epi32(0xff00)));
+
+    return _mm_or_si128(lo, mid);
+}
+
+inline void storeBe(uint8_t *out, __m128i v)
+{
+    v = _mm_and_si128(v, _mm_set1_epi32(0xffffff));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), bswap32(v));
+}
+
+__attribute__((target("ssse3"))) size_t packSsse3(const int32_t *in, size_t count, uint8_t *out)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                          -1, -1, -1, -1);
+    size_t i = 0;
+
+    /* Each store writes 16 bytes of which 12 are kept, so stop one early. */
+    for (; i + 8 <= count; i += 4, out += 12) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_shuffle_epi8(v, shuffle));
+    }
+
+    return i;
+}
+
+bool haveSsse3()
+{
+    static const bool have = __builtin_cpu_supports("ssse3");
+    return have;
+}
+
+#endif
+
+} // namespace
+
+void floatToDsp(const float *in, size_t count, unsigned fracBits, uint8_t *out)
+{
+    const float scale = std::ldexp(1.0f, static_cast<int>(fracBits));
+    size_t i = 0;
+
+#if defined(__aarch64__)
+    const float32x4_t vscale = vdupq_n_f32(scale);
+    const float32x4_t vmin = vdupq_n_f32(kMin24);
+    const float32x4_t vmax = vdupq_n_f32(kMax24);
+
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vmulq_f32(vld1q_f32(in + i), vscale);
+
+        x = vminnmq_f32(vmaxnmq_f32(x, vmin), vmax);
+        storeBe(out + i * 4, vcvtnq_s32_f32(x));
+    }
+#elif defined(__SSE2__)
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 vmin = _mm_set1_ps(kMin24);
+    const __m128 vmax = _mm_set1_ps(kMax24);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(in + i), vscale);
+
+        /* maxps returns its second operand for NaN, matching floatTo24(). */
+        x = _mm_min_ps(_mm_max_ps(x, vmin), vmax);
+        storeBe(out + i * 4, _mm_cvtps_epi32(x));
+    }
+#endif
+
+    for (; i < count; i++)
+        writeBe32(out + i * 4, static_cast<uint32_t>(floatTo24(in[i], scale)) & 0xffffff);
+}
+
+void intToDsp(const int32_t *in, size_t count, uint8_t *out)
+{
+    size_t i = 0;
+
+#if defined(__aarch64__)
+    for (; i + 4 <= count; i += 4)
+        storeBe(out + i * 4, vld1q_s32(in + i));
+#elif defined(__SSE2__)
+    for (; i + 4 <= count; i += 4)
+        storeBe(out + i * 4, _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+#endif
+
+    for (; i < count; i++)
+        writeBe32(out + i * 4, static_cast<uint32_t>(in[i]) & 0xffffff);
+}
+
+void packDsp24(const int32_t *in, size_t count, uint8_t *out)
+{
+    size_t i = 0;
+
+#if defined(__aarch64__)
+    const uint8x16_t shuffle = vld1q_u8(kPack);
+
+    for (; i + 8 <= count; i += 4) {
+        uint8x16_t b = vreinterpretq_u8_s32(vld1q_s32(in + i));
+        vst1q_u8(out + i * 3, vqtbl1q_u8(b, shuffle));
+    }
+#elif defined(__SSE2__)
+    if (haveSsse3())
+        i = packSsse3(in, count, out);
+#endif
+
+    for (; i < count; i++)
+        pack24(out + i * 3, in[i]);
+}
+
+void dspToInt(const uint8_t *in, size_t count, int32_t *out)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v = readBe32(in + i * 4) & 0xffffff;
+
+        out[i] = static_cast<int32_t>(v << 8) >> 8;
+    }
+}
+
+const char *coeffConvertImpl()
+{
+#if defined(__aarch64__)
+    return "neon";
+#elif defined(__SSE2__)
+    return haveSsse3() ? "ssse3" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,85 @@
+#define LOG_TAG "cirrus-completion"
+
+#include "cirrus/hal/completion.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+Completion::~Completion()
+{
+    close();
+}
+
+int Completion::open()
+{
+    if (mFd >= 0)
+        return -EBUSY;
+
+    mFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to create eventfd: %s", strerror(errno));
+        return ret;
+    }
+
+    reset();
+    return 0;
+}
+
+void Completion::close()
+{
+    if (mFd >= 0)
+        ::close(mFd);
+    mFd = -1;
+}
+
+void Completion::signal(int result)
+{
+    uint64_t one = 1;
+
+    mResult.store(result, std::memory_order_relaxed);
+    mDone.store(true, std::memory_order_release);
+
+    if (write(mFd, &one, sizeof(one)) < 0)
+        CIRRUS_LOGE("eventfd write failed: %s", strerror(errno));
+}
+
+int Completion::wait(int timeoutMs)
+{
+    struct pollfd pfd = {mFd, POLLIN, 0};
+
+    while (!done()) {
+        int ret = poll(&pfd, 1, timeoutMs);
+        if (ret == 0)
+            return -ETIMEDOUT;
+        if (ret < 0 && errno != EINTR) {
+            ret = -errno;
+            CIRRUS_LOGE("poll failed: %s", strerror(errno));
+            return ret;
+        }
+    }
+
+    return result();
+}
+
+void Completion::reset()
+{
+    uint64_t count;
+
+    mDone.store(false, std::memory_order_relaxed);
+    mResult.store(0, std::memory_order_relaxed);
+
+    /* Non-blocking, so this only drains a pending signal. */
+    if (read(mFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        CIRRUS_LOGE("eventfd read failed: %s", strerror(errno));
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,184 @@
+#include "cirrus/hal/content_hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+/*
+ * XXH64 and XXH32 are defined on little-endian words. The hashes are
+ * persisted in .cwt, .ccal and .ctc files that may be read on another
+ * host, so every load is explicitly little-endian.
+ */
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+constexpr uint32_t kPrime32_1 = 2654435761u;
+constexpr uint32_t kPrime32_2 = 2246822519u;
+constexpr uint32_t kPrime32_3 = 3266489917u;
+constexpr uint32_t kPrime32_4 = 668265263u;
+constexpr uint32_t kPrime32_5 = 374761393u;
+
+inline uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+inline uint32_t round32(uint32_t acc, uint32_t input)
+{
+    return rotl32(acc + input * kPrime32_2, 13) * kPrime32_1;
+}
+
+} // namespace
+
+uint64_t contentHash(ByteView data, uint64_t seed)
+{
+    const uint8_t *p = data.data;
+    const uint8_t *end = p + data.size;
+    uint64_t h;
+
+    if (data.size >= 32) {
+        const uint8_t *limit = end - 32;
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+
+        do {
+            v1 = round(v1, readLe64(p));
+            v2 = round(v2, readLe64(p + 8));
+            v3 = round(v3, readLe64(p + 16));
+            v4 = round(v4, readLe64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+
+    h += data.size;
+
+    for (; p + 8 <= end; p += 8)
+        h = rotl(h ^ round(0, readLe64(p)), 27) * kPrime1 + kPrime4;
+
+    if (p + 4 <= end) {
+        h = rotl(h ^ (readLe32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+        h = rotl(h ^ (*p * kPrime5), 11) * kPrime1;
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+void Xxh32::reset(uint32_t seed)
+{
+    mSeed = seed;
+    mAcc[0] = seed + kPrime32_1 + kPrime32_2;
+    mAcc[1] = seed + kPrime32_2;
+    mAcc[2] = seed;
+    mAcc[3] = seed - kPrime32_1;
+    mBuffered = 0;
+    mTotal = 0;
+}
+
+void Xxh32::update(ByteView data)
+{
+    const uint8_t *p = data.data;
+    size_t len = data.size;
+
+    mTotal += len;
+
+    if (mBuffered) {
+        size_t n = std::min(len, sizeof(mBuf) - mBuffered);
+
+        memcpy(mBuf + mBuffered, p, n);
+        mBuffered += n;
+        p += n;
+        len -= n;
+        if (mBuffered < sizeof(mBuf))
+            return;
+        for (int i = 0; i < 4; i++)
+            mAcc[i] = round32(mAcc[i], readLe32(mBuf + i * 4));
+        mBuffered = 0;
+    }
+
+    for (; len >= sizeof(mBuf); p += sizeof(mBuf), len -= sizeof(mBuf))
+        for (int i = 0; i < 4; i++)
+            mAcc[i] = round32(mAcc[i], readLe32(p + i * 4));
+
+    if (len)
+        memcpy(mBuf, p, len);
+    mBuffered = len;
+}
+
+uint32_t Xxh32::digest() const
+{
+    uint32_t h;
+    size_t i = 0;
+
+    if (mTotal >= sizeof(mBuf))
+        h = rotl32(mAcc[0], 1) + rotl32(mAcc[1], 7) + rotl32(mAcc[2], 12) + rotl32(mAcc[3], 18);
+    else
+        h = mSeed + kPrime32_5;
+    h += static_cast<uint32_t>(mTotal);
+
+    for (; i + 4 <= mBuffered; i += 4)
+        h = rotl32(h + readLe32(mBuf + i) * kPrime32_3, 17) * kPrime32_4;
+    for (; i < mBuffered; i++)
+        h = rotl32(h + mBuf[i] * kPrime32_5, 11) * kPrime32_1;
+
+    h ^= h >> 15;
+    h *= kPrime32_2;
+    h ^= h >> 13;
+    h *= kPrime32_3;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t xxh32(ByteView data, uint32_t seed)
+{
+    Xxh32 state(seed);
+
+    state.update(data);
+    return state.digest();
+}
+
+} // namespace cirrus::hal
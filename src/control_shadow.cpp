@@ -0,0 +1,79 @@
+#define LOG_TAG "cirrus-control-shadow"
+
+#include "cirrus/hal/control_shadow.h"
+
+#include <algorithm>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+void ControlShadow::clear()
+{
+    mEntries.clear();
+    mValues.clear();
+    mWritten = 0;
+    mSkipped = 0;
+}
+
+void ControlShadow::invalidate(uint32_t numid)
+{
+    if (numid < mEntries.size())
+        mEntries[numid].valid = false;
+}
+
+bool ControlShadow::matches(const ControlInfo &ctl, const long *values, size_t count) const
+{
+    if (ctl.numid >= mEntries.size())
+        return false;
+
+    const Entry &entry = mEntries[ctl.numid];
+
+    return entry.valid && entry.count == count &&
+           std::equal(values, values + count, mValues.begin() + entry.offset);
+}
+
+void ControlShadow::update(const ControlInfo &ctl, const long *values, size_t count)
+{
+    if (ctl.numid >= mEntries.size())
+        mEntries.resize(ctl.numid + 1, Entry{0, 0, 0, false});
+
+    Entry &entry = mEntries[ctl.numid];
+
+    /* Reserve the whole control up front so partial writes never move it. */
+    if (count > entry.capacity) {
+        entry.capacity = std::max<uint32_t>(count, ctl.count);
+        entry.offset = mValues.size();
+        mValues.resize(mValues.size() + entry.capacity);
+    }
+
+    std::copy(values, values + count, mValues.begin() + entry.offset);
+    entry.count = count;
+    entry.valid = true;
+}
+
+int ControlShadow::apply(Mixer &mixer, const ControlSetting *settings, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        const ControlSetting &setting = settings[i];
+
+        if (matches(setting.ctl, setting.values, setting.count)) {
+            mSkipped++;
+            continue;
+        }
+
+        int ret = mixer.setValues(setting.ctl, setting.values, setting.count);
+        if (ret < 0) {
+            CIRRUS_LOGE("Failed to write control %u: %d", setting.ctl.numid, ret);
+            invalidate(setting.ctl.numid);
+            return ret;
+        }
+
+        update(setting.ctl, setting.values, setting.count);
+        mWritten++;
+    }
+
+    return 0;
+}
+
+} // namespace cirrus::hal
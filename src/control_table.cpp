@@ -0,0 +1,108 @@
+#include "cirrus/hal/control_table.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kMinSlots = 64;
+
+} // namespace
+
+uint32_t ControlTable::hashOf(std::string_view name, uint32_t index)
+{
+    /* FNV-1a; control names are short and mostly share long prefixes. */
+    uint32_t h = 2166136261u;
+
+    for (char c : name)
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+
+    return (h ^ index) * 16777619u;
+}
+
+void ControlTable::clear()
+{
+    mEntries.clear();
+    mNames.clear();
+    mSlots.clear();
+}
+
+void ControlTable::reserve(size_t count)
+{
+    size_t slots = kMinSlots;
+
+    while (slots < count * 2)
+        slots <<= 1;
+
+    mEntries.reserve(count);
+    if (slots > mSlots.size())
+        rehash(slots);
+}
+
+size_t ControlTable::probe(std::string_view name, uint32_t index, uint32_t hash) const
+{
+    size_t mask = mSlots.size() - 1;
+    size_t slot = hash & mask;
+
+    for (;;) {
+        uint32_t n = mSlots[slot];
+        if (!n)
+            return slot;
+
+        const Entry &e = mEntries[n - 1];
+        if (e.hash == hash && e.index == index &&
+            std::string_view(mNames).substr(e.nameOffset, e.nameLen) == name)
+            return slot;
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+void ControlTable::rehash(size_t slots)
+{
+    mSlots.assign(slots, 0);
+
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        size_t slot = mEntries[i].hash & (slots - 1);
+
+        while (mSlots[slot])
+            slot = (slot + 1) & (slots - 1);
+        mSlots[slot] = i + 1;
+    }
+}
+
+void ControlTable::insert(std::string_view name, uint32_t index, const ControlInfo &info)
+{
+    uint32_t hash = hashOf(name, index);
+    size_t slot;
+
+    /* Keep the load factor at or below one half. */
+    if ((mEntries.size() + 1) * 2 > mSlots.size())
+        rehash(mSlots.empty() ? kMinSlots : mSlots.size() * 2);
+
+    slot = probe(name, index, hash);
+    if (mSlots[slot]) {
+        mEntries[mSlots[slot] - 1].info = info;
+        return;
+    }
+
+    mEntries.push_back({hash, static_cast<uint32_t>(mNames.size()),
+                        static_cast<uint32_t>(name.size()), index, info});
+    mNames.append(name);
+    mSlots[slot] = mEntries.size();
+}
+
+const ControlInfo *ControlTable::find(std::string_view name, uint32_t index) const
+{
+    size_t slot;
+
+    if (mSlots.empty())
+        return nullptr;
+
+    slot = probe(name, index, hashOf(name, index));
+    if (!mSlots[slot])
+        return nullptr;
+
+    return &mEntries[mSlots[slot] - 1].info;
+}
+
+} // namespace cirrus::hal
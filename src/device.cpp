@@ -0,0 +1,294 @@
+#define LOG_TAG "cirrus-device"
+
+#include "cirrus/hal/device.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/lz4_stream.h"
+#include "cirrus/hal/trace.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr uint32_t kPollIntervalUs = 1000;
+
+/* Images compressed with `lz4` keep their name plus a .lz4 suffix. */
+bool isCompressed(const std::string &path)
+{
+    static constexpr char kSuffix[] = ".lz4";
+    constexpr size_t kLen = sizeof(kSuffix) - 1;
+
+    return path.size() > kLen && path.compare(path.size() - kLen, kLen, kSuffix) == 0;
+}
+
+int runSequence(Regmap &regmap, const std::string &name, Table<PowerStep> steps)
+{
+    for (const PowerStep &step : steps) {
+        uint32_t val = 0;
+        uint32_t waited = 0;
+        int ret = 0;
+
+        switch (step.op) {
+        case PowerStep::kUpdate:
+            ret = regmap.updateBits(step.reg, step.mask, step.val);
+            break;
+        case PowerStep::kWrite:
+            ret = regmap.write(step.reg, step.val);
+            break;
+        case PowerStep::kPoll:
+            for (;;) {
+                ret = regmap.read(step.reg, &val);
+                if (ret < 0 || (val & step.mask) == step.val)
+                    break;
+                if (waited >= step.us) {
+                    CIRRUS_LOGE("%s: timed out waiting for 0x%x & 0x%x == 0x%x",
+                                name.c_str(), step.reg, step.mask, step.val);
+                    return -ETIMEDOUT;
+                }
+                usleep(kPollIntervalUs);
+                waited += kPollIntervalUs;
+            }
+            break;
+        case PowerStep::kDelay:
+            usleep(step.us);
+            break;
+        }
+
+        if (ret < 0) {
+            CIRRUS_LOGE("%s: power sequence access to 0x%x failed: %d", name.c_str(),
+                        step.reg, ret);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace
+
+Device::Device(const DeviceDescriptor &desc, std::string name, std::string bus,
+               std::unique_ptr<Regmap> regmap)
+    : mDesc(desc),
+      mName(std::move(name)),
+      mBus(std::move(bus)),
+      mRegmap(std::make_unique<InstrumentedRegmap>(std::move(regmap))),
+      mDsp(*mRegmap, desc.core, {desc.regions.begin(), desc.regions.end()}, mName)
+{
+}
+
+DeviceTelemetry Device::telemetry() const
+{
+    return {mRegmap->counters(), mLoadPermille.load(std::memory_order_relaxed)};
+}
+
+void Device::setDspLoadSource(uint32_t reg, uint32_t fullScale)
+{
+    mLoadReg = reg;
+    mLoadFullScale = fullScale;
+    mLoadPermille.store(-1, std::memory_order_relaxed);
+}
+
+int Device::sampleDspLoad()
+{
+    uint32_t val;
+    int ret;
+
+    if (!mLoadFullScale)
+        return -ENODATA;
+
+    ret = mRegmap->read(mLoadReg, &val);
+    if (ret < 0)
+        return ret;
+
+    val = std::min(val, mLoadFullScale);
+    mLoadPermille.store(static_cast<int32_t>(uint64_t(val) * 1000 / mLoadFullScale),
+                        std::memory_order_relaxed);
+    return 0;
+}
+
+int Device::probe()
+{
+    uint32_t devid;
+    int ret;
+
+    ret = mRegmap->read(mDesc.devidReg, &devid);
+    if (ret < 0) {
+        CIRRUS_LOGE("%s: failed to read device ID: %d", mName.c_str(), ret);
+        return ret;
+    }
+
+    if (devid != mDesc.devid) {
+        CIRRUS_LOGE("%s: device ID 0x%x, expected %s (0x%x)", mName.c_str(), devid,
+                    mDesc.part, mDesc.devid);
+        return -ENODEV;
+    }
+
+    return 0;
+}
+
+int Device::powerUp()
+{
+    TraceScope trace(TraceOp::kPowerUp, mName.c_str());
+
+    return runSequence(*mRegmap, mName, mDesc.powerUp);
+}
+
+int Device::powerDown()
+{
+    TraceScope trace(TraceOp::kPowerDown, mName.c_str());
+
+    return runSequence(*mRegmap, mName, mDesc.powerDown);
+}
+
+void Device::powerUpAsync(BusScheduler &scheduler, PowerCallback done)
+{
+    /* Errors go to the callback rather than to BusScheduler::wait(). */
+    scheduler.submit(mBus, [this, done = std::move(done)] {
+        int ret = powerUp();
+        if (done)
+            done(*this, ret);
+        return 0;
+    });
+}
+
+void Device::powerDownAsync(BusScheduler &scheduler, PowerCallback done)
+{
+    scheduler.submit(mBus, [this, done = std::move(done)] {
+        int ret = powerDown();
+        if (done)
+            done(*this, ret);
+        return 0;
+    });
+}
+
+void Device::powerUpAsync(BusScheduler &scheduler, Completion &done)
+{
+    powerUpAsync(scheduler, [&done](Device &, int ret) { done.signal(ret); });
+}
+
+void Device::powerDownAsync(BusScheduler &scheduler, Completion &done)
+{
+    powerDownAsync(scheduler, [&done](Device &, int ret) { done.signal(ret); });
+}
+
+void Device::retainOnSuspend(uint32_t reg, uint32_t len)
+{
+    mRetainedDsp.emplace_back(reg, len);
+}
+
+int Device::suspend()
+{
+    TraceScope trace(TraceOp::kSuspend, mName.c_str());
+    int ret;
+
+    mSnapshot.clear();
+    mSuspended = false;
+
+    ret = mSnapshot.captureRegisters(*mRegmap, mDesc.retained);
+    for (size_t i = 0; ret >= 0 && i < mRetainedDsp.size(); i++)
+        ret = mSnapshot.captureRange(*mRegmap, mRetainedDsp[i].first, mRetainedDsp[i].second);
+    if (ret < 0) {
+        CIRRUS_LOGE("%s: failed to capture suspend snapshot: %d", mName.c_str(), ret);
+        mSnapshot.clear();
+        return ret;
+    }
+
+    CIRRUS_LOGD("%s: snapshot of %zu bytes in %zu runs", mName.c_str(), mSnapshot.bytes(),
+                mSnapshot.runs());
+    mSuspended = true;
+    return runSequence(*mRegmap, mName, mDesc.powerDown);
+}
+
+int Device::resume(bool powerLost)
+{
+    TraceScope trace(TraceOp::kResume, mName.c_str());
+    int ret;
+
+    if (!mSuspended)
+        return -ENODATA;
+
+    if (powerLost)
+        mDsp.invalidateCache();
+
+    ret = mSnapshot.restore(*mRegmap);
+    if (ret < 0) {
+        CIRRUS_LOGE("%s: failed to restore suspend snapshot: %d", mName.c_str(), ret);
+        return ret;
+    }
+
+    mSnapshot.clear();
+    mSuspended = false;
+    return runSequence(*mRegmap, mName, mDesc.powerUp);
+}
+
+int Device::loadFirmware(const std::string &wmfwPath, const std::string &binPath)
+{
+    bool compressed = isCompressed(wmfwPath);
+    WmfwFile wmfw;
+    Lz4Stream stream;
+    bool resident;
+    int ret;
+
+    ret = compressed ? stream.open(wmfwPath) : wmfw.open(wmfwPath);
+    if (ret < 0)
+        return ret;
+
+    resident = compressed ? mDsp.firmwareResident(stream) : mDsp.firmwareResident(wmfw);
+    if (!resident) {
+        ret = mRegmap->updateBits(mDesc.coreControlReg, parts::kHaloCoreEnable, 0);
+        if (ret < 0)
+            return ret;
+
+        ret = compressed ? mDsp.loadFirmware(stream) : mDsp.loadFirmware(wmfw);
+        if (ret < 0)
+            return ret;
+
+        setDspLoadSource(0, 0);
+        mRetainedDsp.clear();
+    }
+
+    if (binPath.empty())
+        return 0;
+
+    if (mDsp.algorithms().empty()) {
+        ret = mDsp.readAlgorithms();
+        if (ret < 0)
+            return ret;
+    }
+
+    if (isCompressed(binPath)) {
+        ret = stream.open(binPath);
+        if (ret < 0)
+            return ret;
+
+        return mDsp.loadCoefficients(stream);
+    }
+
+    BinFile bin;
+    ret = bin.open(binPath);
+    if (ret < 0)
+        return ret;
+
+    return mDsp.loadCoefficients(bin);
+}
+
+int bringUpDevices(BusScheduler &scheduler, const std::vector<DeviceFirmware> &set)
+{
+    for (const DeviceFirmware &fw : set) {
+        scheduler.submit(fw.device->bus(), [fw] {
+            int ret = fw.device->loadFirmware(fw.wmfw, fw.bin);
+            if (ret < 0)
+                CIRRUS_LOGE("%s: bring-up failed: %d", fw.device->name().c_str(), ret);
+            return ret;
+        });
+    }
+
+    return scheduler.wait();
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,630 @@
+#define LOG_TAG "cirrus-dsp"
+
+#include "cirrus/hal/dsp.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iterator>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/lz4_stream.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+/* ID header layouts in words, see struct wmfw_{adsp2,halo}_id_hdr. */
+constexpr uint32_t kAdsp2IdHeaderWords = 8;
+constexpr uint32_t kAdsp2IdFirmwareWord = 2;
+constexpr uint32_t kAdsp2IdAlgCountWord = 7;
+constexpr uint32_t kHaloIdHeaderWords = 10;
+constexpr uint32_t kHaloIdFirmwareWord = 3;
+constexpr uint32_t kHaloIdAlgCountWord = 9;
+
+/* Algorithm entries: id, version, then the bases (struct wmfw_*_alg_hdr). */
+constexpr uint32_t kAdsp2AlgWords = 5;
+constexpr uint32_t kAdsp2AlgZmWord = 2;
+constexpr uint32_t kAdsp2AlgXmWord = 3;
+constexpr uint32_t kAdsp2AlgYmWord = 4;
+constexpr uint32_t kHaloAlgWords = 6;
+constexpr uint32_t kHaloAlgXmWord = 2;
+constexpr uint32_t kHaloAlgYmWord = 4;
+constexpr uint32_t kMaxAlgorithms = 1024;
+
+/* File layouts for streamed loads, see wmfw.cpp. */
+constexpr size_t kWmfwHeaderSize = 12;
+constexpr size_t kWmfwRegionSize = 8;
+constexpr size_t kBinHeaderSize = 12;
+constexpr size_t kBinBlockSize = 20;
+
+bool isTextRegion(uint16_t type)
+{
+    return type == wmfw::kNameText || type == wmfw::kInfoText ||
+           type == wmfw::kAlgorithmData || type == wmfw::kMetadata;
+}
+
+} // namespace
+
+Dsp::Dsp(Regmap &regmap, uint8_t core, std::vector<DspRegion> regions, std::string name)
+    : mRegmap(regmap), mCore(core), mName(std::move(name))
+{
+    mBases.fill(kNoRegion);
+    for (const DspRegion &region : regions) {
+        if (region.type < kRegionTypes)
+            mBases[region.type] = region.base;
+        else
+            CIRRUS_LOGE("%s: region type 0x%x is not a memory region", mName.c_str(),
+                        region.type);
+    }
+
+    /*
+     * regionToReg() steps ADSP1/ADSP2 addresses by 2 per 32-bit word; the
+     * bus must agree, or transfers stop coalescing and overlap checks fail.
+     */
+    unsigned stride = core == wmfw::kCoreHalo ? 4 : 2;
+    if (regmap.regStride() != stride)
+        CIRRUS_LOGE("%s: core %u needs a register stride of %u, not %u", mName.c_str(), core,
+                    stride, regmap.regStride());
+}
+
+int Dsp::regionToReg(uint16_t type, uint32_t offset, uint32_t *reg) const
+{
+    uint32_t base = type < kRegionTypes ? mBases[type] : kNoRegion;
+
+    if (base == kNoRegion) {
+        CIRRUS_LOGE("%s: no region of type 0x%x", mName.c_str(), type);
+        return -EINVAL;
+    }
+
+    switch (mCore) {
+    case wmfw::kCoreHalo:
+        switch (type) {
+        case wmfw::kAdsp2Xm:
+        case wmfw::kAdsp2Ym:
+            *reg = base + offset * 4;
+            return 0;
+        case wmfw::kHaloXmPacked:
+        case wmfw::kHaloYmPacked:
+            *reg = (base + offset * 3) & ~3u;
+            return 0;
+        case wmfw::kHaloPmPacked:
+            *reg = base + offset * 5;
+            return 0;
+        }
+        break;
+    case wmfw::kCoreAdsp2:
+        switch (type) {
+        case wmfw::kAdsp2Pm:
+            *reg = base + offset * 3;
+            return 0;
+        case wmfw::kAdsp2Xm:
+        case wmfw::kAdsp2Ym:
+        case wmfw::kAdsp2Zm:
+            *reg = base + offset * 2;
+            return 0;
+        }
+        break;
+    case wmfw::kCoreAdsp1:
+        switch (type) {
+        case wmfw::kAdsp1Pm:
+            *reg = base + offset * 3;
+            return 0;
+        case wmfw::kAdsp1Dm:
+        case wmfw::kAdsp2Zm:
+            *reg = base + offset * 2;
+            return 0;
+        }
+        break;
+    }
+
+    CIRRUS_LOGE("%s: region type 0x%x not valid for core %u", mName.c_str(), type, mCore);
+    return -EINVAL;
+}
+
+int Dsp::writeRegion(BulkWriter &writer, const WmfwRegion &region)
+{
+    uint32_t reg;
+    int ret;
+
+    if (isTextRegion(region.type))
+        return 0;
+
+    if (region.type == wmfw::kAbsolute) {
+        reg = region.offset;
+    } else {
+        ret = regionToReg(region.type, region.offset, &reg);
+        if (ret < 0)
+            return ret;
+    }
+
+    return writer.write(reg, region.data);
+}
+
+bool Dsp::firmwareResident(const WmfwFile &wmfw) const
+{
+    return mFirmwareValid && mFirmwareHash == wmfw.hash();
+}
+
+void Dsp::invalidateCache()
+{
+    mFirmwareValid = false;
+    mBlocks.clear();
+}
+
+int Dsp::loadFirmware(const WmfwFile &wmfw)
+{
+    TraceScope trace(TraceOp::kFirmwareLoad, mName.c_str());
+    BulkWriter writer(mRegmap);
+    uint64_t hash;
+    int ret;
+
+    if (wmfw.core() != mCore) {
+        CIRRUS_LOGE("%s: %s is for core type %u, not %u", mName.c_str(), wmfw.name().c_str(),
+                    wmfw.core(), mCore);
+        return -EINVAL;
+    }
+
+    hash = wmfw.hash();
+    if (mFirmwareValid && hash == mFirmwareHash) {
+        CIRRUS_LOGD("%s: %s already resident", mName.c_str(), wmfw.name().c_str());
+        return 0;
+    }
+
+    /* A partial download leaves nothing we can vouch for. */
+    invalidateCache();
+
+    for (const WmfwRegion &region : wmfw.regions()) {
+        ret = writeRegion(writer, region);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = writer.flush();
+    if (ret < 0)
+        return ret;
+
+    mAlgorithms.clear();
+    mFwId = 0;
+    mFirmwareHash = hash;
+    mFirmwareValid = true;
+
+    CIRRUS_LOGI("%s: loaded %s, %zu regions in %zu transfers (%zu bytes)", mName.c_str(),
+                wmfw.name().c_str(), wmfw.regions().size(), writer.transactions(),
+                writer.bytes());
+    return 0;
+}
+
+int Dsp::readAlgorithms()
+{
+    std::vector<uint8_t> buf;
+    uint32_t reg, nAlgs, hdrWords, countWord, algWords, fwWord;
+    size_t pos, chunk;
+    int ret;
+
+    switch (mCore) {
+    case wmfw::kCoreHalo:
+        hdrWords = kHaloIdHeaderWords;
+        countWord = kHaloIdAlgCountWord;
+        algWords = kHaloAlgWords;
+        fwWord = kHaloIdFirmwareWord;
+        break;
+    case wmfw::kCoreAdsp2:
+        hdrWords = kAdsp2IdHeaderWords;
+        countWord = kAdsp2IdAlgCountWord;
+        algWords = kAdsp2AlgWords;
+        fwWord = kAdsp2IdFirmwareWord;
+        break;
+    default:
+        return -EOPNOTSUPP;
+    }
+
+    ret = regionToReg(wmfw::kAdsp2Xm, 0, &reg);
+    if (ret < 0)
+        return ret;
+
+    buf.resize(hdrWords * 4);
+    ret = mRegmap.rawRead(reg, buf.data(), buf.size());
+    if (ret < 0)
+        return ret;
+
+    nAlgs = readBe32(&buf[countWord * 4]) & 0xffffff;
+    if (nAlgs > kMaxAlgorithms) {
+        CIRRUS_LOGE("%s: implausible algorithm count %u", mName.c_str(), nAlgs);
+        return -EINVAL;
+    }
+
+    mFwId = readBe32(&buf[fwWord * 4]) & 0xffffff;
+
+    buf.resize((hdrWords + nAlgs * algWords) * 4);
+    for (pos = hdrWords * 4; pos < buf.size(); pos += chunk) {
+        chunk = std::min(buf.size() - pos, mRegmap.maxRawWrite());
+        ret = mRegmap.rawRead(mRegmap.advance(reg, pos), &buf[pos], chunk);
+        if (ret < 0)
+            return ret;
+    }
+
+    mAlgorithms.clear();
+    for (uint32_t i = 0; i < nAlgs; i++) {
+        const uint8_t *p = &buf[(hdrWords + i * algWords) * 4];
+        auto word = [p](int n) { return readBe32(p + n * 4) & 0xffffff; };
+        DspAlgorithm alg = {word(0), word(1), 0, 0, 0};
+
+        if (mCore == wmfw::kCoreHalo) {
+            alg.xmBase = word(kHaloAlgXmWord);
+            alg.ymBase = word(kHaloAlgYmWord);
+        } else {
+            alg.zmBase = word(kAdsp2AlgZmWord);
+            alg.xmBase = word(kAdsp2AlgXmWord);
+            alg.ymBase = word(kAdsp2AlgYmWord);
+        }
+        mAlgorithms.push_back(alg);
+    }
+
+    CIRRUS_LOGI("%s: firmware 0x%x with %u algorithms", mName.c_str(), mFwId, nAlgs);
+    return 0;
+}
+
+const DspAlgorithm *Dsp::findAlgorithm(uint32_t id) const
+{
+    for (const DspAlgorithm &alg : mAlgorithms)
+        if (alg.id == id)
+            return &alg;
+    return nullptr;
+}
+
+int Dsp::algorithmToReg(uint32_t algId, uint16_t type, uint32_t offset, uint32_t *reg) const
+{
+    const DspAlgorithm *alg = findAlgorithm(algId);
+    uint32_t base;
+
+    if (!alg) {
+        CIRRUS_LOGE("%s: no algorithm 0x%x", mName.c_str(), algId);
+        return -EINVAL;
+    }
+
+    switch (type) {
+    case wmfw::kAdsp2Xm:
+    case wmfw::kHaloXmPacked:
+        base = alg->xmBase;
+        break;
+    case wmfw::kAdsp2Ym:
+    case wmfw::kHaloYmPacked:
+        base = alg->ymBase;
+        break;
+    default:
+        base = alg->zmBase;
+        break;
+    }
+
+    return regionToReg(type, base + offset, reg);
+}
+
+int Dsp::blockToReg(const BinBlock &blk, uint32_t *reg) const
+{
+    int ret;
+
+    switch (blk.type) {
+    case wmfw::kNameText << 8:
+    case wmfw::kInfoText << 8:
+    case wmfw::kMetadata << 8:
+        return -ENODATA;
+    case wmfw::kAbsolute << 8:
+        *reg = blk.offset;
+        return 0;
+    case wmfw::kAdsp2Xm:
+    case wmfw::kHaloXmPacked:
+    case wmfw::kAdsp2Ym:
+    case wmfw::kHaloYmPacked:
+    case wmfw::kAdsp2Zm:
+        break;
+    default:
+        CIRRUS_LOGW("%s: unknown coefficient block type 0x%x", mName.c_str(), blk.type);
+        return -ENODATA;
+    }
+
+    ret = algorithmToReg(blk.algId, blk.type, 0, reg);
+    if (ret < 0)
+        return ret;
+
+    *reg += blk.offset;
+    return 0;
+}
+
+void Dsp::recordBlock(uint32_t reg, const BlockRecord &record)
+{
+    uint32_t end = mRegmap.advance(reg, record.len);
+    auto it = mBlocks.lower_bound(reg);
+
+    /* Anything this block overwrote, even partially, is no longer known. */
+    if (it != mBlocks.begin()) {
+        auto prev = std::prev(it);
+        if (mRegmap.advance(prev->first, prev->second.len) > reg)
+            it = prev;
+    }
+    while (it != mBlocks.end() && it->first < end)
+        it = mBlocks.erase(it);
+
+    mBlocks.emplace(reg, record);
+}
+
+int Dsp::queueBlock(BulkWriter &writer, const BinBlock &blk, uint64_t hash, LoadState &state)
+{
+    uint32_t reg;
+    int ret;
+
+    ret = blockToReg(blk, &reg);
+    if (ret == -ENODATA || blk.data.empty())
+        return 0;
+    if (ret < 0)
+        return ret;
+
+    BlockRecord record = {static_cast<uint32_t>(blk.data.size), hash};
+    auto it = mBlocks.find(reg);
+    if (it != mBlocks.end() && it->second.len == record.len && it->second.hash == record.hash) {
+        state.skipped++;
+        return 0;
+    }
+
+    ret = writer.write(reg, blk.data);
+    if (ret < 0)
+        return ret;
+
+    state.written.emplace_back(reg, record);
+    return 0;
+}
+
+int Dsp::finishCoefficients(BulkWriter &writer, const LoadState &state, const std::string &name)
+{
+    int ret = writer.flush();
+
+    if (ret < 0) {
+        mBlocks.clear();
+        return ret;
+    }
+
+    for (const auto &entry : state.written)
+        recordBlock(entry.first, entry.second);
+
+    CIRRUS_LOGI("%s: loaded %s, %zu blocks (%zu unchanged) in %zu transfers (%zu bytes)",
+                mName.c_str(), name.c_str(), state.written.size() + state.skipped,
+                state.skipped, writer.transactions(), writer.bytes());
+    return 0;
+}
+
+int Dsp::loadCoefficients(const BinFile &bin)
+{
+    TraceScope trace(TraceOp::kCoefficientLoad, mName.c_str());
+    BulkWriter writer(mRegmap);
+    const std::vector<uint64_t> &hashes = bin.blockHashes();
+    LoadState state;
+    int ret;
+
+    for (size_t i = 0; i < bin.blocks().size(); i++) {
+        ret = queueBlock(writer, bin.blocks()[i], hashes[i], state);
+        if (ret < 0) {
+            mBlocks.clear();
+            return ret;
+        }
+    }
+
+    return finishCoefficients(writer, state, bin.name());
+}
+
+bool Dsp::firmwareResident(const Lz4Stream &wmfw) const
+{
+    return mFirmwareValid && mFirmwareHash == wmfw.hash();
+}
+
+int Dsp::streamRegion(BulkWriter &writer, Lz4Stream &stream, uint8_t type, uint32_t offset,
+                      uint32_t len)
+{
+    uint8_t carry[4];
+    size_t carried = 0;
+    ByteView piece;
+    uint32_t reg;
+    int ret;
+
+    if (isTextRegion(type))
+        return stream.skip(len);
+
+    if (type == wmfw::kAbsolute) {
+        reg = offset;
+    } else {
+        ret = regionToReg(type, offset, &reg);
+        if (ret < 0)
+            return ret;
+    }
+
+    while (len) {
+        ret = stream.peek(&piece);
+        if (ret < 0)
+            return ret;
+        if (piece.empty())
+            return -EINVAL;
+        piece.size = std::min<size_t>(piece.size, len);
+        stream.consume(piece.size);
+        len -= piece.size;
+
+        /* A word split across two blocks is completed and queued by value. */
+        if (carried) {
+            size_t n = std::min(sizeof(carry) - carried, piece.size);
+
+            memcpy(carry + carried, piece.data, n);
+            carried += n;
+            piece = piece.sub(n, piece.size - n);
+            if (carried < sizeof(carry))
+                continue;
+
+            ret = writer.write(reg, readBe32(carry));
+            if (ret < 0)
+                return ret;
+            reg = mRegmap.advance(reg, sizeof(carry));
+            carried = 0;
+        }
+
+        size_t whole = piece.size & ~(sizeof(carry) - 1);
+        if (whole) {
+            ret = writer.write(reg, piece.sub(0, whole));
+            if (ret < 0)
+                return ret;
+            reg = mRegmap.advance(reg, whole);
+        }
+
+        carried = piece.size - whole;
+        memcpy(carry, piece.data + whole, carried);
+    }
+
+    if (carried) {
+        CIRRUS_LOGE("%s: region of type 0x%x is not a whole number of words", mName.c_str(),
+                    type);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int Dsp::loadFirmware(Lz4Stream &wmfw)
+{
+    TraceScope trace(TraceOp::kFirmwareLoad, mName.c_str());
+    BulkWriter writer(mRegmap);
+    uint8_t hdr[kWmfwHeaderSize];
+    size_t regions = 0;
+    uint64_t hash;
+    int ret;
+
+    hash = wmfw.hash();
+    if (mFirmwareValid && hash == mFirmwareHash) {
+        CIRRUS_LOGD("%s: %s already resident", mName.c_str(), wmfw.name().c_str());
+        return 0;
+    }
+
+    invalidateCache();
+
+    /* Views into a decoded block must reach the bus before it is reused. */
+    wmfw.setBlockHook([&writer] { return writer.flush(); });
+
+    ret = wmfw.read(hdr, sizeof(hdr));
+    if (ret >= 0 && (ret != sizeof(hdr) || memcmp(hdr, "WMFW", 4) != 0))
+        ret = -EINVAL;
+    if (ret >= 0 && (hdr[10] != mCore || hdr[11] > 3 || readLe32(hdr + 4) < sizeof(hdr)))
+        ret = -EINVAL;
+    if (ret >= 0)
+        ret = wmfw.skip(readLe32(hdr + 4) - sizeof(hdr));
+
+    while (ret >= 0) {
+        uint8_t region[kWmfwRegionSize];
+
+        ret = wmfw.read(region, sizeof(region));
+        if (ret == 0)
+            break;
+        if (ret > 0 && ret != sizeof(region))
+            ret = -EINVAL;
+        if (ret < 0)
+            break;
+
+        ret = streamRegion(writer, wmfw, region[3], readLe32(region) & 0xffffff,
+                           readLe32(region + 4));
+        regions++;
+    }
+
+    if (ret >= 0)
+        ret = writer.flush();
+    wmfw.setBlockHook(nullptr);
+    if (ret < 0) {
+        CIRRUS_LOGE("%s: streamed load of %s failed: %d", mName.c_str(), wmfw.name().c_str(),
+                    ret);
+        return ret;
+    }
+
+    mAlgorithms.clear();
+    mFwId = 0;
+    mFirmwareHash = hash;
+    mFirmwareValid = true;
+
+    CIRRUS_LOGI("%s: loaded %s, %zu regions in %zu transfers (%zu bytes)", mName.c_str(),
+                wmfw.name().c_str(), regions, writer.transactions(), writer.bytes());
+    return 0;
+}
+
+int Dsp::loadCoefficients(Lz4Stream &bin)
+{
+    TraceScope trace(TraceOp::kCoefficientLoad, mName.c_str());
+    BulkWriter writer(mRegmap);
+    /* Payloads that straddle two decoded blocks, kept until the next flush. */
+    std::deque<std::vector<uint8_t>> staged;
+    uint8_t hdr[kBinBlockSize];
+    LoadState state;
+    int ret;
+
+    bin.setBlockHook([&writer, &staged] {
+        int ret = writer.flush();
+        staged.clear();
+        return ret;
+    });
+
+    ret = bin.read(hdr, kBinHeaderSize);
+    if (ret >= 0 && (ret != kBinHeaderSize || memcmp(hdr, "WMDR", 4) != 0 ||
+                     readLe32(hdr + 4) < kBinHeaderSize ||
+                     (readBe32(hdr + 8) & 0xff) < 1 || (readBe32(hdr + 8) & 0xff) > 2))
+        ret = -EINVAL;
+    if (ret >= 0)
+        ret = bin.skip(readLe32(hdr + 4) - kBinHeaderSize);
+
+    while (ret >= 0) {
+        ByteView piece;
+        BinBlock blk;
+        uint32_t len;
+
+        ret = bin.read(hdr, kBinBlockSize);
+        if (ret == 0)
+            break;
+        if (ret > 0 && ret != kBinBlockSize)
+            ret = -EINVAL;
+        if (ret >= 0)
+            ret = bin.peek(&piece);
+        if (ret < 0)
+            break;
+
+        len = readLe32(hdr + 16);
+        blk = {readLe16(hdr + 2), readLe16(hdr), readLe32(hdr + 4), readLe32(hdr + 8) >> 8,
+               readLe32(hdr + 12), {}};
+
+        if (piece.size >= len) {
+            blk.data = piece.sub(0, len);
+            bin.consume(len);
+        } else {
+            std::vector<uint8_t> copy(len);
+            ret = bin.read(copy.data(), len);
+            if (ret >= 0 && static_cast<uint32_t>(ret) != len)
+                ret = -EINVAL;
+            if (ret < 0)
+                break;
+            /* Reading may have run the hook, so stage after it. */
+            staged.push_back(std::move(copy));
+            blk.data = {staged.back().data(), len};
+        }
+
+        ret = queueBlock(writer, blk, contentHash(blk.data), state);
+        /* Blocks are padded to a 32-bit boundary. */
+        if (ret >= 0)
+            ret = bin.skip(((len + 3) & ~3u) - len);
+    }
+
+    bin.setBlockHook(nullptr);
+    if (ret < 0) {
+        CIRRUS_LOGE("%s: streamed load of %s failed: %d", mName.c_str(), bin.name().c_str(),
+                    ret);
+        mBlocks.clear();
+        return ret;
+    }
+
+    return finishCoefficients(writer, state, bin.name());
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,56 @@
+#define LOG_TAG "cirrus-file-util"
+
+#include "cirrus/hal/file_util.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+int writeFileAtomic(const std::string &path, const void *data, size_t len)
+{
+    std::string tmp = path + ".tmp";
+    const auto *p = static_cast<const uint8_t *>(data);
+    size_t done = 0;
+    int fd, ret = 0;
+
+    fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ret = -errno;
+        CIRRUS_LOGE("Failed to create %s: %s", tmp.c_str(), strerror(errno));
+        return ret;
+    }
+
+    while (done < len) {
+        ssize_t n = ::write(fd, p + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ret = -errno;
+            break;
+        }
+        done += n;
+    }
+
+    if (!ret && fsync(fd) < 0)
+        ret = -errno;
+    ::close(fd);
+
+    if (!ret && rename(tmp.c_str(), path.c_str()) < 0)
+        ret = -errno;
+
+    if (ret < 0) {
+        CIRRUS_LOGE("Failed to write %s: %s", path.c_str(), strerror(-ret));
+        unlink(tmp.c_str());
+    }
+
+    return ret;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,234 @@
+#define LOG_TAG "cirrus-firmware"
+
+#include "cirrus/hal/firmware_manager.h"
+
+#include <cerrno>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+FirmwareManager::FirmwareManager(BusScheduler &scheduler) : mScheduler(scheduler)
+{
+}
+
+FirmwareManager::~FirmwareManager()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    mDone.wait(lock, [this] { return mQueued == 0; });
+}
+
+int FirmwareManager::declare(const std::string &useCase, std::vector<DeviceFirmware> needs)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    UseCase &uc = mUseCases[useCase];
+
+    if (uc.acquired)
+        return -EBUSY;
+
+    uc.needs = std::move(needs);
+    return 0;
+}
+
+size_t FirmwareManager::downloads() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mDownloads;
+}
+
+void FirmwareManager::submit(Device *device, bool power, const DeviceFirmware &need,
+                             Pending *pending)
+{
+    Slot &slot = slotOf(device);
+
+    slot.wantWmfw = need.wmfw;
+    slot.wantBin = need.bin;
+    mQueued++;
+
+    /* Errors go to the waiter, or the log, rather than to BusScheduler::wait(). */
+    mScheduler.submit(device->bus(), [this, device, power, need, pending] {
+        finish(pending, bringUp(device, power, need));
+        return 0;
+    });
+}
+
+void FirmwareManager::submitPowerDown(Device *device)
+{
+    Slot &slot = slotOf(device);
+
+    slot.wantWmfw.clear();
+    slot.wantBin.clear();
+    mQueued++;
+
+    mScheduler.submit(device->bus(), [this, device] {
+        bool powered;
+        int ret = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            powered = slotOf(device).powered;
+        }
+
+        if (powered) {
+            ret = device->powerDown();
+            /* Powered off, the DSP keeps nothing we can vouch for. */
+            device->dsp().invalidateCache();
+
+            std::lock_guard<std::mutex> lock(mLock);
+            Slot &s = slotOf(device);
+            s.powered = false;
+            s.wmfw.clear();
+            s.bin.clear();
+        }
+
+        finish(nullptr, ret);
+        return 0;
+    });
+}
+
+int FirmwareManager::bringUp(Device *device, bool power, const DeviceFirmware &need)
+{
+    bool loaded, powered;
+    int ret;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        Slot &slot = slotOf(device);
+        loaded = slot.wmfw == need.wmfw && slot.bin == need.bin;
+        powered = slot.powered;
+    }
+
+    if (!loaded) {
+        CIRRUS_LOGI("%s: loading %s%s", device->name().c_str(), need.wmfw.c_str(),
+                    power ? "" : " (prefetch)");
+        ret = device->loadFirmware(need.wmfw, need.bin);
+
+        std::lock_guard<std::mutex> lock(mLock);
+        Slot &slot = slotOf(device);
+        mDownloads++;
+        slot.wmfw = ret == 0 ? need.wmfw : std::string();
+        slot.bin = ret == 0 ? need.bin : std::string();
+        if (ret < 0) {
+            CIRRUS_LOGE("%s: firmware load failed: %d", device->name().c_str(), ret);
+            return ret;
+        }
+    }
+
+    if (!power || powered)
+        return 0;
+
+    ret = device->powerUp();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    slotOf(device).powered = ret == 0;
+    return ret;
+}
+
+void FirmwareManager::finish(Pending *pending, int ret)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mQueued--;
+    if (pending) {
+        if (ret < 0 && !pending->error)
+            pending->error = ret;
+        pending->left--;
+    }
+    mDone.notify_all();
+}
+
+int FirmwareManager::prefetch(const std::string &useCase)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mUseCases.find(useCase);
+
+    if (it == mUseCases.end())
+        return -ENOENT;
+
+    for (const DeviceFirmware &need : it->second.needs) {
+        Slot &slot = slotOf(need.device);
+
+        if (slot.wantWmfw == need.wmfw && slot.wantBin == need.bin)
+            continue;
+        if (slot.users) {
+            CIRRUS_LOGD("%s: in use, not prefetching %s", need.device->name().c_str(),
+                        need.wmfw.c_str());
+            continue;
+        }
+
+        submit(need.device, false, need, nullptr);
+    }
+
+    return 0;
+}
+
+int FirmwareManager::acquire(const std::string &useCase)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mUseCases.find(useCase);
+    Pending pending;
+
+    if (it == mUseCases.end())
+        return -ENOENT;
+
+    UseCase &uc = it->second;
+
+    for (const DeviceFirmware &need : uc.needs) {
+        Slot &slot = slotOf(need.device);
+
+        if (slot.users && (slot.wantWmfw != need.wmfw || slot.wantBin != need.bin)) {
+            CIRRUS_LOGE("%s: %s needs %s but %s is active", useCase.c_str(),
+                        need.device->name().c_str(), need.wmfw.c_str(), slot.wantWmfw.c_str());
+            return -EBUSY;
+        }
+    }
+
+    /*
+     * Queue behind anything already running on each bus, even for devices
+     * another use case holds, so we never return before they are ready.
+     */
+    for (const DeviceFirmware &need : uc.needs) {
+        slotOf(need.device).users++;
+        pending.left++;
+        submit(need.device, true, need, &pending);
+    }
+    uc.acquired++;
+
+    mDone.wait(lock, [&pending] { return pending.left == 0; });
+
+    if (pending.error) {
+        releaseLocked(uc);
+        return pending.error;
+    }
+
+    return 0;
+}
+
+int FirmwareManager::releaseLocked(UseCase &uc)
+{
+    if (!uc.acquired)
+        return -EINVAL;
+
+    uc.acquired--;
+    for (const DeviceFirmware &need : uc.needs) {
+        if (--slotOf(need.device).users == 0)
+            submitPowerDown(need.device);
+    }
+
+    return 0;
+}
+
+int FirmwareManager::release(const std::string &useCase)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mUseCases.find(useCase);
+
+    if (it == mUseCases.end())
+        return -ENOENT;
+
+    return releaseLocked(it->second);
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,228 @@
+#define LOG_TAG "cirrus-gain-ramp"
+
+#include "cirrus/hal/gain_ramp.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+int32_t decodeGain(const GainField &field, uint32_t val)
+{
+    uint32_t width = __builtin_popcount(field.mask >> field.shift);
+    uint32_t raw = (val & field.mask) >> field.shift;
+    int32_t steps = static_cast<int32_t>(raw << (32 - width)) >> (32 - width);
+
+    return steps * field.stepMdB;
+}
+
+} // namespace
+
+GainRamp::GainRamp(BusScheduler &scheduler, std::vector<Device *> amps) : mScheduler(scheduler)
+{
+    for (Device *device : amps) {
+        const GainField &field = device->descriptor().gain;
+
+        if (!field.reg) {
+            CIRRUS_LOGE("%s: %s has no register gain", device->name().c_str(),
+                        device->descriptor().part);
+            mSupported = false;
+        }
+
+        auto bus = std::find_if(mBuses.begin(), mBuses.end(),
+                                [device](const Bus &b) { return b.name == device->bus(); });
+        if (bus == mBuses.end()) {
+            mBuses.push_back({device->bus(), nullptr, {}, {}});
+            bus = mBuses.end() - 1;
+        }
+
+        bus->amps.push_back(mAmps.size());
+        bus->vals.push_back(0);
+        mAmps.push_back({device, &field, 0, 0, 0, 0});
+    }
+}
+
+GainRamp::~GainRamp()
+{
+    cancel();
+    wait();
+}
+
+void GainRamp::setBroadcast(const std::string &bus, Regmap &regmap)
+{
+    for (Bus &b : mBuses) {
+        if (b.name == bus)
+            b.broadcast = &regmap;
+    }
+}
+
+int GainRamp::start(int32_t target, uint32_t durationMs, uint32_t stepMs)
+{
+    return start(std::vector<int32_t>(mAmps.size(), target), durationMs, stepMs);
+}
+
+int GainRamp::start(const std::vector<int32_t> &targets, uint32_t durationMs, uint32_t stepMs)
+{
+    if (mActive.load())
+        return -EBUSY;
+    if (!mSupported)
+        return -EOPNOTSUPP;
+    if (targets.size() != mAmps.size() || !stepMs)
+        return -EINVAL;
+
+    if (mThread.joinable())
+        mThread.join();
+
+    for (size_t i = 0; i < mAmps.size(); i++) {
+        const GainField &field = *mAmps[i].field;
+        mAmps[i].toMdB = std::clamp(targets[i], field.minMdB, field.maxMdB);
+    }
+
+    mError = 0;
+    mWrites.store(0);
+    mCancel.store(false);
+    mActive.store(true);
+    mThread = std::thread(&GainRamp::run, this, std::max(durationMs / stepMs, 1u), stepMs);
+
+    return 0;
+}
+
+int GainRamp::wait()
+{
+    if (mThread.joinable())
+        mThread.join();
+
+    return mError;
+}
+
+uint32_t GainRamp::encode(const Amp &amp, int32_t mdB) const
+{
+    const GainField &field = *amp.field;
+    /* Round to the nearest step, away from zero on ties. */
+    int32_t half = mdB < 0 ? -field.stepMdB / 2 : field.stepMdB / 2;
+    int32_t steps = (mdB + half) / field.stepMdB;
+
+    return amp.base | ((static_cast<uint32_t>(steps) << field.shift) & field.mask);
+}
+
+/* Run @job once per bus, all buses concurrently, and wait for them all. */
+int GainRamp::runOnBuses(const std::function<int(Bus &)> &job)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    int error = 0;
+
+    mOutstanding = mBuses.size();
+    for (Bus &bus : mBuses) {
+        mScheduler.submit(bus.name, [this, &job, &bus, &error] {
+            int ret = job(bus);
+
+            std::lock_guard<std::mutex> guard(mLock);
+            if (ret < 0 && !error)
+                error = ret;
+            if (--mOutstanding == 0)
+                mStepDone.notify_all();
+            /* Reported through wait(), not BusScheduler::wait(). */
+            return 0;
+        });
+    }
+
+    mStepDone.wait(lock, [this] { return mOutstanding == 0; });
+    return error;
+}
+
+int GainRamp::prepare()
+{
+    return runOnBuses([this](Bus &bus) {
+        for (size_t i : bus.amps) {
+            Amp &amp = mAmps[i];
+            uint32_t val;
+
+            int ret = amp.device->regmap().read(amp.field->reg, &val);
+            if (ret < 0) {
+                CIRRUS_LOGE("%s: failed to read gain: %d", amp.device->name().c_str(), ret);
+                return ret;
+            }
+
+            amp.base = val & ~amp.field->mask;
+            amp.last = val;
+            amp.fromMdB = decodeGain(*amp.field, val);
+        }
+        return 0;
+    });
+}
+
+int GainRamp::writeStep(Bus &bus, uint32_t step, uint32_t steps)
+{
+    std::vector<uint32_t> &vals = bus.vals;
+    bool changed = false, uniform = true;
+    int ret;
+
+    for (size_t n = 0; n < bus.amps.size(); n++) {
+        const Amp &amp = mAmps[bus.amps[n]];
+        int64_t span = static_cast<int64_t>(amp.toMdB) - amp.fromMdB;
+        int32_t mdB = amp.fromMdB + static_cast<int32_t>(span * step / steps);
+
+        vals[n] = encode(amp, mdB);
+        changed |= vals[n] != amp.last;
+        uniform &= vals[n] == vals[0] && amp.field->reg == mAmps[bus.amps[0]].field->reg;
+    }
+
+    if (!changed)
+        return 0;
+
+    if (bus.broadcast && bus.amps.size() > 1 && uniform) {
+        ret = bus.broadcast->write(mAmps[bus.amps[0]].field->reg, vals[0]);
+        if (ret < 0)
+            return ret;
+
+        mWrites++;
+        for (size_t i : bus.amps)
+            mAmps[i].last = vals[0];
+        return 0;
+    }
+
+    for (size_t n = 0; n < bus.amps.size(); n++) {
+        Amp &amp = mAmps[bus.amps[n]];
+
+        if (vals[n] == amp.last)
+            continue;
+
+        ret = amp.device->regmap().write(amp.field->reg, vals[n]);
+        if (ret < 0) {
+            CIRRUS_LOGE("%s: failed to write gain: %d", amp.device->name().c_str(), ret);
+            return ret;
+        }
+
+        mWrites++;
+        amp.last = vals[n];
+    }
+
+    return 0;
+}
+
+void GainRamp::run(uint32_t steps, uint32_t stepMs)
+{
+    auto next = std::chrono::steady_clock::now();
+    int ret;
+
+    ret = prepare();
+
+    for (uint32_t step = 1; ret == 0 && step <= steps && !mCancel.load(); step++) {
+        ret = runOnBuses([this, step, steps](Bus &bus) { return writeStep(bus, step, steps); });
+
+        /* Pace against the start time so late steps do not stretch the ramp. */
+        next += std::chrono::milliseconds(stepMs);
+        if (step < steps)
+            std::this_thread::sleep_until(next);
+    }
+
+    mError = ret;
+    mActive.store(false);
+}
+
+} // namespace cirrus::hal
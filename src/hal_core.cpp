@@ -0,0 +1,105 @@
+#define LOG_TAG "cirrus-hal-core"
+
+#include "cirrus/hal/hal_core.h"
+
+#include <cerrno>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+int HalCore::addDevice(std::unique_ptr<Device> device)
+{
+    std::unique_lock<std::shared_mutex> lock(mRegistryLock);
+    const std::string &name = device->name();
+
+    if (mDevices.count(name)) {
+        CIRRUS_LOGE("Device %s is already registered", name.c_str());
+        return -EEXIST;
+    }
+
+    auto node = std::make_shared<Node>();
+    node->device = std::move(device);
+    mDevices.emplace(node->device->name(), std::move(node));
+    return 0;
+}
+
+int HalCore::removeDevice(const std::string &name)
+{
+    std::shared_ptr<Node> node;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mRegistryLock);
+        auto it = mDevices.find(name);
+
+        if (it == mDevices.end())
+            return -ENODEV;
+
+        node = std::move(it->second);
+        mDevices.erase(it);
+    }
+
+    /* Wait out current holders; new lookups can no longer find it. */
+    std::unique_lock<std::shared_mutex> lock(node->lock);
+    return 0;
+}
+
+std::vector<std::string> HalCore::deviceNames() const
+{
+    std::shared_lock<std::shared_mutex> lock(mRegistryLock);
+    std::vector<std::string> names;
+
+    names.reserve(mDevices.size());
+    for (const auto &entry : mDevices)
+        names.push_back(entry.first);
+    return names;
+}
+
+std::shared_ptr<HalCore::Node> HalCore::find(const std::string &name) const
+{
+    std::shared_lock<std::shared_mutex> lock(mRegistryLock);
+    auto it = mDevices.find(name);
+
+    return it == mDevices.end() ? nullptr : it->second;
+}
+
+HalCore::DeviceLock HalCore::lock(const std::string &name) const
+{
+    std::shared_ptr<Node> node = find(name);
+
+    return node ? DeviceLock(std::move(node)) : DeviceLock();
+}
+
+HalCore::DeviceLock HalCore::tryLock(const std::string &name) const
+{
+    std::shared_ptr<Node> node = find(name);
+
+    return node ? DeviceLock(std::move(node), std::try_to_lock) : DeviceLock();
+}
+
+HalCore::DeviceReadLock HalCore::lockShared(const std::string &name) const
+{
+    std::shared_ptr<Node> node = find(name);
+
+    return node ? DeviceReadLock(std::move(node)) : DeviceReadLock();
+}
+
+int HalCore::submit(BusScheduler &scheduler, const std::string &name, Job job) const
+{
+    std::shared_ptr<Node> node = find(name);
+
+    if (!node)
+        return -ENODEV;
+
+    scheduler.submit(node->device->bus(), [this, name, job = std::move(job)] {
+        DeviceLock device = lock(name);
+
+        /* Removed while the job was queued. */
+        if (!device)
+            return -ENODEV;
+        return job(*device);
+    });
+    return 0;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,150 @@
+#define LOG_TAG "cirrus-haptic-stream"
+
+#include "cirrus/hal/haptic_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+HapticStream::HapticStream(Regmap &regmap, const HapticStreamConfig &config, size_t firstChunk)
+    : mRegmap(regmap),
+      mWriter(regmap),
+      mConfig(config),
+      mFirstChunk(std::min<size_t>(firstChunk, config.ringWords - 1))
+{
+    size_t chunk = std::max<size_t>(mFirstChunk, config.ringWords / 2);
+
+    mSamples.resize(chunk);
+    mStage.resize(chunk * 4);
+    /* A refill queues at most two views, either side of the wrap. */
+    mWriter.reserve(2);
+}
+
+HapticStream::~HapticStream()
+{
+    if (mFeeder.joinable())
+        stop();
+}
+
+int HapticStream::fill(size_t words, bool *done)
+{
+    size_t n, first;
+    int ret;
+
+    n = mSource(mSamples.data(), std::min(words, mSamples.size()));
+    *done = n == 0;
+    if (!n)
+        return 0;
+
+    for (size_t i = 0; i < n; i++)
+        writeBe32(&mStage[i * 4], static_cast<uint32_t>(mSamples[i]) & 0xffffff);
+
+    first = std::min<size_t>(n, mConfig.ringWords - mWriteIndex);
+    ret = mWriter.write(mConfig.ringReg + mWriteIndex * 4, ByteView{mStage.data(), first * 4});
+    if (ret < 0)
+        return ret;
+
+    ret = mWriter.write(mConfig.ringReg, ByteView{mStage.data() + first * 4, (n - first) * 4});
+    if (ret < 0)
+        return ret;
+
+    ret = mWriter.flush();
+    if (ret < 0)
+        return ret;
+
+    mWriteIndex = (mWriteIndex + n) % mConfig.ringWords;
+    return mRegmap.write(mConfig.writeIndexReg, mWriteIndex);
+}
+
+int HapticStream::play(Source source)
+{
+    TraceScope trace(TraceOp::kHapticTrigger, "stream");
+    bool done;
+    int ret;
+
+    if (!mConfig.rate) {
+        CIRRUS_LOGE("Haptic stream rate must not be 0");
+        return -EINVAL;
+    }
+
+    if (mFeeder.joinable()) {
+        ret = stop();
+        if (ret < 0)
+            return ret;
+    }
+
+    mSource = std::move(source);
+    mWriteIndex = 0;
+    mUnderruns.store(0);
+
+    ret = fill(mFirstChunk, &done);
+    if (ret < 0)
+        return ret;
+
+    ret = mRegmap.write(mConfig.controlReg, mConfig.startValue);
+    if (ret < 0)
+        return ret;
+
+    if (!done) {
+        mActive.store(true);
+        mFeeder = std::thread(&HapticStream::feed, this);
+    }
+
+    return 0;
+}
+
+void HapticStream::feed()
+{
+    const uint32_t size = mConfig.ringWords;
+    const uint32_t half = size / 2;
+    uint32_t readIndex, used, space;
+    bool done = false;
+    int ret = 0;
+
+    while (!done && !mStopping.load()) {
+        ret = mRegmap.read(mConfig.readIndexReg, &readIndex);
+        if (ret < 0)
+            break;
+
+        used = (mWriteIndex + size - readIndex % size) % size;
+        space = size - 1 - used;
+        if (!used)
+            mUnderruns.fetch_add(1);
+
+        if (space < half) {
+            /* Sleep until the firmware has drained the rest of a half. */
+            auto wait = std::chrono::microseconds(uint64_t(half - space) * 1000000 / mConfig.rate);
+            std::this_thread::sleep_for(wait);
+            continue;
+        }
+
+        ret = fill(space, &done);
+        if (ret < 0)
+            break;
+    }
+
+    if (ret < 0)
+        CIRRUS_LOGE("Streaming stopped on bus error: %d", ret);
+
+    mActive.store(false);
+}
+
+int HapticStream::stop()
+{
+    mStopping.store(true);
+    if (mFeeder.joinable())
+        mFeeder.join();
+    mStopping.store(false);
+    mSource = nullptr;
+
+    return mRegmap.write(mConfig.controlReg, mConfig.stopValue);
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,153 @@
+#define LOG_TAG "cirrus-haptics"
+
+#include "cirrus/hal/haptics.h"
+
+#include <cerrno>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kMaxSections = 255;
+constexpr uint8_t kMaxAmplitude = 100;
+
+static_assert(sizeof(HapticPrimitive) == 6, "HapticPrimitive is hashed as raw bytes");
+
+} // namespace
+
+int compileComposition(const HapticComposition &composition, std::vector<int32_t> *words)
+{
+    const std::vector<HapticPrimitive> &sections = composition.sections;
+
+    if (sections.empty() || sections.size() > kMaxSections) {
+        CIRRUS_LOGE("Composition has %zu sections, must be 1-%zu", sections.size(),
+                    kMaxSections);
+        return -EINVAL;
+    }
+
+    words->clear();
+    words->reserve(1 + sections.size() * 2);
+    words->push_back(composition.repeat << 8 | static_cast<int32_t>(sections.size()));
+
+    for (const HapticPrimitive &s : sections) {
+        if (s.amplitude > kMaxAmplitude) {
+            CIRRUS_LOGE("Section amplitude %u%% is out of range", s.amplitude);
+            return -EINVAL;
+        }
+
+        words->push_back(s.amplitude << 16 | s.index << 8 | s.repeat);
+        words->push_back(s.flags << 16 | s.delayMs);
+    }
+
+    return 0;
+}
+
+uint64_t compositionHash(const HapticComposition &composition)
+{
+    ByteView sections = {reinterpret_cast<const uint8_t *>(composition.sections.data()),
+                         composition.sections.size() * sizeof(HapticPrimitive)};
+
+    return contentHash(sections, composition.repeat);
+}
+
+Haptics::Haptics(Regmap &regmap, const HapticsConfig &config)
+    : mRegmap(regmap), mConfig(config)
+{
+}
+
+int Haptics::loadWavetable(const std::string &path)
+{
+    mLoaded = false;
+
+    return mWavetable.open(path);
+}
+
+int Haptics::perform(uint32_t index)
+{
+    TraceScope trace(TraceOp::kHapticTrigger);
+    WaveEffect fx;
+    int ret;
+
+    if (!mLoaded || mLoadedProgram || mLoadedKey != index) {
+        ret = mWavetable.effect(index, &fx);
+        if (ret < 0) {
+            CIRRUS_LOGE("No effect %u in wavetable", index);
+            return ret;
+        }
+
+        ret = upload(fx.data);
+        if (ret < 0)
+            return ret;
+
+        mLoadedProgram = false;
+        mLoadedKey = index;
+    }
+
+    return mRegmap.write(mConfig.triggerReg, mConfig.triggerValue);
+}
+
+int Haptics::perform(const HapticComposition &composition)
+{
+    TraceScope trace(TraceOp::kHapticTrigger, "composite");
+    uint64_t hash = compositionHash(composition);
+    int ret;
+
+    if (!mLoaded || !mLoadedProgram || mLoadedKey != hash) {
+        auto it = mPrograms.find(hash);
+
+        if (it == mPrograms.end()) {
+            std::vector<int32_t> words;
+
+            ret = compileComposition(composition, &words);
+            if (ret < 0)
+                return ret;
+
+            /* Compositions come from a small UI set; a full cache just restarts. */
+            if (mPrograms.size() >= kMaxPrograms)
+                mPrograms.clear();
+
+            std::vector<uint8_t> program(words.size() * 4);
+            for (size_t i = 0; i < words.size(); i++)
+                writeBe32(&program[i * 4], static_cast<uint32_t>(words[i]) & 0xffffff);
+            it = mPrograms.emplace(hash, std::move(program)).first;
+        }
+
+        ret = upload({it->second.data(), it->second.size()});
+        if (ret < 0)
+            return ret;
+
+        mLoadedProgram = true;
+        mLoadedKey = hash;
+    }
+
+    return mRegmap.write(mConfig.triggerReg, mConfig.triggerValue);
+}
+
+int Haptics::upload(ByteView data)
+{
+    BulkWriter writer(mRegmap);
+    int ret;
+
+    if (data.size > mConfig.slotBytes) {
+        CIRRUS_LOGE("Effect is %zu bytes, slot holds %u", data.size, mConfig.slotBytes);
+        return -ENOSPC;
+    }
+
+    mLoaded = false;
+    ret = writer.write(mConfig.slotReg, data);
+    if (ret == 0)
+        ret = writer.flush();
+    if (ret < 0)
+        return ret;
+
+    mLoaded = true;
+    return 0;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,321 @@
+#define LOG_TAG "cirrus-irq"
+
+#include "cirrus/hal/irq_monitor.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kUeventBufferSize = 4096;
+
+} // namespace
+
+const char *irqEventName(IrqEvent event)
+{
+    switch (event) {
+    case IrqEvent::kOverTemperature:
+        return "over-temperature";
+    case IrqEvent::kShortCircuit:
+        return "short-circuit";
+    case IrqEvent::kMailbox:
+        return "mailbox";
+    case IrqEvent::kHapticComplete:
+        return "haptic-complete";
+    case IrqEvent::kCount:
+        break;
+    }
+    return "unknown";
+}
+
+IrqMonitor::IrqMonitor(BusScheduler &scheduler) : mScheduler(scheduler)
+{
+}
+
+IrqMonitor::~IrqMonitor()
+{
+    stop();
+
+    for (const Source &source : mSources) {
+        if (source.owned)
+            ::close(source.fd);
+    }
+}
+
+IrqMonitor::Target *IrqMonitor::targetFor(Device &device)
+{
+    for (const auto &target : mTargets) {
+        if (target->device == &device)
+            return target.get();
+    }
+
+    mTargets.push_back(std::make_unique<Target>());
+    mTargets.back()->device = &device;
+    return mTargets.back().get();
+}
+
+int IrqMonitor::addSysfs(Device &device, const std::string &path)
+{
+    char buf[64];
+    int fd;
+
+    if (mRunning.load())
+        return -EBUSY;
+
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", path.c_str(), strerror(errno));
+        return ret;
+    }
+
+    /* sysfs_notify() only wakes readers that have consumed the attribute. */
+    if (read(fd, buf, sizeof(buf)) < 0)
+        CIRRUS_LOGW("Failed to read %s: %s", path.c_str(), strerror(errno));
+
+    mSources.push_back({SourceKind::kSysfs, fd, true, targetFor(device), {}});
+    return 0;
+}
+
+int IrqMonitor::addUevent(Device &device, const std::string &match)
+{
+    struct sockaddr_nl addr = {};
+    int fd;
+
+    if (mRunning.load())
+        return -EBUSY;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to open uevent socket: %s", strerror(errno));
+        return ret;
+    }
+
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to bind uevent socket: %s", strerror(errno));
+        ::close(fd);
+        return ret;
+    }
+
+    mSources.push_back({SourceKind::kUevent, fd, true, targetFor(device), match});
+    return 0;
+}
+
+int IrqMonitor::addFd(Device &device, int fd)
+{
+    if (mRunning.load())
+        return -EBUSY;
+
+    mSources.push_back({SourceKind::kFd, fd, false, targetFor(device), {}});
+    return 0;
+}
+
+void IrqMonitor::subscribe(IrqEvent event, Handler handler)
+{
+    std::lock_guard<std::mutex> guard(mHandlerLock);
+
+    mHandlers[static_cast<size_t>(event)].push_back(std::move(handler));
+}
+
+int IrqMonitor::start()
+{
+    if (mRunning.load())
+        return -EBUSY;
+
+    mWakeFd = eventfd(0, EFD_CLOEXEC);
+    if (mWakeFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to create eventfd: %s", strerror(errno));
+        return ret;
+    }
+
+    mRunning.store(true);
+    mThread = std::thread(&IrqMonitor::run, this);
+
+    return 0;
+}
+
+void IrqMonitor::stop()
+{
+    uint64_t one = 1;
+
+    if (mRunning.exchange(false)) {
+        if (write(mWakeFd, &one, sizeof(one)) < 0)
+            CIRRUS_LOGE("eventfd write failed: %s", strerror(errno));
+        mThread.join();
+
+        ::close(mWakeFd);
+        mWakeFd = -1;
+    }
+
+    /* Queued service jobs point at our targets. */
+    std::unique_lock<std::mutex> lock(mJobLock);
+    mJobsIdle.wait(lock, [this] { return mJobs == 0; });
+}
+
+void IrqMonitor::trigger(Device &device)
+{
+    for (const auto &target : mTargets) {
+        if (target->device == &device) {
+            service(target.get());
+            return;
+        }
+    }
+}
+
+/* Consume the notification; returns true if it is an interrupt for us. */
+bool IrqMonitor::drain(const Source &source)
+{
+    char buf[kUeventBufferSize];
+    ssize_t len;
+
+    switch (source.kind) {
+    case SourceKind::kSysfs:
+        if (lseek(source.fd, 0, SEEK_SET) < 0 || read(source.fd, buf, sizeof(buf)) < 0)
+            CIRRUS_LOGW("sysfs read failed: %s", strerror(errno));
+        return true;
+    case SourceKind::kFd:
+        if (read(source.fd, buf, sizeof(buf)) < 0 && errno != EAGAIN)
+            CIRRUS_LOGW("IRQ fd read failed: %s", strerror(errno));
+        return true;
+    case SourceKind::kUevent:
+        break;
+    }
+
+    bool matched = false;
+
+    /* A uevent is a series of NUL-terminated KEY=value fields. */
+    while ((len = recv(source.fd, buf, sizeof(buf) - 1, 0)) > 0) {
+        buf[len] = '\0';
+        for (const char *field = buf; field < buf + len; field += strlen(field) + 1) {
+            if (source.match == field)
+                matched = true;
+        }
+    }
+
+    return matched;
+}
+
+void IrqMonitor::service(Target *target)
+{
+    if (target->queued.exchange(true))
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(mJobLock);
+        mJobs++;
+    }
+
+    mScheduler.submit(target->device->bus(), [this, target] {
+        Device &device = *target->device;
+        const Table<IrqBit> &irqs = device.descriptor().irqs;
+        Regmap &regmap = device.regmap();
+
+        /* Clear first so an interrupt raised from here on queues again. */
+        target->queued.store(false);
+
+        for (size_t i = 0; i < irqs.size; i++) {
+            uint32_t reg = irqs[i].reg;
+            uint32_t mask = 0;
+            uint32_t status;
+            bool seen = false;
+
+            for (size_t j = 0; j < irqs.size; j++) {
+                if (irqs[j].reg != reg)
+                    continue;
+                seen = j < i;
+                if (seen)
+                    break;
+                mask |= irqs[j].mask;
+            }
+            if (seen)
+                continue;
+
+            int ret = regmap.read(reg, &status);
+            if (ret < 0) {
+                CIRRUS_LOGE("%s: failed to read IRQ status 0x%x: %d", device.name().c_str(),
+                            reg, ret);
+                continue;
+            }
+
+            status &= mask;
+            if (!status)
+                continue;
+
+            ret = regmap.write(reg, status);
+            if (ret < 0)
+                CIRRUS_LOGE("%s: failed to clear IRQ status 0x%x: %d", device.name().c_str(),
+                            reg, ret);
+
+            for (size_t j = i; j < irqs.size; j++) {
+                if (irqs[j].reg == reg && (status & irqs[j].mask))
+                    dispatch(device, irqs[j].event);
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(mJobLock);
+        if (--mJobs == 0)
+            mJobsIdle.notify_all();
+        return 0;
+    });
+}
+
+void IrqMonitor::dispatch(Device &device, IrqEvent event)
+{
+    size_t index = static_cast<size_t>(event);
+    std::vector<Handler> handlers;
+
+    mCounts[index].fetch_add(1, std::memory_order_relaxed);
+    CIRRUS_LOGD("%s: %s", device.name().c_str(), irqEventName(event));
+
+    /* Copied so a handler may subscribe without deadlocking. */
+    {
+        std::lock_guard<std::mutex> guard(mHandlerLock);
+        handlers = mHandlers[index];
+    }
+
+    for (const Handler &handler : handlers)
+        handler(device, event);
+}
+
+void IrqMonitor::run()
+{
+    std::vector<struct pollfd> fds;
+
+    for (const Source &source : mSources) {
+        short events = source.kind == SourceKind::kSysfs ? POLLPRI | POLLERR : POLLIN;
+        fds.push_back({source.fd, events, 0});
+    }
+    fds.push_back({mWakeFd, POLLIN, 0});
+
+    while (mRunning.load()) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            CIRRUS_LOGE("poll failed: %s", strerror(errno));
+            return;
+        }
+
+        for (size_t i = 0; i < mSources.size(); i++) {
+            if (fds[i].revents && drain(mSources[i]))
+                service(mSources[i].target);
+        }
+    }
+}
+
+} // namespace cirrus::hal
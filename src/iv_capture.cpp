@@ -0,0 +1,348 @@
+#define LOG_TAG "cirrus-iv-capture"
+
+#include "cirrus/hal/iv_capture.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sound/asound.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+void paramInit(struct snd_pcm_hw_params *params)
+{
+    memset(params, 0, sizeof(*params));
+
+    for (auto &mask : params->masks)
+        memset(mask.bits, 0xff, sizeof(mask.bits));
+
+    for (auto &interval : params->intervals) {
+        interval.min = 0;
+        interval.max = ~0u;
+    }
+
+    params->rmask = ~0u;
+    params->info = ~0u;
+}
+
+void paramSetMask(struct snd_pcm_hw_params *params, int param, unsigned bit)
+{
+    struct snd_mask *mask = &params->masks[param - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+
+    memset(mask->bits, 0, sizeof(mask->bits));
+    mask->bits[bit >> 5] |= 1u << (bit & 31);
+}
+
+void paramSetInt(struct snd_pcm_hw_params *params, int param, unsigned val)
+{
+    struct snd_interval *interval =
+            &params->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+
+    interval->min = val;
+    interval->max = val;
+    interval->integer = 1;
+}
+
+unsigned paramGetInt(const struct snd_pcm_hw_params *params, int param)
+{
+    return params->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].max;
+}
+
+} // namespace
+
+IvCapture::~IvCapture()
+{
+    close();
+}
+
+int IvCapture::open(const IvCaptureConfig &config)
+{
+    char path[32];
+    int ret;
+
+    close();
+    mConfig = config;
+    mFrameBytes = config.channels * (config.format == IvCaptureConfig::kS16 ? 2 : 4);
+
+    snprintf(path, sizeof(path), "/dev/snd/pcmC%uD%uc", config.card, config.device);
+    mFd = ::open(path, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    if (mFd < 0) {
+        ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", path, strerror(errno));
+        return ret;
+    }
+
+    ret = setHwParams();
+    if (ret == 0)
+        ret = setSwParams();
+    if (ret == 0)
+        ret = mapBuffers();
+    if (ret < 0) {
+        close();
+        return ret;
+    }
+
+    CIRRUS_LOGI("%s: %u ch at %u Hz, %zu frame buffer%s", path, config.channels, config.rate,
+                mBufferFrames, mSyncPtr ? " (no status mmap)" : "");
+    return 0;
+}
+
+void IvCapture::close()
+{
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (mBuffer)
+        munmap(mBuffer, mBufferBytes);
+    if (mStatus)
+        munmap(const_cast<struct snd_pcm_mmap_status *>(mStatus), page);
+    if (mControl)
+        munmap(const_cast<struct snd_pcm_mmap_control *>(mControl), page);
+    if (mFd >= 0)
+        ::close(mFd);
+
+    mBuffer = nullptr;
+    mStatus = nullptr;
+    mControl = nullptr;
+    mSyncPtr = false;
+    mFd = -1;
+}
+
+int IvCapture::setHwParams()
+{
+    struct snd_pcm_hw_params params;
+    unsigned format = mConfig.format == IvCaptureConfig::kS16 ? SNDRV_PCM_FORMAT_S16_LE
+                                                               : SNDRV_PCM_FORMAT_S32_LE;
+
+    paramInit(&params);
+    paramSetMask(&params, SNDRV_PCM_HW_PARAM_ACCESS, SNDRV_PCM_ACCESS_MMAP_INTERLEAVED);
+    paramSetMask(&params, SNDRV_PCM_HW_PARAM_FORMAT, format);
+    paramSetMask(&params, SNDRV_PCM_HW_PARAM_SUBFORMAT, SNDRV_PCM_SUBFORMAT_STD);
+    paramSetInt(&params, SNDRV_PCM_HW_PARAM_CHANNELS, mConfig.channels);
+    paramSetInt(&params, SNDRV_PCM_HW_PARAM_RATE, mConfig.rate);
+    paramSetInt(&params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, mConfig.periodFrames);
+    paramSetInt(&params, SNDRV_PCM_HW_PARAM_PERIODS, mConfig.periods);
+
+    if (ioctl(mFd, SNDRV_PCM_IOCTL_HW_PARAMS, &params) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Capture hw params rejected: %s", strerror(errno));
+        return ret;
+    }
+
+    mBufferFrames = paramGetInt(&params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE) *
+                    paramGetInt(&params, SNDRV_PCM_HW_PARAM_PERIODS);
+    mBufferBytes = mBufferFrames * mFrameBytes;
+
+    return 0;
+}
+
+int IvCapture::setSwParams()
+{
+    struct snd_pcm_sw_params params = {};
+
+    params.tstamp_mode = SNDRV_PCM_TSTAMP_ENABLE;
+    params.period_step = 1;
+    params.avail_min = mConfig.periodFrames;
+    params.start_threshold = 1;
+    params.stop_threshold = mBufferFrames;
+
+    /* The kernel reports the boundary; ask again never to stop on overrun. */
+    for (int pass = 0; pass < 2; pass++) {
+        if (ioctl(mFd, SNDRV_PCM_IOCTL_SW_PARAMS, &params) < 0) {
+            int ret = -errno;
+            CIRRUS_LOGE("Capture sw params rejected: %s", strerror(errno));
+            return ret;
+        }
+        params.stop_threshold = params.boundary;
+    }
+
+    mBoundary = params.boundary;
+    return 0;
+}
+
+int IvCapture::mapBuffers()
+{
+    long page = sysconf(_SC_PAGESIZE);
+    void *p;
+
+    p = mmap(nullptr, mBufferBytes, PROT_READ, MAP_SHARED, mFd, 0);
+    if (p == MAP_FAILED) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to map capture buffer: %s", strerror(errno));
+        return ret;
+    }
+    mBuffer = static_cast<uint8_t *>(p);
+
+    /* Some architectures refuse these; fall back to SYNC_PTR. */
+    p = mmap(nullptr, page, PROT_READ, MAP_SHARED, mFd, SNDRV_PCM_MMAP_OFFSET_STATUS);
+    if (p != MAP_FAILED) {
+        mStatus = static_cast<struct snd_pcm_mmap_status *>(p);
+        p = mmap(nullptr, page, PROT_READ | PROT_WRITE, MAP_SHARED, mFd,
+                 SNDRV_PCM_MMAP_OFFSET_CONTROL);
+        if (p != MAP_FAILED)
+            mControl = static_cast<struct snd_pcm_mmap_control *>(p);
+    }
+
+    if (!mStatus || !mControl) {
+        if (mStatus)
+            munmap(const_cast<struct snd_pcm_mmap_status *>(mStatus), page);
+        mStatus = nullptr;
+        mSyncPtr = true;
+    }
+
+    return 0;
+}
+
+int IvCapture::start()
+{
+    if (ioctl(mFd, SNDRV_PCM_IOCTL_PREPARE) < 0 || ioctl(mFd, SNDRV_PCM_IOCTL_START) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to start capture: %s", strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+int IvCapture::stop()
+{
+    if (ioctl(mFd, SNDRV_PCM_IOCTL_DROP) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to stop capture: %s", strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+size_t IvCapture::position() const
+{
+    size_t hw;
+
+    if (!mSyncPtr) {
+        hw = mStatus->hw_ptr;
+    } else {
+        struct snd_pcm_sync_ptr sync = {};
+
+        sync.flags = SNDRV_PCM_SYNC_PTR_HWSYNC | SNDRV_PCM_SYNC_PTR_APPL |
+                     SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+        if (ioctl(mFd, SNDRV_PCM_IOCTL_SYNC_PTR, &sync) < 0)
+            return 0;
+        hw = sync.s.status.hw_ptr;
+    }
+
+    /* Samples up to hw must be read after hw itself. */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return hw;
+}
+
+int IvCapture::wait(int timeoutMs) const
+{
+    struct pollfd pfd = {mFd, POLLIN, 0};
+    size_t hw = position();
+    int ret;
+
+    /*
+     * Readers keep their own positions; the kernel's application pointer
+     * only decides when poll() wakes, so move it up to now.
+     */
+    if (!mSyncPtr) {
+        mControl->appl_ptr = hw;
+    } else {
+        struct snd_pcm_sync_ptr sync = {};
+
+        sync.c.control.appl_ptr = hw;
+        sync.c.control.avail_min = mConfig.periodFrames;
+        ioctl(mFd, SNDRV_PCM_IOCTL_SYNC_PTR, &sync);
+    }
+
+    ret = poll(&pfd, 1, timeoutMs);
+    if (ret == 0)
+        return -ETIMEDOUT;
+    if (ret < 0)
+        return errno == EINTR ? 0 : -errno;
+    if (pfd.revents & (POLLERR | POLLNVAL))
+        return -EPIPE;
+
+    return 0;
+}
+
+IvReader::IvReader(const IvCapture &capture) : mCapture(capture), mPos(capture.position())
+{
+}
+
+size_t IvReader::lag(size_t hw) const
+{
+    size_t boundary = mCapture.boundary();
+
+    /* Not open: nothing has been captured. */
+    if (!boundary)
+        return 0;
+
+    return (hw + boundary - mPos) % boundary;
+}
+
+size_t IvReader::limit() const
+{
+    size_t buffer = mCapture.bufferFrames(), period = mCapture.config().periodFrames;
+
+    /* The DMA is already filling the period after the hardware pointer. */
+    return buffer > period ? buffer - period : 0;
+}
+
+void IvReader::resync(size_t hw)
+{
+    size_t boundary = mCapture.boundary();
+
+    mOverruns++;
+    mPos = (hw + boundary - mCapture.config().periodFrames) % boundary;
+}
+
+size_t IvReader::available() const
+{
+    size_t frames = lag(mCapture.position());
+
+    return frames < limit() ? frames : limit();
+}
+
+size_t IvReader::acquire(const uint8_t **data)
+{
+    size_t hw = mCapture.position();
+    size_t frames = lag(hw);
+    size_t toEnd;
+
+    if (frames > limit()) {
+        resync(hw);
+        frames = lag(hw);
+    }
+
+    toEnd = mCapture.bufferFrames() - mPos % mCapture.bufferFrames();
+    *data = mCapture.frame(mPos);
+
+    return frames < toEnd ? frames : toEnd;
+}
+
+bool IvReader::release(size_t frames)
+{
+    size_t hw = mCapture.position();
+
+    /* The writer passed our oldest held frame while we were reading. */
+    if (lag(hw) > limit()) {
+        resync(hw);
+        return false;
+    }
+
+    mPos = (mPos + frames) % mCapture.boundary();
+    return true;
+}
+
+} // namespace cirrus::hal
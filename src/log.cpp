@@ -0,0 +1,48 @@
+#include "cirrus/hal/log.h"
+
+#if !defined(__ANDROID__)
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr char kLevels[] = "DIWE";
+
+std::atomic<int> gMinLevel{0};
+
+int severity(char level)
+{
+    const char *p = strchr(kLevels, level);
+
+    return p ? static_cast<int>(p - kLevels) : 3;
+}
+
+} // namespace
+
+void logSetLevel(char level)
+{
+    gMinLevel.store(severity(level));
+}
+
+void logPrint(char level, const char *tag, const char *fmt, ...)
+{
+    va_list args;
+
+    if (severity(level) < gMinLevel.load(std::memory_order_relaxed))
+        return;
+
+    va_start(args, fmt);
+    fprintf(stderr, "%c %s: ", level, tag);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+} // namespace cirrus::hal
+
+#endif
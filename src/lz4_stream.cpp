@@ -0,0 +1,337 @@
+#define LOG_TAG "cirrus-lz4"
+
+#include "cirrus/hal/lz4_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr uint32_t kFrameMagic = 0x184d2204;
+constexpr size_t kHistory = 64 * 1024;
+constexpr size_t kMinMatch = 4;
+
+/* FLG byte */
+constexpr uint8_t kFlgVersionMask = 0xc0;
+constexpr uint8_t kFlgVersion = 0x40;
+constexpr uint8_t kFlgBlockIndep = 0x20;
+constexpr uint8_t kFlgBlockChecksum = 0x10;
+constexpr uint8_t kFlgContentSize = 0x08;
+constexpr uint8_t kFlgContentChecksum = 0x04;
+constexpr uint8_t kFlgDictId = 0x01;
+
+constexpr uint32_t kBlockUncompressed = 0x80000000;
+
+const char *labelOf(const std::string &name)
+{
+    return name.empty() ? "<memory>" : name.c_str();
+}
+
+/*
+ * Decode one LZ4 block into out[0, cap). Matches may reach back up to
+ * @history bytes before @out. Returns the decoded size or -EINVAL.
+ */
+long decodeLz4Block(const uint8_t *in, size_t inLen, uint8_t *out, size_t cap, size_t history)
+{
+    const uint8_t *ip = in, *iend = in + inLen;
+    uint8_t *op = out, *oend = out + cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t lit = token >> 4;
+        size_t len, offset;
+        uint8_t b;
+
+        if (lit == 15) {
+            do {
+                if (ip == iend)
+                    return -EINVAL;
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > static_cast<size_t>(iend - ip) || lit > static_cast<size_t>(oend - op))
+            return -EINVAL;
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        /* The last sequence is literals only. */
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return -EINVAL;
+        offset = readLe16(ip);
+        ip += 2;
+        if (!offset || offset > static_cast<size_t>(op - out) + history)
+            return -EINVAL;
+
+        len = token & 15;
+        if (len == 15) {
+            do {
+                if (ip == iend)
+                    return -EINVAL;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        len += kMinMatch;
+        if (len > static_cast<size_t>(oend - op))
+            return -EINVAL;
+
+        /*
+         * An overlapping match repeats its first @offset bytes. Copy what
+         * is already there; the distance back to @match, and so the next
+         * non-overlapping copy, doubles each pass.
+         */
+        const uint8_t *match = op - offset;
+        uint8_t *end = op + len;
+        while (op < end) {
+            size_t n = std::min(static_cast<size_t>(op - match), static_cast<size_t>(end - op));
+
+            memcpy(op, match, n);
+            op += n;
+        }
+    }
+
+    return op - out;
+}
+
+} // namespace
+
+bool isLz4Frame(ByteView image)
+{
+    return image.size >= 4 && readLe32(image.data) == kFrameMagic;
+}
+
+int Lz4Stream::open(const std::string &path)
+{
+    int ret = mFile.open(path);
+    if (ret < 0)
+        return ret;
+
+    mName = path;
+    return parse(mFile.view());
+}
+
+int Lz4Stream::parse(ByteView frame)
+{
+    const uint8_t *data = frame.data;
+    size_t pos = 6, blockMax;
+    uint8_t flg, bd;
+
+    mImage = {};
+    mHashValid = false;
+    mEnded = true;
+    mBuf.clear();
+    mStart = mEnd = mPos = 0;
+    mConsumed = 0;
+
+    if (!isLz4Frame(frame) || frame.size < 7) {
+        CIRRUS_LOGE("%s: not an LZ4 frame", labelOf(mName));
+        return -EINVAL;
+    }
+
+    flg = data[4];
+    bd = data[5];
+    if ((flg & kFlgVersionMask) != kFlgVersion) {
+        CIRRUS_LOGE("%s: unsupported LZ4 frame version", labelOf(mName));
+        return -EINVAL;
+    }
+    if (flg & kFlgDictId) {
+        CIRRUS_LOGE("%s: LZ4 dictionaries are not supported", labelOf(mName));
+        return -EOPNOTSUPP;
+    }
+
+    /* Block maximum size codes 4-7 are 64 KiB to 4 MiB. */
+    switch ((bd >> 4) & 7) {
+    case 4:
+    case 5:
+    case 6:
+    case 7:
+        blockMax = size_t(1) << (8 + 2 * ((bd >> 4) & 7));
+        break;
+    default:
+        CIRRUS_LOGE("%s: bad LZ4 block size code 0x%x", labelOf(mName), bd);
+        return -EINVAL;
+    }
+
+    if (flg & kFlgContentSize)
+        pos += 8;
+    if (pos >= frame.size) {
+        CIRRUS_LOGE("%s: truncated LZ4 frame header", labelOf(mName));
+        return -EINVAL;
+    }
+
+    if (data[pos] != ((xxh32(frame.sub(4, pos - 4)) >> 8) & 0xff)) {
+        CIRRUS_LOGE("%s: LZ4 frame header checksum mismatch", labelOf(mName));
+        return -EBADMSG;
+    }
+    pos++;
+
+    mLinked = !(flg & kFlgBlockIndep);
+    mBlockChecksum = flg & kFlgBlockChecksum;
+    mContentChecksum = flg & kFlgContentChecksum;
+    mContentHash.reset();
+    mBuf.resize((mLinked ? kHistory : 0) + blockMax);
+    mIn = pos;
+    mEnded = false;
+    mImage = frame;
+    return 0;
+}
+
+uint64_t Lz4Stream::hash() const
+{
+    if (!mHashValid) {
+        mHash = contentHash(mImage);
+        mHashValid = true;
+    }
+
+    return mHash;
+}
+
+int Lz4Stream::decodeBlock()
+{
+    const uint8_t *data = mImage.data;
+    uint32_t word, len;
+    long decoded;
+    int ret;
+
+    if (mHook) {
+        ret = mHook();
+        if (ret < 0)
+            return ret;
+    }
+
+    mConsumed += mEnd - mStart;
+
+    /* Keep the last 64 KiB for matches from the next linked block. */
+    if (mLinked && mEnd > kHistory) {
+        memmove(mBuf.data(), mBuf.data() + mEnd - kHistory, kHistory);
+        mStart = kHistory;
+    } else {
+        mStart = mLinked ? mEnd : 0;
+    }
+    mEnd = mPos = mStart;
+
+    if (mImage.size - mIn < 4) {
+        CIRRUS_LOGE("%s: LZ4 frame truncated at %zu", labelOf(mName), mIn);
+        return -EINVAL;
+    }
+    word = readLe32(data + mIn);
+    mIn += 4;
+
+    if (word == 0) {
+        mEnded = true;
+        if (!mContentChecksum)
+            return 0;
+
+        if (mImage.size - mIn < 4) {
+            CIRRUS_LOGE("%s: LZ4 content checksum missing", labelOf(mName));
+            return -EINVAL;
+        }
+        if (readLe32(data + mIn) != mContentHash.digest()) {
+            CIRRUS_LOGE("%s: LZ4 content checksum mismatch", labelOf(mName));
+            return -EBADMSG;
+        }
+        mIn += 4;
+        return 0;
+    }
+
+    len = word & ~kBlockUncompressed;
+    if (len > mImage.size - mIn || len > mBuf.size() - mStart ||
+        (mBlockChecksum && mImage.size - mIn - len < 4)) {
+        CIRRUS_LOGE("%s: LZ4 block at %zu overruns the frame", labelOf(mName), mIn);
+        return -EINVAL;
+    }
+
+    if (mBlockChecksum && readLe32(data + mIn + len) != xxh32(mImage.sub(mIn, len))) {
+        CIRRUS_LOGE("%s: LZ4 block checksum mismatch at %zu", labelOf(mName), mIn);
+        return -EBADMSG;
+    }
+
+    if (word & kBlockUncompressed) {
+        memcpy(mBuf.data() + mStart, data + mIn, len);
+        decoded = len;
+    } else {
+        decoded = decodeLz4Block(data + mIn, len, mBuf.data() + mStart, mBuf.size() - mStart,
+                                 mStart);
+        if (decoded < 0) {
+            CIRRUS_LOGE("%s: corrupt LZ4 block at %zu", labelOf(mName), mIn);
+            return -EINVAL;
+        }
+    }
+
+    mIn += len + (mBlockChecksum ? 4 : 0);
+    mEnd = mStart + decoded;
+    if (mContentChecksum)
+        mContentHash.update({mBuf.data() + mStart, static_cast<size_t>(decoded)});
+    return 0;
+}
+
+int Lz4Stream::peek(ByteView *data)
+{
+    int ret;
+
+    while (mPos == mEnd && !mEnded) {
+        ret = decodeBlock();
+        if (ret < 0)
+            return ret;
+    }
+
+    *data = {mBuf.data() + mPos, mEnd - mPos};
+    return 0;
+}
+
+int Lz4Stream::read(void *data, size_t len)
+{
+    uint8_t *out = static_cast<uint8_t *>(data);
+    size_t done = 0;
+    ByteView piece;
+    int ret;
+
+    while (done < len) {
+        ret = peek(&piece);
+        if (ret < 0)
+            return ret;
+        if (piece.empty())
+            break;
+
+        piece.size = std::min(piece.size, len - done);
+        memcpy(out + done, piece.data, piece.size);
+        consume(piece.size);
+        done += piece.size;
+    }
+
+    return static_cast<int>(done);
+}
+
+int Lz4Stream::skip(size_t len)
+{
+    ByteView piece;
+    int ret;
+
+    while (len) {
+        ret = peek(&piece);
+        if (ret < 0)
+            return ret;
+        if (piece.empty())
+            return -EINVAL;
+
+        piece.size = std::min(piece.size, len);
+        consume(piece.size);
+        len -= piece.size;
+    }
+
+    return 0;
+}
+
+} // namespace cirrus::hal
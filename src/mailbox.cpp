@@ -0,0 +1,205 @@
+#define LOG_TAG "cirrus-mailbox"
+
+#include "cirrus/hal/mailbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <unistd.h>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr uint32_t kPollIntervalUs = 100;
+
+} // namespace
+
+Mailbox::Mailbox(Regmap &regmap, const MailboxConfig &config)
+    : mRegmap(regmap), mConfig(config)
+{
+}
+
+int Mailbox::flush()
+{
+    TraceScope trace(TraceOp::kMailboxFlush);
+
+    if (mPending.empty())
+        return 0;
+
+    return mConfig.queueWords ? flushQueue() : flushRegister();
+}
+
+int Mailbox::sync()
+{
+    uint32_t waited = 0;
+    int ret;
+
+    ret = flush();
+    if (ret < 0 || !mConfig.queueWords)
+        return ret;
+
+    for (;;) {
+        ret = readIndex(&mReadIndex);
+        if (ret < 0 || mReadIndex == mWriteIndex)
+            return ret;
+        if (waited >= mConfig.ackTimeoutUs) {
+            CIRRUS_LOGE("Timed out waiting for the firmware to drain the mailbox");
+            return -ETIMEDOUT;
+        }
+        usleep(kPollIntervalUs);
+        waited += kPollIntervalUs;
+    }
+}
+
+int Mailbox::readIndex(uint32_t *index)
+{
+    int ret = mRegmap.read(mConfig.readIndexReg, index);
+    if (ret < 0)
+        return ret;
+
+    if (*index >= mConfig.queueWords) {
+        CIRRUS_LOGE("Mailbox read index %u out of range", *index);
+        mSynced = false;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+/* Wait for the firmware to free at least one slot. */
+int Mailbox::waitForSpace(size_t *space)
+{
+    const uint32_t words = mConfig.queueWords;
+    uint32_t waited = 0;
+
+    for (;;) {
+        int ret = readIndex(&mReadIndex);
+        if (ret < 0)
+            return ret;
+
+        *space = (mReadIndex + words - mWriteIndex - 1) % words;
+        if (*space)
+            return 0;
+
+        if (waited >= mConfig.ackTimeoutUs) {
+            CIRRUS_LOGE("Timed out waiting for mailbox space");
+            return -ETIMEDOUT;
+        }
+        usleep(kPollIntervalUs);
+        waited += kPollIntervalUs;
+    }
+}
+
+int Mailbox::flushQueue()
+{
+    const uint32_t words = mConfig.queueWords;
+    size_t sent = 0;
+    int ret = 0;
+
+    if (!mSynced) {
+        ret = mRegmap.read(mConfig.writeIndexReg, &mWriteIndex);
+        if (ret == 0 && mWriteIndex >= words)
+            ret = -EIO;
+        if (ret == 0)
+            ret = readIndex(&mReadIndex);
+        if (ret < 0) {
+            CIRRUS_LOGE("Failed to read mailbox state: %d", ret);
+            return ret;
+        }
+        mSynced = true;
+    }
+
+    while (sent < mPending.size()) {
+        size_t remaining = mPending.size() - sent;
+        size_t space = (mReadIndex + words - mWriteIndex - 1) % words;
+
+        /* The cached read index is stale in the firmware's favour. */
+        if (space < remaining) {
+            ret = space ? readIndex(&mReadIndex) : waitForSpace(&space);
+            if (ret < 0)
+                break;
+            space = (mReadIndex + words - mWriteIndex - 1) % words;
+        }
+
+        BulkWriter writer(mRegmap);
+        size_t count = std::min(space, remaining);
+        uint32_t index = mWriteIndex;
+
+        for (size_t i = 0; i < count && ret == 0; i++) {
+            ret = writer.write(mRegmap.advance(mConfig.queueReg, index * 4), mPending[sent + i]);
+            index = (index + 1) % words;
+        }
+
+        /* Publish only after the commands themselves have been queued. */
+        if (ret == 0)
+            ret = writer.write(mConfig.writeIndexReg, index);
+        if (ret == 0 && mConfig.doorbellValue)
+            ret = writer.write(mConfig.mailboxReg, mConfig.doorbellValue);
+        if (ret == 0)
+            ret = writer.flush();
+        if (ret < 0) {
+            mSynced = false;
+            break;
+        }
+
+        mWriteIndex = index;
+        sent += count;
+    }
+
+    if (ret < 0)
+        CIRRUS_LOGE("Mailbox flush failed after %zu of %zu commands: %d", sent,
+                    mPending.size(), ret);
+
+    /* Anything not sent stays queued for the next attempt. */
+    mPending.erase(mPending.begin(), mPending.begin() + sent);
+    return ret;
+}
+
+int Mailbox::flushRegister()
+{
+    size_t sent = 0;
+    int ret = 0;
+
+    for (; sent < mPending.size(); sent++) {
+        uint32_t waited = 0;
+        uint32_t val;
+
+        ret = mRegmap.write(mConfig.mailboxReg, mPending[sent]);
+        if (ret < 0) {
+            CIRRUS_LOGE("Mailbox command 0x%x failed: %d", mPending[sent], ret);
+            break;
+        }
+
+        for (;;) {
+            ret = mRegmap.read(mConfig.mailboxReg, &val);
+            if (ret < 0 || val == 0)
+                break;
+            if (waited >= mConfig.ackTimeoutUs) {
+                ret = -ETIMEDOUT;
+                break;
+            }
+            usleep(kPollIntervalUs);
+            waited += kPollIntervalUs;
+        }
+
+        /*
+         * The command reached the mailbox, so the firmware may still act
+         * on it: drop it rather than send it a second time.
+         */
+        if (ret < 0) {
+            CIRRUS_LOGE("Mailbox command 0x%x not acknowledged, dropped: %d", mPending[sent],
+                        ret);
+            sent++;
+            break;
+        }
+    }
+
+    mPending.erase(mPending.begin(), mPending.begin() + sent);
+    return ret;
+}
+
+} // namespace cirrus::hal
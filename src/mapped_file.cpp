@@ -0,0 +1,98 @@
+#define LOG_TAG "cirrus-mapped-file"
+
+#include "cirrus/hal/mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : mData(other.mData), mSize(other.mSize), mPath(std::move(other.mPath))
+{
+    other.mData = nullptr;
+    other.mSize = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        close();
+        mData = other.mData;
+        mSize = other.mSize;
+        mPath = std::move(other.mPath);
+        other.mData = nullptr;
+        other.mSize = 0;
+    }
+    return *this;
+}
+
+int MappedFile::open(const std::string &path)
+{
+    struct stat st;
+    void *addr;
+    int fd, ret;
+
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", path.c_str(), strerror(errno));
+        return ret;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        ret = -errno;
+        CIRRUS_LOGE("Failed to stat %s: %s", path.c_str(), strerror(errno));
+        ::close(fd);
+        return ret;
+    }
+
+    if (st.st_size <= 0) {
+        CIRRUS_LOGE("%s is empty", path.c_str());
+        ::close(fd);
+        return -EINVAL;
+    }
+
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        ret = -errno;
+        CIRRUS_LOGE("Failed to map %s: %s", path.c_str(), strerror(errno));
+        return ret;
+    }
+
+    /* Blocks are consumed front to back exactly once during a download. */
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    madvise(addr, st.st_size, MADV_WILLNEED);
+
+    mData = static_cast<const uint8_t *>(addr);
+    mSize = st.st_size;
+    mPath = path;
+
+    return 0;
+}
+
+void MappedFile::close()
+{
+    if (mData)
+        munmap(const_cast<uint8_t *>(mData), mSize);
+
+    mData = nullptr;
+    mSize = 0;
+    mPath.clear();
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,219 @@
+#define LOG_TAG "cirrus-mixer"
+
+#include "cirrus/hal/mixer.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <sound/asound.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+Mixer::~Mixer()
+{
+    close();
+}
+
+int Mixer::open(unsigned card)
+{
+    char path[32];
+
+    close();
+
+    snprintf(path, sizeof(path), "/dev/snd/controlC%u", card);
+    mFd = ::open(path, O_RDWR | O_CLOEXEC);
+    if (mFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", path, strerror(errno));
+        return ret;
+    }
+
+    return refresh();
+}
+
+void Mixer::close()
+{
+    if (mFd >= 0)
+        ::close(mFd);
+    mFd = -1;
+    mControls.clear();
+}
+
+int Mixer::refresh()
+{
+    struct snd_ctl_elem_list list = {};
+    std::vector<struct snd_ctl_elem_id> ids;
+
+    if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0)
+        return -errno;
+
+    ids.resize(list.count);
+    list.space = list.count;
+    list.pids = ids.data();
+    if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0)
+        return -errno;
+
+    mControls.clear();
+    mControls.reserve(list.used);
+
+    for (unsigned i = 0; i < list.used; i++) {
+        struct snd_ctl_elem_info info = {};
+
+        info.id.numid = ids[i].numid;
+        if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_INFO, &info) < 0) {
+            CIRRUS_LOGW("Failed to query control %u: %s", ids[i].numid, strerror(errno));
+            continue;
+        }
+
+        mControls.insert(reinterpret_cast<const char *>(info.id.name), info.id.index,
+                         {info.id.numid, info.type, info.count, info.access});
+    }
+
+    CIRRUS_LOGD("Indexed %zu controls", mControls.size());
+    return 0;
+}
+
+int Mixer::setValues(const ControlInfo &ctl, const long *values, size_t count)
+{
+    TraceScope trace(TraceOp::kControlWrite);
+    struct snd_ctl_elem_value ev = {};
+
+    if (count > ctl.count || count > 128)
+        return -EINVAL;
+
+    ev.id.numid = ctl.numid;
+    /* ELEM_WRITE sets every element; keep the ones not given. */
+    if (count < ctl.count && ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_READ, &ev) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Read of control %u failed: %s", ctl.numid, strerror(errno));
+        return ret;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (ctl.type == SNDRV_CTL_ELEM_TYPE_ENUMERATED)
+            ev.value.enumerated.item[i] = values[i];
+        else
+            ev.value.integer.value[i] = values[i];
+    }
+
+    if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_WRITE, &ev) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Write of control %u failed: %s", ctl.numid, strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+int Mixer::getValues(const ControlInfo &ctl, long *values, size_t count)
+{
+    struct snd_ctl_elem_value ev = {};
+
+    if (count > ctl.count || count > 128)
+        return -EINVAL;
+
+    ev.id.numid = ctl.numid;
+    if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_READ, &ev) < 0)
+        return -errno;
+
+    for (size_t i = 0; i < count; i++) {
+        if (ctl.type == SNDRV_CTL_ELEM_TYPE_ENUMERATED)
+            values[i] = ev.value.enumerated.item[i];
+        else
+            values[i] = ev.value.integer.value[i];
+    }
+
+    return 0;
+}
+
+int Mixer::tlv(unsigned long request, const ControlInfo &ctl, void *data, size_t len)
+{
+    size_t size = sizeof(struct snd_ctl_tlv) + len;
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+    auto *hdr = reinterpret_cast<struct snd_ctl_tlv *>(buf.get());
+
+    hdr->numid = ctl.numid;
+    hdr->length = len;
+    if (request == SNDRV_CTL_IOCTL_TLV_WRITE)
+        memcpy(hdr->tlv, data, len);
+
+    if (ioctl(mFd, request, hdr) < 0)
+        return -errno;
+
+    if (request == SNDRV_CTL_IOCTL_TLV_READ)
+        memcpy(data, hdr->tlv, len);
+
+    return 0;
+}
+
+int Mixer::setBytes(const ControlInfo &ctl, const void *data, size_t len)
+{
+    TraceScope trace(TraceOp::kControlWrite);
+    struct snd_ctl_elem_value ev = {};
+    int ret;
+
+    if (ctl.type != SNDRV_CTL_ELEM_TYPE_BYTES || len > ctl.count)
+        return -EINVAL;
+
+    if (ctl.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE) {
+        ret = tlv(SNDRV_CTL_IOCTL_TLV_WRITE, ctl, const_cast<void *>(data), len);
+    } else {
+        if (len > sizeof(ev.value.bytes.data))
+            return -EINVAL;
+
+        ev.id.numid = ctl.numid;
+        ret = len < ctl.count && ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_READ, &ev) < 0 ? -errno : 0;
+        if (ret == 0) {
+            memcpy(ev.value.bytes.data, data, len);
+            ret = ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_WRITE, &ev) < 0 ? -errno : 0;
+        }
+    }
+
+    if (ret < 0)
+        CIRRUS_LOGE("Write of byte control %u failed: %d", ctl.numid, ret);
+
+    return ret;
+}
+
+int Mixer::getBytes(const ControlInfo &ctl, void *data, size_t len)
+{
+    struct snd_ctl_elem_value ev = {};
+
+    if (ctl.type != SNDRV_CTL_ELEM_TYPE_BYTES || len > ctl.count)
+        return -EINVAL;
+
+    if (ctl.access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE)
+        return tlv(SNDRV_CTL_IOCTL_TLV_READ, ctl, data, len);
+
+    if (len > sizeof(ev.value.bytes.data))
+        return -EINVAL;
+
+    ev.id.numid = ctl.numid;
+    if (ioctl(mFd, SNDRV_CTL_IOCTL_ELEM_READ, &ev) < 0)
+        return -errno;
+
+    memcpy(data, ev.value.bytes.data, len);
+    return 0;
+}
+
+int Mixer::set(std::string_view name, long value)
+{
+    const ControlInfo *ctl = find(name);
+
+    if (!ctl) {
+        CIRRUS_LOGE("No control named '%.*s'", static_cast<int>(name.size()), name.data());
+        return -ENOENT;
+    }
+
+    return setValues(*ctl, &value, 1);
+}
+
+} // namespace cirrus::hal
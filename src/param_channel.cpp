@@ -0,0 +1,205 @@
+#define LOG_TAG "cirrus-param-channel"
+
+#include "cirrus/hal/param_channel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sound/asound.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+ParamChannel::ParamChannel() = default;
+
+ParamChannel::~ParamChannel()
+{
+    stop();
+}
+
+int ParamChannel::start(Mixer &mixer)
+{
+    if (mRunning.load())
+        return -EBUSY;
+
+    mEventFd = eventfd(0, EFD_CLOEXEC);
+    if (mEventFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to create eventfd: %s", strerror(errno));
+        return ret;
+    }
+
+    mMixer = &mixer;
+    mRunning.store(true);
+    mThread = std::thread(&ParamChannel::run, this);
+
+    return 0;
+}
+
+void ParamChannel::stop()
+{
+    if (!mRunning.exchange(false))
+        return;
+
+    mSleeping.store(true);
+    wake();
+    mThread.join();
+
+    ::close(mEventFd);
+    mEventFd = -1;
+    mDirty.clear();
+    mShadows.clear();
+    mMixer = nullptr;
+}
+
+void ParamChannel::wake()
+{
+    uint64_t one = 1;
+
+    /* Pairs with the fence in run(): either it sees our item or we see it asleep. */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleeping.exchange(false)) {
+        if (write(mEventFd, &one, sizeof(one)) < 0)
+            CIRRUS_LOGW("Failed to wake control thread: %s", strerror(errno));
+    }
+}
+
+bool ParamChannel::post(const ParamUpdate &update)
+{
+    if (!mRing.push(update)) {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    wake();
+    return true;
+}
+
+bool ParamChannel::setValue(const ControlInfo &ctl, long value, uint32_t element)
+{
+    return post({ctl, ParamUpdate::kValue, element, value});
+}
+
+bool ParamChannel::setWord(const ControlInfo &ctl, uint32_t word, uint32_t element)
+{
+    return post({ctl, ParamUpdate::kWord, element, static_cast<long>(word)});
+}
+
+void ParamChannel::run()
+{
+    ParamUpdate update;
+    uint64_t count;
+
+    while (mRunning.load()) {
+        bool any = false;
+
+        while (mRing.pop(&update)) {
+            apply(update);
+            any = true;
+        }
+
+        if (any) {
+            flush();
+            continue;
+        }
+
+        mSleeping.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!mRing.empty() || !mRunning.load()) {
+            mSleeping.store(false);
+            continue;
+        }
+
+        if (read(mEventFd, &count, sizeof(count)) < 0 && errno != EINTR)
+            CIRRUS_LOGE("eventfd read failed: %s", strerror(errno));
+    }
+
+    /* Anything posted before stop() still goes out. */
+    while (mRing.pop(&update))
+        apply(update);
+    flush();
+}
+
+void ParamChannel::apply(const ParamUpdate &update)
+{
+    const ControlInfo &ctl = update.ctl;
+    Shadow &shadow = mShadows[ctl.numid];
+    bool bytes = ctl.type == SNDRV_CTL_ELEM_TYPE_BYTES;
+
+    /* A reload can hand the numid to a different control. */
+    if (!shadow.dirty || shadow.ctl.type != ctl.type || shadow.ctl.count != ctl.count) {
+        shadow.ctl = ctl;
+        shadow.values.resize(bytes ? 0 : ctl.count);
+        shadow.bytes.resize(bytes ? ctl.count : 0);
+        shadow.posted.assign(bytes ? ctl.count / 4 : ctl.count, false);
+    }
+
+    if ((update.kind == ParamUpdate::kWord) != bytes || update.element >= shadow.posted.size()) {
+        CIRRUS_LOGE("Element %u out of range for control %u", update.element, ctl.numid);
+        return;
+    }
+
+    if (bytes)
+        writeBe32(&shadow.bytes[update.element * 4], static_cast<uint32_t>(update.value));
+    else
+        shadow.values[update.element] = update.value;
+    shadow.posted[update.element] = true;
+
+    if (!shadow.dirty) {
+        shadow.dirty = true;
+        mDirty.push_back(&shadow);
+    }
+}
+
+int ParamChannel::writeBack(Shadow &shadow)
+{
+    const ControlInfo &ctl = shadow.ctl;
+    int ret;
+
+    if (ctl.type == SNDRV_CTL_ELEM_TYPE_BYTES) {
+        mCurrentBytes.resize(ctl.count);
+        ret = mMixer->getBytes(ctl, mCurrentBytes.data(), ctl.count);
+        if (ret == 0) {
+            for (size_t i = 0; i < shadow.posted.size(); i++)
+                if (shadow.posted[i])
+                    memcpy(&mCurrentBytes[i * 4], &shadow.bytes[i * 4], 4);
+            ret = mMixer->setBytes(ctl, mCurrentBytes.data(), ctl.count);
+        }
+    } else {
+        mCurrentValues.resize(ctl.count);
+        ret = mMixer->getValues(ctl, mCurrentValues.data(), ctl.count);
+        if (ret == 0) {
+            for (size_t i = 0; i < shadow.posted.size(); i++)
+                if (shadow.posted[i])
+                    mCurrentValues[i] = shadow.values[i];
+            ret = mMixer->setValues(ctl, mCurrentValues.data(), ctl.count);
+        }
+    }
+
+    if (ret < 0)
+        CIRRUS_LOGE("Dropped updates to control %u: %d", ctl.numid, ret);
+
+    std::fill(shadow.posted.begin(), shadow.posted.end(), false);
+    shadow.dirty = false;
+    return ret;
+}
+
+int ParamChannel::flush()
+{
+    int ret, err = 0;
+
+    for (Shadow *shadow : mDirty) {
+        ret = writeBack(*shadow);
+        if (ret < 0 && !err)
+            err = ret;
+    }
+    mDirty.clear();
+
+    return err;
+}
+
+} // namespace cirrus::hal
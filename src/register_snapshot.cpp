@@ -0,0 +1,99 @@
+#include "cirrus/hal/register_snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+
+namespace cirrus::hal {
+
+void RegisterSnapshot::clear()
+{
+    mRuns.clear();
+    mData.clear();
+}
+
+void RegisterSnapshot::append(uint32_t reg, const uint8_t *data, size_t len)
+{
+    mRuns.push_back({reg, static_cast<uint32_t>(mData.size()), static_cast<uint32_t>(len)});
+    mData.insert(mData.end(), data, data + len);
+}
+
+int RegisterSnapshot::captureRegisters(Regmap &regmap, Table<RegDefault> defaults)
+{
+    const size_t maxRegs = std::max<size_t>(regmap.maxRawWrite() / 4, 1);
+    std::vector<uint8_t> buf;
+    size_t first, end;
+    int ret;
+
+    for (first = 0; first < defaults.size; first = end) {
+        /* One read per stretch of consecutive registers. */
+        end = first + 1;
+        while (end < defaults.size && end - first < maxRegs &&
+               defaults[end].reg == regmap.advance(defaults[end - 1].reg, 4))
+            end++;
+
+        buf.resize((end - first) * 4);
+        ret = regmap.rawRead(defaults[first].reg, buf.data(), buf.size());
+        if (ret < 0)
+            return ret;
+
+        /* Changed registers start..last of this stretch, plus fill. */
+        size_t start = SIZE_MAX, last = 0;
+        for (size_t i = 0; i < end - first; i++) {
+            if (readBe32(&buf[i * 4]) == defaults[first + i].val)
+                continue;
+
+            if (start != SIZE_MAX && i - last - 1 > kMaxFill) {
+                append(defaults[first + start].reg, &buf[start * 4], (last - start + 1) * 4);
+                start = SIZE_MAX;
+            }
+            if (start == SIZE_MAX)
+                start = i;
+            last = i;
+        }
+        if (start != SIZE_MAX)
+            append(defaults[first + start].reg, &buf[start * 4], (last - start + 1) * 4);
+    }
+
+    return 0;
+}
+
+int RegisterSnapshot::captureRange(Regmap &regmap, uint32_t reg, uint32_t len)
+{
+    size_t offset = mData.size(), pos, chunk;
+    int ret;
+
+    if (!len || len % regmap.valBytes())
+        return -EINVAL;
+
+    mData.resize(offset + len);
+    for (pos = 0; pos < len; pos += chunk) {
+        chunk = std::min<size_t>(len - pos, regmap.maxRawWrite());
+        ret = regmap.rawRead(regmap.advance(reg, pos), &mData[offset + pos], chunk);
+        if (ret < 0) {
+            mData.resize(offset);
+            return ret;
+        }
+    }
+
+    mRuns.push_back({reg, static_cast<uint32_t>(offset), len});
+    return 0;
+}
+
+int RegisterSnapshot::restore(Regmap &regmap) const
+{
+    BulkWriter writer(regmap);
+    int ret;
+
+    for (const Run &run : mRuns) {
+        ret = writer.write(run.reg, ByteView{&mData[run.offset], run.len});
+        if (ret < 0)
+            return ret;
+    }
+
+    return writer.flush();
+}
+
+} // namespace cirrus::hal
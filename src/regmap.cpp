@@ -0,0 +1,252 @@
+#define LOG_TAG "cirrus-regmap"
+
+#include "cirrus/hal/regmap.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <linux/spi/spidev.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kAddrBytes = 4;
+constexpr size_t kSpiPadBytes = 2;
+constexpr uint32_t kSpiReadFlag = 0x80000000;
+
+} // namespace
+
+int Regmap::updateBits(uint32_t reg, uint32_t mask, uint32_t val)
+{
+    uint32_t old;
+    int ret;
+
+    ret = read(reg, &old);
+    if (ret < 0)
+        return ret;
+
+    val = (old & ~mask) | (val & mask);
+    if (val == old)
+        return 0;
+
+    return write(reg, val);
+}
+
+I2cRegmap::~I2cRegmap()
+{
+    close();
+}
+
+int I2cRegmap::open(const std::string &dev, uint16_t addr, size_t maxWrite)
+{
+    close();
+
+    mFd = ::open(dev.c_str(), O_RDWR | O_CLOEXEC);
+    if (mFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", dev.c_str(), strerror(errno));
+        return ret;
+    }
+
+    mAddr = addr;
+    mMaxWrite = maxWrite - maxWrite % valBytes();
+    mTxBuf.resize(kAddrBytes + mMaxWrite);
+
+    return 0;
+}
+
+void I2cRegmap::close()
+{
+    if (mFd >= 0)
+        ::close(mFd);
+    mFd = -1;
+}
+
+int I2cRegmap::read(uint32_t reg, uint32_t *val)
+{
+    uint8_t buf[4];
+    int ret;
+
+    ret = rawRead(reg, buf, sizeof(buf));
+    if (ret < 0)
+        return ret;
+
+    *val = readBe32(buf);
+    return 0;
+}
+
+int I2cRegmap::write(uint32_t reg, uint32_t val)
+{
+    uint8_t buf[4];
+
+    writeBe32(buf, val);
+    return rawWrite(reg, buf, sizeof(buf));
+}
+
+int I2cRegmap::rawRead(uint32_t reg, void *data, size_t len)
+{
+    uint8_t addr[kAddrBytes];
+    struct i2c_msg msgs[2];
+    struct i2c_rdwr_ioctl_data xfer = {msgs, 2};
+
+    if (len % valBytes() || len > UINT16_MAX)
+        return -EINVAL;
+
+    writeBe32(addr, reg);
+    msgs[0] = {mAddr, 0, sizeof(addr), addr};
+    msgs[1] = {mAddr, I2C_M_RD, static_cast<uint16_t>(len), static_cast<uint8_t *>(data)};
+
+    if (ioctl(mFd, I2C_RDWR, &xfer) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("0x%02x: read of 0x%x (%zu bytes) failed: %s", mAddr, reg, len,
+                    strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+int I2cRegmap::rawWrite(uint32_t reg, const void *data, size_t len)
+{
+    struct i2c_msg msg;
+    struct i2c_rdwr_ioctl_data xfer = {&msg, 1};
+
+    if (len % valBytes() || len > mMaxWrite)
+        return -EINVAL;
+
+    writeBe32(mTxBuf.data(), reg);
+    memcpy(mTxBuf.data() + kAddrBytes, data, len);
+    msg = {mAddr, 0, static_cast<uint16_t>(kAddrBytes + len), mTxBuf.data()};
+
+    if (ioctl(mFd, I2C_RDWR, &xfer) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("0x%02x: write of 0x%x (%zu bytes) failed: %s", mAddr, reg, len,
+                    strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+SpiRegmap::~SpiRegmap()
+{
+    close();
+}
+
+int SpiRegmap::open(const std::string &dev, uint32_t speedHz, size_t maxWrite)
+{
+    uint8_t mode = SPI_MODE_0;
+
+    close();
+
+    mFd = ::open(dev.c_str(), O_RDWR | O_CLOEXEC);
+    if (mFd < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("Failed to open %s: %s", dev.c_str(), strerror(errno));
+        return ret;
+    }
+
+    if (ioctl(mFd, SPI_IOC_WR_MODE, &mode) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("%s: failed to set SPI mode: %s", dev.c_str(), strerror(errno));
+        close();
+        return ret;
+    }
+
+    mSpeedHz = speedHz;
+    mMaxWrite = maxWrite - maxWrite % valBytes();
+    mTxBuf.resize(kAddrBytes + kSpiPadBytes + mMaxWrite);
+    mRxBuf.resize(mTxBuf.size());
+
+    return 0;
+}
+
+void SpiRegmap::close()
+{
+    if (mFd >= 0)
+        ::close(mFd);
+    mFd = -1;
+}
+
+int SpiRegmap::transfer(size_t len)
+{
+    struct spi_ioc_transfer xfer = {};
+
+    xfer.tx_buf = reinterpret_cast<uintptr_t>(mTxBuf.data());
+    xfer.rx_buf = reinterpret_cast<uintptr_t>(mRxBuf.data());
+    xfer.len = len;
+    xfer.speed_hz = mSpeedHz;
+    xfer.bits_per_word = 8;
+
+    if (ioctl(mFd, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+        int ret = -errno;
+        CIRRUS_LOGE("SPI transfer of %zu bytes failed: %s", len, strerror(errno));
+        return ret;
+    }
+
+    return 0;
+}
+
+int SpiRegmap::read(uint32_t reg, uint32_t *val)
+{
+    uint8_t buf[4];
+    int ret;
+
+    ret = rawRead(reg, buf, sizeof(buf));
+    if (ret < 0)
+        return ret;
+
+    *val = readBe32(buf);
+    return 0;
+}
+
+int SpiRegmap::write(uint32_t reg, uint32_t val)
+{
+    uint8_t buf[4];
+
+    writeBe32(buf, val);
+    return rawWrite(reg, buf, sizeof(buf));
+}
+
+int SpiRegmap::rawRead(uint32_t reg, void *data, size_t len)
+{
+    constexpr size_t kHdr = kAddrBytes + kSpiPadBytes;
+    int ret;
+
+    if (len % valBytes() || len > mMaxWrite)
+        return -EINVAL;
+
+    memset(mTxBuf.data(), 0, kHdr + len);
+    writeBe32(mTxBuf.data(), reg | kSpiReadFlag);
+
+    ret = transfer(kHdr + len);
+    if (ret < 0)
+        return ret;
+
+    memcpy(data, mRxBuf.data() + kHdr, len);
+    return 0;
+}
+
+int SpiRegmap::rawWrite(uint32_t reg, const void *data, size_t len)
+{
+    constexpr size_t kHdr = kAddrBytes + kSpiPadBytes;
+
+    if (len % valBytes() || len > mMaxWrite)
+        return -EINVAL;
+
+    writeBe32(mTxBuf.data(), reg & ~kSpiReadFlag);
+    memset(mTxBuf.data() + kAddrBytes, 0, kSpiPadBytes);
+    memcpy(mTxBuf.data() + kHdr, data, len);
+
+    return transfer(kHdr + len);
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,222 @@
+#include "cirrus/hal/sim_regmap.h"
+
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include "cirrus/hal/byte_order.h"
+
+namespace cirrus::hal {
+
+SimRegmap::SimRegmap(const SimBusConfig &config, unsigned regStride)
+    : mRegStride(regStride), mConfig(config)
+{
+}
+
+void SimRegmap::setConfig(const SimBusConfig &config)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mConfig = config;
+}
+
+uint32_t *SimRegmap::word(uint32_t reg)
+{
+    std::unique_ptr<uint32_t[]> &page = mPages[reg >> kPageShift];
+
+    /* A page covers a fixed address range, so holds fewer words at a wider stride. */
+    if (!page)
+        page = std::make_unique<uint32_t[]>((1u << kPageShift) / mRegStride);
+
+    return &page[(reg & ((1u << kPageShift) - 1)) / mRegStride];
+}
+
+int SimRegmap::transact(uint32_t reg, size_t len, bool write, uint64_t *ns)
+{
+    if (reg % mRegStride || len % 4 || !len || len > mConfig.maxBurst)
+        return -EINVAL;
+
+    mTransactions++;
+
+    *ns = mConfig.transactionNs + mConfig.byteNs * len;
+    mBusNs += *ns;
+    if (!mConfig.realTime)
+        *ns = 0;
+
+    if (mFailAt && mTransactions == mFailAt) {
+        mFailAt = 0;
+        return mFailAtErr;
+    }
+
+    for (const FailRange &range : mFailRanges)
+        if (reg <= range.last && advance(reg, len) > range.first)
+            return range.err;
+
+    if (write)
+        mBytesWritten += len;
+    else
+        mBytesRead += len;
+
+    return 0;
+}
+
+/*
+ * Called with mBusLock held and mLock released, so a transfer keeps the
+ * bus busy without blocking peek(), poke() or the statistics.
+ */
+void SimRegmap::occupyBus(uint64_t ns)
+{
+    if (ns)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+int SimRegmap::read(uint32_t reg, uint32_t *val)
+{
+    std::lock_guard<std::mutex> bus(mBusLock);
+    uint64_t ns = 0;
+    int ret;
+
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        ret = transact(reg, 4, false, &ns);
+        if (ret == 0)
+            *val = *word(reg);
+    }
+
+    occupyBus(ns);
+    return ret;
+}
+
+int SimRegmap::write(uint32_t reg, uint32_t val)
+{
+    std::lock_guard<std::mutex> bus(mBusLock);
+    uint64_t ns = 0;
+    int ret;
+
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        ret = transact(reg, 4, true, &ns);
+        if (ret == 0)
+            *word(reg) = val;
+    }
+
+    occupyBus(ns);
+    return ret;
+}
+
+int SimRegmap::rawRead(uint32_t reg, void *data, size_t len)
+{
+    std::lock_guard<std::mutex> bus(mBusLock);
+    auto *p = static_cast<uint8_t *>(data);
+    uint64_t ns = 0;
+    int ret;
+
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        ret = transact(reg, len, false, &ns);
+        if (ret == 0)
+            for (size_t i = 0; i < len; i += 4)
+                writeBe32(p + i, *word(advance(reg, i)));
+    }
+
+    occupyBus(ns);
+    return ret;
+}
+
+int SimRegmap::rawWrite(uint32_t reg, const void *data, size_t len)
+{
+    std::lock_guard<std::mutex> bus(mBusLock);
+    const auto *p = static_cast<const uint8_t *>(data);
+    uint64_t ns = 0;
+    int ret;
+
+    {
+        std::lock_guard<std::mutex> guard(mLock);
+        ret = transact(reg, len, true, &ns);
+        if (ret == 0)
+            for (size_t i = 0; i < len; i += 4)
+                *word(advance(reg, i)) = readBe32(p + i);
+    }
+
+    occupyBus(ns);
+    return ret;
+}
+
+uint32_t SimRegmap::peek(uint32_t reg) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    auto it = mPages.find(reg >> kPageShift);
+
+    if (it == mPages.end())
+        return 0;
+    return it->second[(reg & ((1u << kPageShift) - 1)) / mRegStride];
+}
+
+void SimRegmap::poke(uint32_t reg, uint32_t val)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    *word(reg) = val;
+}
+
+void SimRegmap::clear()
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mPages.clear();
+}
+
+void SimRegmap::failTransaction(size_t nth, int err)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mFailAt = nth ? mTransactions + nth : 0;
+    mFailAtErr = err;
+}
+
+void SimRegmap::failRange(uint32_t first, uint32_t last, int err)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mFailRanges.push_back({first, last, err});
+}
+
+void SimRegmap::clearFailures()
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mFailAt = 0;
+    mFailRanges.clear();
+}
+
+size_t SimRegmap::transactions() const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    return mTransactions;
+}
+
+size_t SimRegmap::bytesWritten() const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    return mBytesWritten;
+}
+
+size_t SimRegmap::bytesRead() const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    return mBytesRead;
+}
+
+uint64_t SimRegmap::busNs() const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    return mBusNs;
+}
+
+void SimRegmap::resetStats()
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    /* failTransaction() counts from when it was called, not from here. */
+    if (mFailAt)
+        mFailAt -= mTransactions;
+    mTransactions = 0;
+    mBytesWritten = 0;
+    mBytesRead = 0;
+    mBusNs = 0;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,274 @@
+#define LOG_TAG "cirrus-symbols"
+
+#include "cirrus/hal/symbol_table.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/log.h"
+#include "cirrus/hal/regmap.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+/* Version 0/1 descriptors use fixed 256-byte strings, see struct wmfw_adsp_alg_data. */
+constexpr size_t kV1NameBytes = 256;
+constexpr size_t kV1AlgSize = 4 + 2 * kV1NameBytes + 4;
+/* struct wmfw_adsp_coeff_data hdr: offset, type (le16), size (le32) */
+constexpr size_t kCoeffHeaderSize = 8;
+constexpr size_t kWordBytes = 4;
+constexpr uint32_t kMaxCoefficients = 4096;
+
+/* Bounds-checked little-endian cursor over a descriptor. */
+class Cursor {
+public:
+    Cursor(ByteView data, size_t pos) : mData(data), mPos(pos) {}
+
+    bool ok() const { return mOk; }
+    size_t pos() const { return mPos; }
+
+    const uint8_t *take(size_t len)
+    {
+        if (!mOk || len > mData.size - mPos) {
+            mOk = false;
+            return nullptr;
+        }
+        mPos += len;
+        return mData.data + mPos - len;
+    }
+
+    uint32_t int16()
+    {
+        const uint8_t *p = take(2);
+        return p ? readLe16(p) : 0;
+    }
+
+    uint32_t int32()
+    {
+        const uint8_t *p = take(4);
+        return p ? readLe32(p) : 0;
+    }
+
+    /* Version 2+ string: @bytes of length, then text, padded to a word. */
+    std::string_view string(size_t bytes)
+    {
+        const uint8_t *p;
+        size_t len;
+
+        if (!mOk || bytes > mData.size - mPos) {
+            mOk = false;
+            return {};
+        }
+        p = mData.data + mPos;
+        len = bytes == 1 ? p[0] : readLe16(p);
+        if (!take((bytes + len + 3) & ~size_t(3)))
+            return {};
+        return {reinterpret_cast<const char *>(p + bytes), len};
+    }
+
+    /* Version 0/1 string: NUL-padded fixed-size field. */
+    std::string_view fixedString()
+    {
+        const char *p = reinterpret_cast<const char *>(take(kV1NameBytes));
+
+        return p ? std::string_view(p, strnlen(p, kV1NameBytes)) : std::string_view();
+    }
+
+private:
+    ByteView mData;
+    size_t mPos;
+    bool mOk = true;
+};
+
+} // namespace
+
+void SymbolTable::clear()
+{
+    mSymbols.clear();
+    mNames.clear();
+    mRegmap = nullptr;
+}
+
+int SymbolTable::parseRegion(ByteView data, uint8_t version)
+{
+    bool v1 = version < 2;
+    Cursor alg(data, 0);
+    uint32_t algId, nCoeffs;
+    size_t pos;
+
+    algId = alg.int32();
+    if (v1) {
+        alg.take(kV1AlgSize - 8);
+    } else {
+        alg.string(1);
+        alg.string(2);
+    }
+    nCoeffs = alg.int32();
+    if (!alg.ok() || nCoeffs > kMaxCoefficients) {
+        CIRRUS_LOGE("Malformed algorithm descriptor");
+        return -EINVAL;
+    }
+
+    pos = alg.pos();
+    for (uint32_t i = 0; i < nCoeffs; i++) {
+        Cursor c(data, pos);
+        DspSymbol sym = {};
+        std::string_view name;
+        uint32_t size;
+
+        sym.algId = algId;
+        sym.offset = c.int16();
+        sym.type = static_cast<uint16_t>(c.int16());
+        size = c.int32();
+        if (v1) {
+            name = c.fixedString();
+            c.take(kV1NameBytes);
+        } else {
+            name = c.string(1);
+            c.string(1);
+            c.string(2);
+        }
+        sym.ctlType = static_cast<uint16_t>(c.int16());
+        sym.flags = static_cast<uint16_t>(c.int16());
+        sym.len = c.int32();
+
+        if (!c.ok() || size > data.size - pos - kCoeffHeaderSize) {
+            CIRRUS_LOGE("Malformed coefficient descriptor %u of algorithm 0x%x", i, algId);
+            return -EINVAL;
+        }
+
+        sym.nameOffset = static_cast<uint32_t>(mNames.size());
+        sym.nameLen = static_cast<uint32_t>(name.size());
+        sym.reg = kUnbound;
+        mNames.append(name);
+        mSymbols.push_back(sym);
+
+        pos += kCoeffHeaderSize + size;
+    }
+
+    return 0;
+}
+
+int SymbolTable::parse(const WmfwFile &wmfw)
+{
+    int ret;
+
+    clear();
+
+    for (const WmfwRegion &region : wmfw.regions()) {
+        if (region.type != wmfw::kAlgorithmData)
+            continue;
+
+        ret = parseRegion(region.data, wmfw.version());
+        if (ret < 0) {
+            CIRRUS_LOGE("%s: bad algorithm data region", wmfw.name().c_str());
+            clear();
+            return ret;
+        }
+    }
+
+    std::sort(mSymbols.begin(), mSymbols.end(), [this](const DspSymbol &a, const DspSymbol &b) {
+        return a.algId != b.algId ? a.algId < b.algId : name(a) < name(b);
+    });
+
+    CIRRUS_LOGD("%s: %zu control symbols", wmfw.name().c_str(), mSymbols.size());
+    return 0;
+}
+
+size_t SymbolTable::bind(const Dsp &dsp)
+{
+    size_t bound = 0;
+
+    mRegmap = &dsp.regmap();
+
+    for (DspSymbol &sym : mSymbols) {
+        sym.reg = kUnbound;
+        if (!dsp.findAlgorithm(sym.algId))
+            continue;
+        if (dsp.algorithmToReg(sym.algId, sym.type, sym.offset, &sym.reg) < 0) {
+            sym.reg = kUnbound;
+            continue;
+        }
+        bound++;
+    }
+
+    if (bound != mSymbols.size())
+        CIRRUS_LOGW("%s: %zu of %zu control symbols not in the running firmware",
+                    dsp.name().c_str(), mSymbols.size() - bound, mSymbols.size());
+    return bound;
+}
+
+const DspSymbol *SymbolTable::find(uint32_t algId, std::string_view key) const
+{
+    auto it = std::lower_bound(mSymbols.begin(), mSymbols.end(), key,
+                               [this, algId](const DspSymbol &sym, std::string_view k) {
+                                   return sym.algId != algId ? sym.algId < algId : name(sym) < k;
+                               });
+
+    if (it == mSymbols.end() || it->algId != algId || name(*it) != key)
+        return nullptr;
+    return &*it;
+}
+
+int SymbolTable::check(const DspSymbol &sym, size_t len, uint16_t mode) const
+{
+    if (!mRegmap || sym.reg == kUnbound)
+        return -ENXIO;
+    if (len % kWordBytes || len > sym.len)
+        return -EINVAL;
+    if (sym.flags && !(sym.flags & mode))
+        return -EPERM;
+    return 0;
+}
+
+int SymbolTable::read(const DspSymbol &sym, void *data, size_t len) const
+{
+    uint8_t *out = static_cast<uint8_t *>(data);
+    size_t pos, chunk;
+    int ret;
+
+    ret = check(sym, len, wmfw::kCtlReadable);
+    if (ret < 0)
+        return ret;
+
+    for (pos = 0; pos < len; pos += chunk) {
+        chunk = std::min(len - pos, mRegmap->maxRawWrite());
+        ret = mRegmap->rawRead(mRegmap->advance(sym.reg, pos), out + pos, chunk);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int SymbolTable::write(BulkWriter &writer, const DspSymbol &sym, ByteView data) const
+{
+    int ret = check(sym, data.size, wmfw::kCtlWriteable);
+
+    if (ret < 0)
+        return ret;
+
+    return writer.write(sym.reg, data);
+}
+
+int SymbolTable::write(const DspSymbol &sym, ByteView data) const
+{
+    int ret = check(sym, data.size, wmfw::kCtlWriteable);
+
+    if (ret < 0)
+        return ret;
+
+    BulkWriter writer(*mRegmap);
+    ret = writer.write(sym.reg, data);
+    if (ret == 0)
+        ret = writer.flush();
+    return ret;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,108 @@
+#include "cirrus/hal/telemetry.h"
+
+#include <cstdio>
+
+#include "cirrus/hal/device.h"
+#include "cirrus/hal/trace.h"
+
+namespace cirrus::hal {
+
+InstrumentedRegmap::InstrumentedRegmap(std::unique_ptr<Regmap> inner) : mInner(std::move(inner))
+{
+}
+
+void InstrumentedRegmap::account(uint64_t start, int ret, size_t readBytes, size_t writeBytes)
+{
+    mBlockedNs.fetch_add(traceNow() - start, std::memory_order_relaxed);
+    mTransactions.fetch_add(1, std::memory_order_relaxed);
+    if (ret < 0) {
+        mErrors.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (readBytes)
+        mReadBytes.fetch_add(readBytes, std::memory_order_relaxed);
+    if (writeBytes)
+        mWriteBytes.fetch_add(writeBytes, std::memory_order_relaxed);
+}
+
+int InstrumentedRegmap::read(uint32_t reg, uint32_t *val)
+{
+    uint64_t start = traceNow();
+    int ret = mInner->read(reg, val);
+
+    account(start, ret, mInner->valBytes(), 0);
+    return ret;
+}
+
+int InstrumentedRegmap::write(uint32_t reg, uint32_t val)
+{
+    uint64_t start = traceNow();
+    int ret = mInner->write(reg, val);
+
+    account(start, ret, 0, mInner->valBytes());
+    return ret;
+}
+
+int InstrumentedRegmap::rawRead(uint32_t reg, void *data, size_t len)
+{
+    uint64_t start = traceNow();
+    int ret = mInner->rawRead(reg, data, len);
+
+    account(start, ret, len, 0);
+    return ret;
+}
+
+int InstrumentedRegmap::rawWrite(uint32_t reg, const void *data, size_t len)
+{
+    uint64_t start = traceNow();
+    int ret = mInner->rawWrite(reg, data, len);
+
+    account(start, ret, 0, len);
+    return ret;
+}
+
+BusCounters InstrumentedRegmap::counters() const
+{
+    return {mTransactions.load(std::memory_order_relaxed),
+            mReadBytes.load(std::memory_order_relaxed),
+            mWriteBytes.load(std::memory_order_relaxed),
+            mErrors.load(std::memory_order_relaxed),
+            mBlockedNs.load(std::memory_order_relaxed)};
+}
+
+void InstrumentedRegmap::resetCounters()
+{
+    mTransactions.store(0, std::memory_order_relaxed);
+    mReadBytes.store(0, std::memory_order_relaxed);
+    mWriteBytes.store(0, std::memory_order_relaxed);
+    mErrors.store(0, std::memory_order_relaxed);
+    mBlockedNs.store(0, std::memory_order_relaxed);
+}
+
+std::string telemetryDump(const std::vector<Device *> &devices)
+{
+    std::string out = "device bus transactions read_bytes write_bytes errors blocked_us "
+                      "dsp_load_pct\n";
+    char line[256];
+
+    for (Device *device : devices) {
+        DeviceTelemetry t = device->telemetry();
+
+        snprintf(line, sizeof(line), "%s %s %llu %llu %llu %llu %.1f ", device->name().c_str(),
+                 device->bus().c_str(), static_cast<unsigned long long>(t.bus.transactions),
+                 static_cast<unsigned long long>(t.bus.readBytes),
+                 static_cast<unsigned long long>(t.bus.writeBytes),
+                 static_cast<unsigned long long>(t.bus.errors), t.bus.blockedNs / 1000.0);
+        out += line;
+
+        if (t.dspLoadPermille < 0)
+            snprintf(line, sizeof(line), "-\n");
+        else
+            snprintf(line, sizeof(line), "%.1f\n", t.dspLoadPermille / 10.0);
+        out += line;
+    }
+
+    return out;
+}
+
+} // namespace cirrus::hal
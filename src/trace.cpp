@@ -0,0 +1,201 @@
+#define LOG_TAG "cirrus-trace"
+
+#include "cirrus/hal/trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr int kBuckets = 64;
+constexpr size_t kOps = static_cast<size_t>(TraceOp::kCount);
+
+/* Bucket n holds samples in [2^(n-1), 2^n) nanoseconds. */
+struct Histogram {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint64_t> buckets[kBuckets] = {};
+};
+
+Histogram gHistograms[kOps];
+/*
+ * gMarkerFd is what scopes write to, -1 while markers are off. The file
+ * itself is opened once and never closed: a scope may still hold the
+ * old value, and a closed fd number is soon reused by a bus or control
+ * fd that must not receive marker text.
+ */
+std::atomic<int> gMarkerFd{-1};
+std::mutex gMarkerLock;
+int gMarkerFile = -1;
+
+const char *const kOpNames[kOps] = {
+        "firmware_load", "coefficient_load", "control_write",
+        "power_up",      "power_down",       "haptic_trigger",
+        "mailbox_flush", "suspend",          "resume",
+};
+
+int bucketOf(uint64_t ns)
+{
+    return ns ? 64 - __builtin_clzll(ns) - (ns >> 63) : 0;
+}
+
+uint64_t percentile(const Histogram &h, uint64_t count, unsigned pct)
+{
+    uint64_t target = (count * pct + 99) / 100, seen = 0;
+
+    for (int i = 0; i < kBuckets; i++) {
+        seen += h.buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target && seen)
+            return i ? (1ULL << i) - 1 : 0;
+    }
+
+    return 0;
+}
+
+void writeMarker(int fd, const char *buf, size_t len)
+{
+    if (write(fd, buf, len) < 0 && errno != EBADF)
+        CIRRUS_LOGW("trace_marker write failed: %s", strerror(errno));
+}
+
+} // namespace
+
+const char *traceOpName(TraceOp op)
+{
+    return static_cast<size_t>(op) < kOps ? kOpNames[static_cast<size_t>(op)] : "unknown";
+}
+
+uint64_t traceNow()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void traceRecord(TraceOp op, uint64_t ns)
+{
+    Histogram &h = gHistograms[static_cast<size_t>(op)];
+    uint64_t max = h.maxNs.load(std::memory_order_relaxed);
+
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    h.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    h.buckets[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    while (ns > max && !h.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+TraceStats traceStats(TraceOp op)
+{
+    const Histogram &h = gHistograms[static_cast<size_t>(op)];
+    TraceStats stats;
+
+    stats.count = h.count.load(std::memory_order_relaxed);
+    stats.totalNs = h.totalNs.load(std::memory_order_relaxed);
+    stats.maxNs = h.maxNs.load(std::memory_order_relaxed);
+    stats.p50Ns = percentile(h, stats.count, 50);
+    stats.p99Ns = percentile(h, stats.count, 99);
+
+    return stats;
+}
+
+void traceReset()
+{
+    for (Histogram &h : gHistograms) {
+        h.count.store(0, std::memory_order_relaxed);
+        h.totalNs.store(0, std::memory_order_relaxed);
+        h.maxNs.store(0, std::memory_order_relaxed);
+        for (auto &bucket : h.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string traceDump()
+{
+    std::string out = "op count mean_us p50_us p99_us max_us\n";
+    char line[160];
+
+    for (size_t i = 0; i < kOps; i++) {
+        TraceStats s = traceStats(static_cast<TraceOp>(i));
+
+        snprintf(line, sizeof(line), "%s %llu %.1f %.1f %.1f %.1f\n", kOpNames[i],
+                 static_cast<unsigned long long>(s.count),
+                 s.count ? s.totalNs / 1000.0 / s.count : 0.0, s.p50Ns / 1000.0,
+                 s.p99Ns / 1000.0, s.maxNs / 1000.0);
+        out += line;
+    }
+
+    return out;
+}
+
+int traceDump(int fd)
+{
+    std::string out = traceDump();
+
+    if (write(fd, out.data(), out.size()) < 0)
+        return -errno;
+    return 0;
+}
+
+int traceSetMarkers(bool enable)
+{
+    std::lock_guard<std::mutex> lock(gMarkerLock);
+
+    if (enable && gMarkerFile < 0) {
+        gMarkerFile = open("/sys/kernel/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+        if (gMarkerFile < 0)
+            gMarkerFile = open("/sys/kernel/debug/tracing/trace_marker", O_WRONLY | O_CLOEXEC);
+        if (gMarkerFile < 0) {
+            int ret = -errno;
+            CIRRUS_LOGE("Failed to open trace_marker: %s", strerror(errno));
+            return ret;
+        }
+    }
+
+    gMarkerFd.store(enable ? gMarkerFile : -1);
+    return 0;
+}
+
+TraceScope::TraceScope(TraceOp op, const char *label)
+    : mOp(op), mMarkerFd(gMarkerFd.load(std::memory_order_relaxed))
+{
+    if (mMarkerFd >= 0) {
+        char buf[128];
+        int len = snprintf(buf, sizeof(buf), "B|%d|cirrus:%s%s%s", getpid(), traceOpName(op),
+                           label ? " " : "", label ? label : "");
+
+        writeMarker(mMarkerFd, buf, std::min<size_t>(len, sizeof(buf) - 1));
+    }
+
+    mStart = traceNow();
+}
+
+TraceScope::~TraceScope()
+{
+    traceRecord(mOp, traceNow() - mStart);
+
+    /*
+     * Close the slice even if markers were turned off meanwhile: the file
+     * is never closed, and an unmatched begin leaves the slice open.
+     */
+    if (mMarkerFd >= 0) {
+        char buf[32];
+        int len = snprintf(buf, sizeof(buf), "E|%d", getpid());
+
+        writeMarker(mMarkerFd, buf, len);
+    }
+}
+
+} // namespace cirrus::hal
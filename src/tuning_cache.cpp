@@ -0,0 +1,317 @@
+#define LOG_TAG "cirrus-tuning-cache"
+
+#include "cirrus/hal/tuning_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/file_util.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kEntrySize = 32;
+constexpr size_t kImageAlign = 16;
+
+size_t alignUp(size_t n)
+{
+    return (n + kImageAlign - 1) & ~(kImageAlign - 1);
+}
+
+} // namespace
+
+int TuningCache::open(const std::string &path)
+{
+    int ret = mFile.open(path);
+    if (ret < 0)
+        return ret;
+
+    return parse(mFile.view());
+}
+
+int TuningCache::parse(ByteView image)
+{
+    const uint8_t *p = image.data;
+    uint32_t count, stringsSize;
+    size_t stringsOffset;
+    std::string_view prev;
+
+    mCount = 0;
+    mIndex = nullptr;
+    mStrings = nullptr;
+    mVerified.reset();
+
+    if (image.size < kHeaderSize || memcmp(p, "CTUN", 4) != 0) {
+        CIRRUS_LOGE("Not a tuning cache image");
+        return -EINVAL;
+    }
+
+    if (readLe16(p + 4) != kVersion || readLe16(p + 6) != kHeaderSize) {
+        CIRRUS_LOGE("Unsupported tuning cache version %u", readLe16(p + 4));
+        return -EINVAL;
+    }
+
+    count = readLe32(p + 8);
+    stringsSize = readLe32(p + 12);
+    if (count > (image.size - kHeaderSize) / kEntrySize ||
+        stringsSize > image.size - kHeaderSize - count * kEntrySize) {
+        CIRRUS_LOGE("Tuning cache index overruns the image");
+        return -EINVAL;
+    }
+
+    stringsOffset = kHeaderSize + count * kEntrySize;
+    if (contentHash(image.sub(kHeaderSize, count * kEntrySize + stringsSize)) !=
+        readLe64(p + 16)) {
+        CIRRUS_LOGE("Tuning cache index is corrupt");
+        return -EINVAL;
+    }
+
+    /* Validate every entry now so lookups never have to. */
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *e = p + kHeaderSize + i * kEntrySize;
+        uint16_t kind = readLe16(e);
+        uint32_t nameOffset = readLe32(e + 4), nameLen = readLe32(e + 8);
+        uint32_t offset = readLe32(e + 12), size = readLe32(e + 16);
+        std::string_view name;
+
+        if ((kind != TuningEntry::kFirmware && kind != TuningEntry::kTuning) ||
+            nameOffset > stringsSize || nameLen > stringsSize - nameOffset ||
+            offset > image.size || size > image.size - offset) {
+            CIRRUS_LOGE("Tuning cache entry %u is out of bounds", i);
+            return -EINVAL;
+        }
+
+        name = {reinterpret_cast<const char *>(p + stringsOffset + nameOffset), nameLen};
+        if (i && name <= prev) {
+            CIRRUS_LOGE("Tuning cache entry %u is out of order", i);
+            return -EINVAL;
+        }
+        prev = name;
+    }
+
+    mImage = image;
+    mIndex = p + kHeaderSize;
+    mStrings = reinterpret_cast<const char *>(p + stringsOffset);
+    mCount = count;
+    /* Images are hashed when first bound, so mapping the cache stays cheap. */
+    mVerified = std::make_unique<std::atomic<bool>[]>(count);
+
+    return 0;
+}
+
+int TuningCache::entry(uint32_t index, TuningEntry *entry) const
+{
+    const uint8_t *e;
+
+    if (index >= mCount)
+        return -EINVAL;
+
+    e = mIndex + index * kEntrySize;
+    entry->kind = static_cast<TuningEntry::Kind>(readLe16(e));
+    entry->name = {mStrings + readLe32(e + 4), readLe32(e + 8)};
+    entry->image = mImage.sub(readLe32(e + 12), readLe32(e + 16));
+    entry->hash = readLe64(e + 24);
+
+    return 0;
+}
+
+int TuningCache::indexOf(std::string_view name, uint32_t *index) const
+{
+    uint32_t lo = 0, hi = mCount;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const uint8_t *e = mIndex + mid * kEntrySize;
+        std::string_view key(mStrings + readLe32(e + 4), readLe32(e + 8));
+
+        if (key == name) {
+            *index = mid;
+            return 0;
+        }
+        if (key < name)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return -ENOENT;
+}
+
+int TuningCache::find(std::string_view name, TuningEntry *entry) const
+{
+    uint32_t index;
+    int ret = indexOf(name, &index);
+    if (ret < 0)
+        return ret;
+
+    return this->entry(index, entry);
+}
+
+int TuningCache::findKind(std::string_view name, TuningEntry::Kind kind,
+                          TuningEntry *entry) const
+{
+    uint32_t index;
+    int ret = indexOf(name, &index);
+    if (ret < 0)
+        return ret;
+    this->entry(index, entry);
+
+    if (entry->kind != kind) {
+        CIRRUS_LOGE("%.*s is not a %s", static_cast<int>(name.size()), name.data(),
+                    kind == TuningEntry::kFirmware ? "firmware" : "tuning");
+        return -EINVAL;
+    }
+
+    if (!mVerified[index].load(std::memory_order_acquire)) {
+        if (contentHash(entry->image) != entry->hash) {
+            CIRRUS_LOGE("%.*s does not match its cached hash", static_cast<int>(name.size()),
+                        name.data());
+            return -EBADMSG;
+        }
+        mVerified[index].store(true, std::memory_order_release);
+    }
+
+    return 0;
+}
+
+int TuningCache::firmware(std::string_view name, WmfwFile *wmfw) const
+{
+    TuningEntry entry;
+    int ret;
+
+    ret = findKind(name, TuningEntry::kFirmware, &entry);
+    if (ret < 0)
+        return ret;
+
+    wmfw->setName(std::string(name));
+    ret = wmfw->parse(entry.image);
+    if (ret < 0)
+        return ret;
+
+    wmfw->setHash(entry.hash);
+    return 0;
+}
+
+int TuningCache::tuning(std::string_view name, BinFile *bin) const
+{
+    TuningEntry entry;
+    int ret;
+
+    ret = findKind(name, TuningEntry::kTuning, &entry);
+    if (ret < 0)
+        return ret;
+
+    bin->setName(std::string(name));
+    return bin->parse(entry.image);
+}
+
+int TuningCacheWriter::addFirmware(const std::string &name, const std::string &path)
+{
+    return add(TuningEntry::kFirmware, name, path);
+}
+
+int TuningCacheWriter::addTuning(const std::string &name, const std::string &path)
+{
+    return add(TuningEntry::kTuning, name, path);
+}
+
+int TuningCacheWriter::add(TuningEntry::Kind kind, const std::string &name,
+                           const std::string &path)
+{
+    MappedFile file;
+    ByteView view;
+    int ret;
+
+    ret = file.open(path);
+    if (ret < 0)
+        return ret;
+    view = file.view();
+
+    /* Refuse anything the loaders would reject later. */
+    if (kind == TuningEntry::kFirmware) {
+        WmfwFile wmfw;
+        wmfw.setName(path);
+        ret = wmfw.parse(view);
+    } else {
+        BinFile bin;
+        bin.setName(path);
+        ret = bin.parse(view);
+    }
+    if (ret < 0)
+        return ret;
+
+    Entry entry = {kind, name, {view.data, view.data + view.size}, contentHash(view)};
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), name,
+                               [](const Entry &e, const std::string &n) { return e.name < n; });
+
+    if (it != mEntries.end() && it->name == name)
+        *it = std::move(entry);
+    else
+        mEntries.insert(it, std::move(entry));
+
+    return 0;
+}
+
+std::vector<uint8_t> TuningCacheWriter::serialize() const
+{
+    size_t indexSize = mEntries.size() * kEntrySize;
+    size_t stringsSize = 0;
+    size_t imagesOffset, size;
+
+    for (const Entry &entry : mEntries)
+        stringsSize += entry.name.size();
+
+    imagesOffset = alignUp(kHeaderSize + indexSize + stringsSize);
+    size = imagesOffset;
+    for (const Entry &entry : mEntries)
+        size = alignUp(size + entry.image.size());
+
+    std::vector<uint8_t> out(size);
+    uint8_t *p = out.data();
+    uint8_t *strings = p + kHeaderSize + indexSize;
+    size_t nameOffset = 0, imageOffset = imagesOffset;
+
+    memcpy(p, "CTUN", 4);
+    writeLe16(p + 4, TuningCache::kVersion);
+    writeLe16(p + 6, kHeaderSize);
+    writeLe32(p + 8, mEntries.size());
+    writeLe32(p + 12, stringsSize);
+
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        const Entry &entry = mEntries[i];
+        uint8_t *e = p + kHeaderSize + i * kEntrySize;
+
+        writeLe16(e, entry.kind);
+        writeLe32(e + 4, nameOffset);
+        writeLe32(e + 8, entry.name.size());
+        writeLe32(e + 12, imageOffset);
+        writeLe32(e + 16, entry.image.size());
+        writeLe64(e + 24, entry.hash);
+
+        memcpy(strings + nameOffset, entry.name.data(), entry.name.size());
+        if (!entry.image.empty())
+            memcpy(p + imageOffset, entry.image.data(), entry.image.size());
+
+        nameOffset += entry.name.size();
+        imageOffset = alignUp(imageOffset + entry.image.size());
+    }
+
+    writeLe64(p + 16, contentHash({p + kHeaderSize, indexSize + stringsSize}));
+
+    return out;
+}
+
+int TuningCacheWriter::write(const std::string &path) const
+{
+    std::vector<uint8_t> image = serialize();
+
+    return writeFileAtomic(path, image.data(), image.size());
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,200 @@
+#define LOG_TAG "cirrus-prewarm"
+
+#include "cirrus/hal/tuning_prewarm.h"
+
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+TuningPrewarmer::TuningPrewarmer(size_t capacity)
+    : mCapacity(capacity ? capacity : 1), mThread(&TuningPrewarmer::run, this)
+{
+}
+
+TuningPrewarmer::~TuningPrewarmer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mWork.notify_all();
+    mThread.join();
+}
+
+int TuningPrewarmer::stage(const std::string &path, std::shared_ptr<const BinFile> *bin)
+{
+    auto file = std::make_shared<BinFile>();
+    int ret;
+
+    ret = file->open(path);
+    if (ret < 0)
+        return ret;
+
+    /* Hashing reads every payload, which also faults the mapping in. */
+    file->blockHashes();
+
+    *bin = std::move(file);
+    return 0;
+}
+
+void TuningPrewarmer::run()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    for (;;) {
+        mWork.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+        if (mStopping)
+            return;
+
+        std::string path = std::move(mQueue.front().first);
+        uint64_t generation = mQueue.front().second;
+        mQueue.pop_front();
+
+        lock.unlock();
+        std::shared_ptr<const BinFile> bin;
+        int ret = stage(path, &bin);
+        lock.lock();
+
+        /* Dropped, or dropped and hinted again while this was staged. */
+        auto it = mEntries.find(path);
+        if (it == mEntries.end() || it->second.generation != generation)
+            continue;
+
+        if (ret < 0)
+            CIRRUS_LOGW("Failed to stage %s: %d", path.c_str(), ret);
+        else
+            CIRRUS_LOGD("Staged %s, %zu blocks", path.c_str(), bin->blocks().size());
+
+        it->second.bin = std::move(bin);
+        it->second.result = ret;
+        it->second.ready = true;
+        mStaged.notify_all();
+    }
+}
+
+void TuningPrewarmer::evict()
+{
+    while (mEntries.size() > mCapacity) {
+        auto victim = mEntries.end();
+
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if (it->second.ready &&
+                (victim == mEntries.end() || it->second.used < victim->second.used))
+                victim = it;
+        }
+
+        /* Everything is still being staged; let it finish. */
+        if (victim == mEntries.end())
+            return;
+
+        mEntries.erase(victim);
+    }
+}
+
+void TuningPrewarmer::hint(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mEntries.find(path);
+
+    if (it != mEntries.end()) {
+        it->second.used = ++mClock;
+        return;
+    }
+
+    Entry &entry = mEntries[path];
+    entry.used = ++mClock;
+    entry.generation = ++mGeneration;
+    mQueue.emplace_back(path, entry.generation);
+    evict();
+    mWork.notify_one();
+}
+
+int TuningPrewarmer::take(const std::string &path, std::shared_ptr<const BinFile> *bin)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mEntries.find(path);
+    int ret;
+
+    if (it != mEntries.end()) {
+        mStaged.wait(lock, [this, &path, &it] {
+            it = mEntries.find(path);
+            return it == mEntries.end() || it->second.ready;
+        });
+    }
+
+    if (it != mEntries.end()) {
+        mHits++;
+        ret = it->second.result;
+        if (ret < 0) {
+            /* Let the next hint try again. */
+            mEntries.erase(it);
+            return ret;
+        }
+
+        it->second.used = ++mClock;
+        *bin = it->second.bin;
+        return 0;
+    }
+
+    mMisses++;
+    lock.unlock();
+    ret = stage(path, bin);
+    if (ret < 0)
+        return ret;
+
+    lock.lock();
+    Entry &entry = mEntries[path];
+    if (!entry.ready) {
+        entry.bin = *bin;
+        entry.ready = true;
+        mStaged.notify_all();
+    }
+    entry.used = ++mClock;
+    evict();
+    return 0;
+}
+
+int TuningPrewarmer::apply(Dsp &dsp, const std::string &path)
+{
+    std::shared_ptr<const BinFile> bin;
+    int ret;
+
+    ret = take(path, &bin);
+    if (ret < 0)
+        return ret;
+
+    return dsp.loadCoefficients(*bin);
+}
+
+void TuningPrewarmer::drop(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mEntries.erase(path);
+    mStaged.notify_all();
+}
+
+void TuningPrewarmer::clear()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mEntries.clear();
+    mQueue.clear();
+    mStaged.notify_all();
+}
+
+size_t TuningPrewarmer::hits() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mHits;
+}
+
+size_t TuningPrewarmer::misses() const
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    return mMisses;
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,117 @@
+#define LOG_TAG "cirrus-use-case"
+
+#include "cirrus/hal/use_case.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "cirrus/hal/bulk_writer.h"
+#include "cirrus/hal/coeff_convert.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+UseCaseState::UseCaseState(size_t blockSize)
+    : mArena(blockSize),
+      mControls(ArenaAllocator<ControlSetting>(mArena)),
+      mCoefficients(ArenaAllocator<CoefficientSetting>(mArena))
+{
+}
+
+void UseCaseState::reset()
+{
+    /* Drop the lists' buffers before the memory under them is reused. */
+    mControls = ArenaVector<ControlSetting>(ArenaAllocator<ControlSetting>(mArena));
+    mCoefficients = ArenaVector<CoefficientSetting>(ArenaAllocator<CoefficientSetting>(mArena));
+    mName = {};
+    mArena.reset();
+}
+
+void UseCaseState::setName(std::string_view name)
+{
+    char *copy = mArena.allocateArray<char>(name.size());
+
+    memcpy(copy, name.data(), name.size());
+    mName = {copy, name.size()};
+}
+
+void UseCaseState::reserve(size_t controls, size_t coefficients)
+{
+    mControls.reserve(controls);
+    mCoefficients.reserve(coefficients);
+}
+
+void UseCaseState::addControl(const ControlInfo &ctl, const long *values, size_t count)
+{
+    long *copy = mArena.allocateArray<long>(count);
+
+    std::copy(values, values + count, copy);
+    mControls.push_back({ctl, copy, static_cast<uint32_t>(count)});
+}
+
+void UseCaseState::addControl(const ControlInfo &ctl, long value)
+{
+    size_t count = std::max<size_t>(ctl.count, 1);
+    long *values = mArena.allocateArray<long>(count);
+
+    std::fill(values, values + count, value);
+    mControls.push_back({ctl, values, static_cast<uint32_t>(count)});
+}
+
+void UseCaseState::addCoefficients(uint32_t reg, const float *values, size_t count,
+                                   unsigned fracBits)
+{
+    uint8_t *data = mArena.allocateArray<uint8_t>(count * 4);
+
+    floatToDsp(values, count, fracBits, data);
+    mCoefficients.push_back({reg, {data, count * 4}});
+}
+
+void UseCaseState::addCoefficients(uint32_t reg, const int32_t *values, size_t count)
+{
+    uint8_t *data = mArena.allocateArray<uint8_t>(count * 4);
+
+    intToDsp(values, count, data);
+    mCoefficients.push_back({reg, {data, count * 4}});
+}
+
+int UseCaseState::applyControls(Mixer &mixer) const
+{
+    for (const ControlSetting &setting : mControls) {
+        int ret = mixer.setValues(setting.ctl, setting.values, setting.count);
+        if (ret < 0) {
+            CIRRUS_LOGE("%.*s: failed to set control %u: %d", static_cast<int>(mName.size()),
+                        mName.data(), setting.ctl.numid, ret);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+int UseCaseState::applyControls(Mixer &mixer, ControlShadow &shadow) const
+{
+    size_t written = shadow.written();
+    int ret;
+
+    ret = shadow.apply(mixer, mControls.data(), mControls.size());
+    CIRRUS_LOGD("%.*s: wrote %zu of %zu controls", static_cast<int>(mName.size()),
+                mName.data(), shadow.written() - written, mControls.size());
+
+    return ret;
+}
+
+int UseCaseState::applyCoefficients(Regmap &regmap) const
+{
+    BulkWriter writer(regmap);
+
+    for (const CoefficientSetting &setting : mCoefficients) {
+        int ret = writer.write(setting.reg, setting.data);
+        if (ret < 0)
+            return ret;
+    }
+
+    return writer.flush();
+}
+
+} // namespace cirrus::hal
@@ -0,0 +1,154 @@
+#define LOG_TAG "cirrus-wavetable"
+
+#include "cirrus/hal/wavetable.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/file_util.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kEntrySize = 16;
+
+} // namespace
+
+int Wavetable::open(const std::string &path)
+{
+    int ret = mFile.open(path);
+    if (ret < 0)
+        return ret;
+
+    return parse(mFile.view());
+}
+
+int Wavetable::parse(ByteView image)
+{
+    const uint8_t *p = image.data;
+    uint32_t indexOffset, dataOffset, dataSize;
+
+    mCount = 0;
+    mIndex = mData = nullptr;
+
+    if (image.size < kHeaderSize || memcmp(p, "CWTB", 4) != 0) {
+        CIRRUS_LOGE("Not a wavetable image");
+        return -EINVAL;
+    }
+
+    if (readLe16(p + 4) != kVersion || readLe16(p + 6) < kHeaderSize) {
+        CIRRUS_LOGE("Unsupported wavetable version %u", readLe16(p + 4));
+        return -EINVAL;
+    }
+
+    mCount = readLe32(p + 8);
+    indexOffset = readLe32(p + 12);
+    dataOffset = readLe32(p + 16);
+    dataSize = readLe32(p + 20);
+
+    if (indexOffset > image.size || mCount > (image.size - indexOffset) / kEntrySize ||
+        dataOffset > image.size || dataSize > image.size - dataOffset) {
+        CIRRUS_LOGE("Wavetable sections overrun the image");
+        mCount = 0;
+        return -EINVAL;
+    }
+
+    if (contentHash(image.sub(indexOffset, mCount * kEntrySize)) != readLe64(p + 24)) {
+        CIRRUS_LOGE("Wavetable index is corrupt");
+        mCount = 0;
+        return -EINVAL;
+    }
+
+    /* Validate every entry now so effect() never has to. */
+    for (uint32_t i = 0; i < mCount; i++) {
+        const uint8_t *e = p + indexOffset + i * kEntrySize;
+        uint32_t offset = readLe32(e + 4), length = readLe32(e + 8);
+
+        if (offset > dataSize || length > dataSize - offset || length % 4) {
+            CIRRUS_LOGE("Wavetable effect %u is out of bounds", i);
+            mCount = 0;
+            return -EINVAL;
+        }
+    }
+
+    mImage = image;
+    mIndex = p + indexOffset;
+    mData = p + dataOffset;
+
+    return 0;
+}
+
+int Wavetable::effect(uint32_t index, WaveEffect *effect) const
+{
+    const uint8_t *e;
+
+    if (index >= mCount)
+        return -EINVAL;
+
+    e = mIndex + index * kEntrySize;
+    effect->type = readLe16(e);
+    effect->flags = readLe16(e + 2);
+    effect->data = {mData + readLe32(e + 4), readLe32(e + 8)};
+    effect->duration = readLe32(e + 12);
+
+    return 0;
+}
+
+uint32_t WavetableWriter::add(uint16_t type, const std::vector<int32_t> &words,
+                              uint32_t duration, uint16_t flags)
+{
+    size_t offset = mData.size();
+
+    mData.resize(offset + words.size() * 4);
+    for (size_t i = 0; i < words.size(); i++)
+        writeBe32(&mData[offset + i * 4], static_cast<uint32_t>(words[i]) & 0xffffff);
+
+    mEntries.push_back({type, flags, static_cast<uint32_t>(offset),
+                        static_cast<uint32_t>(words.size() * 4), duration});
+    return mEntries.size() - 1;
+}
+
+std::vector<uint8_t> WavetableWriter::serialize() const
+{
+    size_t indexSize = mEntries.size() * kEntrySize;
+    std::vector<uint8_t> out(kHeaderSize + indexSize + mData.size());
+    uint8_t *p = out.data();
+
+    memcpy(p, "CWTB", 4);
+    writeLe16(p + 4, Wavetable::kVersion);
+    writeLe16(p + 6, kHeaderSize);
+    writeLe32(p + 8, mEntries.size());
+    writeLe32(p + 12, kHeaderSize);
+    writeLe32(p + 16, kHeaderSize + indexSize);
+    writeLe32(p + 20, mData.size());
+
+    for (size_t i = 0; i < mEntries.size(); i++) {
+        uint8_t *e = p + kHeaderSize + i * kEntrySize;
+
+        writeLe16(e, mEntries[i].type);
+        writeLe16(e + 2, mEntries[i].flags);
+        writeLe32(e + 4, mEntries[i].offset);
+        writeLe32(e + 8, mEntries[i].length);
+        writeLe32(e + 12, mEntries[i].duration);
+    }
+
+    writeLe64(p + 24, contentHash({p + kHeaderSize, indexSize}));
+    if (!mData.empty())
+        memcpy(p + kHeaderSize + indexSize, mData.data(), mData.size());
+
+    return out;
+}
+
+int WavetableWriter::write(const std::string &path) const
+{
+    std::vector<uint8_t> image = serialize();
+
+    return writeFileAtomic(path, image.data(), image.size());
+}
+
+} // namespace cirrus::hal
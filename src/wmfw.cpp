@@ -0,0 +1,210 @@
+#define LOG_TAG "cirrus-wmfw"
+
+#include "cirrus/hal/wmfw.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/log.h"
+
+namespace cirrus::hal {
+
+namespace {
+
+/* struct wmfw_header: magic[4], len (le32), rev (le16), core, ver */
+constexpr size_t kWmfwHeaderSize = 12;
+/* struct wmfw_adsp1_sizes: dm, pm, zm */
+constexpr size_t kAdsp1SizesSize = 12;
+/* struct wmfw_adsp2_sizes: xm, ym, pm, zm; also used by Halo */
+constexpr size_t kAdsp2SizesSize = 16;
+/* struct wmfw_footer: timestamp (le64), checksum (le32) */
+constexpr size_t kWmfwFooterSize = 12;
+/* struct wmfw_region: offset/type (le32), len (le32) */
+constexpr size_t kWmfwRegionSize = 8;
+
+/* struct wmfw_coeff_hdr: magic[4], len (le32), rev (be32) */
+constexpr size_t kBinHeaderSize = 12;
+/* struct wmfw_coeff_item: offset, type (le16), id, ver, sr, len (le32) */
+constexpr size_t kBinBlockSize = 20;
+
+const char *labelOf(const std::string &name)
+{
+    return name.empty() ? "<memory>" : name.c_str();
+}
+
+} // namespace
+
+int WmfwFile::open(const std::string &path)
+{
+    int ret = mFile.open(path);
+    if (ret < 0)
+        return ret;
+
+    mName = path;
+    return parse(mFile.view());
+}
+
+int WmfwFile::parse(ByteView image)
+{
+    const uint8_t *data = image.data;
+    size_t pos;
+
+    mRegions.clear();
+    mImage = {};
+    mHashValid = false;
+
+    if (image.size < kWmfwHeaderSize || memcmp(data, "WMFW", 4) != 0) {
+        CIRRUS_LOGE("%s: not a WMFW file", labelOf(mName));
+        return -EINVAL;
+    }
+
+    mRevision = readLe16(data + 8);
+    mCore = data[10];
+    mVersion = data[11];
+
+    if (mVersion > 3) {
+        CIRRUS_LOGE("%s: unknown file format %u", labelOf(mName), mVersion);
+        return -EINVAL;
+    }
+
+    pos = kWmfwHeaderSize;
+    switch (mCore) {
+    case wmfw::kCoreAdsp1:
+        pos += kAdsp1SizesSize;
+        break;
+    case wmfw::kCoreAdsp2:
+    case wmfw::kCoreHalo:
+        pos += kAdsp2SizesSize;
+        break;
+    default:
+        CIRRUS_LOGE("%s: unknown core type %u", labelOf(mName), mCore);
+        return -EINVAL;
+    }
+
+    if (image.size < pos + kWmfwFooterSize) {
+        CIRRUS_LOGE("%s: truncated header", labelOf(mName));
+        return -EINVAL;
+    }
+
+    mTimestamp = readLe64(data + pos);
+    mChecksum = readLe32(data + pos + 8);
+    pos += kWmfwFooterSize;
+
+    if (readLe32(data + 4) != pos) {
+        CIRRUS_LOGE("%s: header length %u does not match %zu", labelOf(mName),
+                    readLe32(data + 4), pos);
+        return -EINVAL;
+    }
+
+    while (pos < image.size && image.size - pos > kWmfwRegionSize) {
+        const uint8_t *hdr = data + pos;
+        uint32_t len = readLe32(hdr + 4);
+
+        if (len > image.size - pos - kWmfwRegionSize) {
+            CIRRUS_LOGE("%s: region at %zu overruns file (%u bytes)", labelOf(mName), pos, len);
+            mRegions.clear();
+            return -EINVAL;
+        }
+
+        /* The type is the top byte of the big-endian view of the first word. */
+        mRegions.push_back({hdr[3], readLe32(hdr) & 0xffffff,
+                            image.sub(pos + kWmfwRegionSize, len)});
+
+        pos += kWmfwRegionSize + len;
+    }
+
+    if (pos != image.size)
+        CIRRUS_LOGW("%s: %zu trailing bytes ignored", labelOf(mName), image.size - pos);
+
+    mImage = image;
+    return 0;
+}
+
+uint64_t WmfwFile::hash() const
+{
+    if (!mHashValid) {
+        mHash = contentHash(mImage);
+        mHashValid = true;
+    }
+
+    return mHash;
+}
+
+int BinFile::open(const std::string &path)
+{
+    int ret = mFile.open(path);
+    if (ret < 0)
+        return ret;
+
+    mName = path;
+    return parse(mFile.view());
+}
+
+int BinFile::parse(ByteView image)
+{
+    const uint8_t *data = image.data;
+    size_t pos;
+
+    mBlocks.clear();
+    mImage = {};
+    mBlockHashesValid = false;
+
+    if (image.size < kBinHeaderSize || memcmp(data, "WMDR", 4) != 0) {
+        CIRRUS_LOGE("%s: not a WMDR file", labelOf(mName));
+        return -EINVAL;
+    }
+
+    mRevision = readBe32(data + 8) & 0xff;
+    switch (mRevision) {
+    case 1:
+    case 2:
+        break;
+    default:
+        CIRRUS_LOGE("%s: unsupported coefficient file format %u", labelOf(mName), mRevision);
+        return -EINVAL;
+    }
+
+    pos = readLe32(data + 4);
+    if (pos < kBinHeaderSize || pos > image.size) {
+        CIRRUS_LOGE("%s: bad header length %zu", labelOf(mName), pos);
+        return -EINVAL;
+    }
+
+    while (pos < image.size && image.size - pos > kBinBlockSize) {
+        const uint8_t *hdr = data + pos;
+        uint32_t len = readLe32(hdr + 16);
+
+        if (len > image.size - pos - kBinBlockSize) {
+            CIRRUS_LOGE("%s: block at %zu overruns file (%u bytes)", labelOf(mName), pos, len);
+            mBlocks.clear();
+            return -EINVAL;
+        }
+
+        mBlocks.push_back({readLe16(hdr + 2), readLe16(hdr), readLe32(hdr + 4),
+                           readLe32(hdr + 8) >> 8, readLe32(hdr + 12),
+                           image.sub(pos + kBinBlockSize, len)});
+
+        /* Blocks are padded to a 32-bit boundary. */
+        pos += (kBinBlockSize + len + 3) & ~size_t(3);
+    }
+
+    mImage = image;
+    return 0;
+}
+
+const std::vector<uint64_t> &BinFile::blockHashes() const
+{
+    if (!mBlockHashesValid) {
+        mBlockHashes.clear();
+        mBlockHashes.reserve(mBlocks.size());
+        for (const BinBlock &blk : mBlocks)
+            mBlockHashes.push_back(contentHash(blk.data));
+        mBlockHashesValid = true;
+    }
+
+    return mBlockHashes;
+}
+
+} // namespace cirrus::hal
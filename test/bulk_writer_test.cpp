@@ -0,0 +1,116 @@
+#include "cirrus/hal/bulk_writer.h"
+
+#include <cerrno>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void testCoalesce()
+{
+    SimRegmap regmap;
+    BulkWriter writer(regmap);
+    std::vector<uint8_t> a = pattern(8, 1), b = pattern(4, 2), c = pattern(4, 3);
+
+    /* Consecutive pieces go out together; a gap starts a new transfer. */
+    CHECK(writer.write(0x100, viewOf(a)) == 0);
+    CHECK(writer.write(0x108, viewOf(b)) == 0);
+    CHECK(writer.write(0x10c, 0x12345678u) == 0);
+    CHECK(writer.write(0x200, viewOf(c)) == 0);
+    CHECK(writer.flush() == 0);
+
+    CHECK(writer.transactions() == 2);
+    CHECK(writer.bytes() == 20);
+    CHECK(regmap.transactions() == 2);
+    CHECK(regmap.peek(0x104) == readBe32(&a[4]));
+    CHECK(regmap.peek(0x108) == readBe32(&b[0]));
+    CHECK(regmap.peek(0x10c) == 0x12345678);
+    CHECK(regmap.peek(0x200) == readBe32(&c[0]));
+}
+
+void testSplit()
+{
+    SimBusConfig config;
+    config.maxBurst = 16;
+    SimRegmap regmap(config);
+    BulkWriter writer(regmap);
+    std::vector<uint8_t> data = pattern(40, 1);
+
+    /* A run longer than the bus allows is cut at maxRawWrite(). */
+    CHECK(writer.write(0x100, viewOf(data)) == 0);
+    CHECK(writer.flush() == 0);
+    CHECK(regmap.transactions() == 3);
+    CHECK(regmap.peek(0x100 + 36) == readBe32(&data[36]));
+}
+
+void testStride()
+{
+    SimRegmap regmap({}, 2);
+    BulkWriter writer(regmap);
+    std::vector<uint8_t> a = pattern(8, 1), b = pattern(4, 2);
+
+    /* At a stride of 2, 8 bytes later is 4 addresses on. */
+    CHECK(writer.write(0x100, viewOf(a)) == 0);
+    CHECK(writer.write(0x104, viewOf(b)) == 0);
+    CHECK(writer.flush() == 0);
+    CHECK(regmap.transactions() == 1);
+    CHECK(regmap.peek(0x102) == readBe32(&a[4]));
+    CHECK(regmap.peek(0x104) == readBe32(&b[0]));
+}
+
+void testRejects()
+{
+    SimRegmap regmap;
+    BulkWriter writer(regmap);
+    std::vector<uint8_t> odd = pattern(6, 1);
+
+    CHECK(writer.write(0x100, viewOf(odd)) == -EINVAL);
+    CHECK(writer.write(0x100, ByteView{}) == 0);
+    CHECK(writer.flush() == 0);
+    CHECK(regmap.transactions() == 0);
+
+    /* A bus that cannot carry one register fails instead of spinning. */
+    SimBusConfig tiny;
+    tiny.maxBurst = 2;
+    SimRegmap small(tiny);
+    BulkWriter stuck(small);
+
+    CHECK(stuck.write(0x100, 1u) == -EINVAL);
+    CHECK(stuck.flush() == 0);
+    CHECK(small.transactions() == 0);
+}
+
+void testBusError()
+{
+    SimRegmap regmap;
+    BulkWriter writer(regmap);
+    std::vector<uint8_t> data = pattern(8, 1);
+
+    regmap.failRange(0x100, 0x100);
+    CHECK(writer.write(0x100, viewOf(data)) == 0);
+    CHECK(writer.flush() == -EIO);
+
+    /* The failed run is discarded, not retried by the next flush. */
+    regmap.clearFailures();
+    CHECK(writer.flush() == 0);
+    CHECK(regmap.transactions() == 1);
+    CHECK(regmap.peek(0x100) == 0);
+}
+
+const TestCase kTests[] = {
+        {"coalesce", testCoalesce},
+        {"split", testSplit},
+        {"stride", testStride},
+        {"rejects", testRejects},
+        {"bus_error", testBusError},
+};
+
+} // namespace
+
+const TestSuite kBulkWriterTests("bulk_writer", kTests);
+
+} // namespace cirrus::hal::test
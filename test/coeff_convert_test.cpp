@@ -0,0 +1,182 @@
+#include "cirrus/hal/coeff_convert.h"
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "cirrus/hal/byte_order.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+/* Longer than two vectors plus a tail, so every length mod 4 is covered. */
+constexpr size_t kMaxCount = 19;
+constexpr uint8_t kGuard = 0xa5;
+
+const float kInf = std::numeric_limits<float>::infinity();
+const float kNan = std::numeric_limits<float>::quiet_NaN();
+
+/* Scalar reference: scale, round half to even, saturate; NaN is the minimum. */
+int32_t reference24(float v, unsigned fracBits)
+{
+    double x = static_cast<double>(v) * std::ldexp(1.0, static_cast<int>(fracBits));
+
+    if (std::isnan(x) || x <= -8388608.0)
+        return -8388608;
+    if (x >= 8388607.0)
+        return 8388607;
+    return static_cast<int32_t>(std::nearbyint(x));
+}
+
+/*
+ * Convert each prefix of @in, output buffer offset by one byte, and check
+ * every word against the reference. An element lands in a vector lane for
+ * some prefixes and in the scalar tail for others.
+ */
+void checkFloat(const std::vector<float> &in, unsigned fracBits)
+{
+    for (size_t count = 0; count <= in.size(); count++) {
+        std::vector<uint8_t> buf(1 + count * 4 + 16, kGuard);
+        uint8_t *out = buf.data() + 1;
+
+        floatToDsp(in.data(), count, fracBits, out);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t want = static_cast<uint32_t>(reference24(in[i], fracBits)) & 0xffffff;
+
+            if (!CHECK(readBe32(out + i * 4) == want))
+                fprintf(stderr, "  %s: count %zu, in[%zu] = %g << %u\n", coeffConvertImpl(),
+                        count, i, in[i], fracBits);
+        }
+        CHECK(buf[0] == kGuard);
+        for (size_t i = 1 + count * 4; i < buf.size(); i++)
+            CHECK(buf[i] == kGuard);
+    }
+}
+
+std::vector<int32_t> intInputs()
+{
+    std::vector<int32_t> in;
+
+    for (size_t i = 0; i < kMaxCount; i++)
+        in.push_back(static_cast<int32_t>(0x9e3779b9u * (i + 1)));
+    /* Bits above 24 are dropped, whatever the sign. */
+    in[0] = 0x7fffffff;
+    in[1] = INT32_MIN;
+    in[2] = -1;
+    in[3] = 0x00800000;
+    return in;
+}
+
+void testLiterals()
+{
+    const float in[] = {0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 0.0f, 1e9f};
+    const int32_t want[] = {0, 2, 2, 0, -2, -2, 0, 8388607};
+    uint8_t out[sizeof(in) / sizeof(in[0]) * 4];
+
+    floatToDsp(in, 8, 0, out);
+    for (size_t i = 0; i < 8; i++)
+        CHECK(readBe32(out + i * 4) == (static_cast<uint32_t>(want[i]) & 0xffffff));
+
+    /* Q23: 1.0 saturates, -1.0 is exactly the minimum. */
+    const float q23[] = {1.0f, -1.0f, 0.5f, kNan};
+    floatToDsp(q23, 4, 23, out);
+    CHECK(readBe32(out) == 0x7fffff);
+    CHECK(readBe32(out + 4) == 0x800000);
+    CHECK(readBe32(out + 8) == 0x400000);
+    CHECK(readBe32(out + 12) == 0x800000);
+}
+
+void testFloatSpecials()
+{
+    /* Specials and saturation boundaries, in both vector and tail lanes. */
+    const std::vector<float> in = {
+            kNan,       kInf,         -kInf,        -kNan,        8388607.0f,   8388607.5f,
+            8388608.0f, -8388608.0f,  -8388608.5f,  -8388609.0f,  0.5f,         1.5f,
+            -0.5f,      -2.5f,        3.5f,         1e30f,        -1e30f,       -0.0f,
+            1e-30f,
+    };
+
+    checkFloat(in, 0);
+}
+
+void testFloatScaled()
+{
+    std::vector<float> in;
+
+    for (size_t i = 0; i < kMaxCount; i++)
+        in.push_back(static_cast<float>((static_cast<int>(i * 37 % 41) - 20) / 16.0));
+    in[5] = kNan;
+    in[11] = -kInf;
+    in[17] = kInf;
+    /* Exactly half an LSB at Q23 and Q20. */
+    in[2] = 1.0f / (1 << 24);
+    in[3] = 3.0f / (1 << 21);
+
+    for (unsigned fracBits : {0u, 15u, 20u, 23u, 31u})
+        checkFloat(in, fracBits);
+}
+
+void testInt()
+{
+    const std::vector<int32_t> in = intInputs();
+
+    for (size_t count = 0; count <= in.size(); count++) {
+        std::vector<uint8_t> buf(1 + count * 4 + 16, kGuard);
+        std::vector<int32_t> back(count);
+        uint8_t *out = buf.data() + 1;
+
+        intToDsp(in.data(), count, out);
+        for (size_t i = 0; i < count; i++)
+            CHECK(readBe32(out + i * 4) == (static_cast<uint32_t>(in[i]) & 0xffffff));
+        for (size_t i = 1 + count * 4; i < buf.size(); i++)
+            CHECK(buf[i] == kGuard);
+
+        dspToInt(out, count, back.data());
+        for (size_t i = 0; i < count; i++)
+            CHECK(back[i] == static_cast<int32_t>(static_cast<uint32_t>(in[i]) << 8) >> 8);
+    }
+}
+
+void testPack()
+{
+    const std::vector<int32_t> in = intInputs();
+
+    /* Unaligned input too: the vector loads must not assume alignment. */
+    for (size_t skip = 0; skip < 2; skip++) {
+        for (size_t count = 0; count + skip <= in.size(); count++) {
+            std::vector<uint8_t> buf(1 + count * 3 + 16, kGuard);
+            uint8_t *out = buf.data() + 1;
+            const int32_t *src = in.data() + skip;
+
+            packDsp24(src, count, out);
+            for (size_t i = 0; i < count; i++) {
+                uint32_t v = static_cast<uint32_t>(src[i]);
+
+                CHECK(out[i * 3] == static_cast<uint8_t>(v >> 16));
+                CHECK(out[i * 3 + 1] == static_cast<uint8_t>(v >> 8));
+                CHECK(out[i * 3 + 2] == static_cast<uint8_t>(v));
+            }
+            /* The 16-byte stores must never run past the last word. */
+            CHECK(buf[0] == kGuard);
+            for (size_t i = 1 + count * 3; i < buf.size(); i++)
+                CHECK(buf[i] == kGuard);
+        }
+    }
+}
+
+const TestCase kTests[] = {
+        {"literals", testLiterals},
+        {"float_specials", testFloatSpecials},
+        {"float_scaled", testFloatScaled},
+        {"int", testInt},
+        {"pack", testPack},
+};
+
+} // namespace
+
+const TestSuite kCoeffConvertTests("coeff_convert", kTests);
+
+} // namespace cirrus::hal::test
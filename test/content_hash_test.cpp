@@ -0,0 +1,104 @@
+#include "cirrus/hal/content_hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+struct KnownAnswer {
+    size_t len;
+    uint64_t xxh64;
+    uint32_t xxh32;
+};
+
+/*
+ * pattern(len, 1), hashed by an independent implementation of the xxHash
+ * specification. The lengths stop short of each stripe and word size so
+ * every tail path runs; 111 is three XXH64 stripes plus an 8, a 4 and
+ * three single-byte tail steps.
+ */
+const KnownAnswer kAnswers[] = {
+        {0, 0xef46db3751d8e999, 0x02cc5d05},   {3, 0xb6e6c910c2fd373a, 0x17e09e36},
+        {7, 0x34084d91a233a751, 0x6be361e9},   {15, 0x514c6f58d37ce6f1, 0xc1ab2cf5},
+        {31, 0x6ab1c40e29f50073, 0x8133d2c6},  {111, 0xe1d107aee83d79e3, 0x280d0bf1},
+};
+
+ByteView bytesOf(const char *s)
+{
+    return {reinterpret_cast<const uint8_t *>(s), strlen(s)};
+}
+
+void testKnownAnswers()
+{
+    for (const KnownAnswer &answer : kAnswers) {
+        std::vector<uint8_t> data = pattern(answer.len, 1);
+
+        CHECK(contentHash(viewOf(data)) == answer.xxh64);
+        CHECK(xxh32(viewOf(data)) == answer.xxh32);
+    }
+
+    /* Published xxHash vectors. */
+    CHECK(contentHash(bytesOf("abc")) == 0x44bc2cf5ad770999);
+    CHECK(xxh32(bytesOf("abc")) == 0x32d153ff);
+    CHECK(contentHash(bytesOf("Nobody inspects the spammish repetition")) ==
+          0xfbcea83c8a378bf1);
+    CHECK(xxh32(bytesOf("Nobody inspects the spammish repetition")) == 0xe2293b2f);
+}
+
+void testSeeds()
+{
+    std::vector<uint8_t> data = pattern(111, 1);
+
+    CHECK(contentHash(viewOf(data), 0x123456789abcdef0) == 0x9b6976c5465c626b);
+    CHECK(xxh32(viewOf(data), 0x9e3779b1) == 0xc92c7763);
+}
+
+void testUnaligned()
+{
+    std::vector<uint8_t> data = pattern(111, 1);
+    uint8_t buf[128];
+
+    /* Words are loaded little-endian from any alignment. */
+    for (size_t shift = 1; shift < 8; shift++) {
+        memcpy(buf + shift, data.data(), data.size());
+        CHECK(contentHash({buf + shift, data.size()}) == 0xe1d107aee83d79e3);
+        CHECK(xxh32({buf + shift, data.size()}) == 0x280d0bf1);
+    }
+}
+
+void testIncremental()
+{
+    std::vector<uint8_t> data = pattern(111, 1);
+    const size_t pieces[] = {1, 3, 5, 16, 17, 40};
+
+    for (size_t piece : pieces) {
+        Xxh32 hash;
+
+        for (size_t pos = 0; pos < data.size(); pos += piece)
+            hash.update({&data[pos], std::min(piece, data.size() - pos)});
+        CHECK(hash.digest() == 0x280d0bf1);
+    }
+
+    Xxh32 hash(0x9e3779b1);
+    hash.update(viewOf(data));
+    CHECK(hash.digest() == 0xc92c7763);
+    hash.reset();
+    CHECK(hash.digest() == 0x02cc5d05);
+}
+
+const TestCase kTests[] = {
+        {"known_answers", testKnownAnswers},
+        {"seeds", testSeeds},
+        {"unaligned", testUnaligned},
+        {"incremental", testIncremental},
+};
+
+} // namespace
+
+const TestSuite kContentHashTests("content_hash", kTests);
+
+} // namespace cirrus::hal::test
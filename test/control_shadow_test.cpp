@@ -0,0 +1,80 @@
+#include "cirrus/hal/control_shadow.h"
+
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+const ControlInfo kStereo = {3, 2, 2, 0};
+const ControlInfo kMono = {5, 2, 1, 0};
+const long kBoth[] = {10, 20};
+const long kLeft[] = {30};
+
+void testMatches()
+{
+    ControlShadow shadow;
+
+    /* Nothing is known until it has been written. */
+    CHECK(!shadow.matches(kStereo, kBoth, 2));
+
+    shadow.update(kStereo, kBoth, 2);
+    shadow.update(kMono, kLeft, 1);
+    CHECK(shadow.matches(kStereo, kBoth, 2));
+    CHECK(!shadow.matches(kStereo, kBoth, 1));
+    CHECK(!shadow.matches(kStereo, kLeft, 1));
+    CHECK(shadow.matches(kMono, kLeft, 1));
+
+    const long other[] = {10, 21};
+    CHECK(!shadow.matches(kStereo, other, 2));
+}
+
+void testAlternatingCounts()
+{
+    ControlShadow shadow;
+
+    /* A partial write reuses the control's slot rather than growing. */
+    shadow.update(kMono, kLeft, 1);
+    for (int i = 0; i < 4; i++) {
+        shadow.update(kStereo, kLeft, 1);
+        CHECK(shadow.matches(kStereo, kLeft, 1));
+        CHECK(!shadow.matches(kStereo, kBoth, 2));
+        shadow.update(kStereo, kBoth, 2);
+        CHECK(shadow.matches(kStereo, kBoth, 2));
+    }
+    CHECK(shadow.matches(kMono, kLeft, 1));
+}
+
+void testInvalidate()
+{
+    ControlShadow shadow;
+
+    shadow.update(kStereo, kBoth, 2);
+    shadow.update(kMono, kLeft, 1);
+
+    shadow.invalidate(kStereo.numid);
+    CHECK(!shadow.matches(kStereo, kBoth, 2));
+    CHECK(shadow.matches(kMono, kLeft, 1));
+    /* Unknown numids are ignored. */
+    shadow.invalidate(100);
+
+    shadow.update(kStereo, kBoth, 2);
+    CHECK(shadow.matches(kStereo, kBoth, 2));
+
+    shadow.clear();
+    CHECK(!shadow.matches(kMono, kLeft, 1));
+    CHECK(!shadow.matches(kStereo, kBoth, 2));
+    CHECK(shadow.written() == 0);
+}
+
+const TestCase kTests[] = {
+        {"matches", testMatches},
+        {"alternating_counts", testAlternatingCounts},
+        {"invalidate", testInvalidate},
+};
+
+} // namespace
+
+const TestSuite kControlShadowTests("control_shadow", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,175 @@
+#include "cirrus/hal/device.h"
+
+#include <cerrno>
+#include <memory>
+
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+constexpr uint32_t kHaloXm = 0x02800000;
+
+/*
+ * A CS35L41 as its power sequences see it: IRQ1_STATUS1 is
+ * write-1-to-clear, and PUP_DONE or PDN_DONE is raised a couple of status
+ * reads after GLOBAL_EN changes.
+ */
+class Cs35l41Sim : public SimRegmap {
+public:
+    int read(uint32_t reg, uint32_t *val) override
+    {
+        if (reg == parts::kIrq1Status1 && mPending && --mReadsUntilDone == 0) {
+            poke(reg, peek(reg) | mPending);
+            mPending = 0;
+        }
+        return SimRegmap::read(reg, val);
+    }
+
+    int write(uint32_t reg, uint32_t val) override
+    {
+        int ret;
+
+        if (reg == parts::kIrq1Status1) {
+            ret = SimRegmap::write(reg, peek(reg));
+            poke(reg, peek(reg) & ~val);
+            return ret;
+        }
+
+        ret = SimRegmap::write(reg, val);
+        if (reg == parts::kCs35l41PwrCtrl1) {
+            mPending = (val & parts::kCs35l41GlobalEn) ? parts::kCs35l41PupDone
+                                                       : parts::kCs35l41PdnDone;
+            mReadsUntilDone = 2;
+        }
+        return ret;
+    }
+
+    /* The last transition had not completed when the sequence returned. */
+    bool transitionPending() const { return mPending != 0; }
+
+private:
+    uint32_t mPending = 0;
+    int mReadsUntilDone = 0;
+};
+
+struct Cs35l41 {
+    Cs35l41() : sim(new Cs35l41Sim), device(descriptorOf<Part::kCs35l41>(), "amp", "i2c-0",
+                                            std::unique_ptr<Regmap>(sim))
+    {
+    }
+
+    Cs35l41Sim *sim;
+    Device device;
+};
+
+void testPowerUp()
+{
+    Cs35l41 amp;
+    Cs35l41Sim &regmap = *amp.sim;
+
+    /* Left over from an earlier transition, plus a fault not yet handled. */
+    regmap.poke(parts::kIrq1Status1, parts::kCs35l41PupDone | parts::kTempErr);
+
+    CHECK(amp.device.powerUp() == 0);
+    /* The stale PUP_DONE was acked, so the poll waited for the real one. */
+    CHECK(!regmap.transitionPending());
+    CHECK(regmap.peek(parts::kIrq1Status1) & parts::kTempErr);
+    CHECK(regmap.peek(parts::kCs35l41PwrCtrl1) & parts::kCs35l41GlobalEn);
+    CHECK(regmap.peek(parts::kHaloCoreControl) & parts::kHaloCoreEnable);
+}
+
+void testPowerDown()
+{
+    Cs35l41 amp;
+    Cs35l41Sim &regmap = *amp.sim;
+
+    CHECK(amp.device.powerUp() == 0);
+    regmap.poke(parts::kIrq1Status1,
+                regmap.peek(parts::kIrq1Status1) | parts::kCs35l41PdnDone | parts::kTempErr);
+
+    CHECK(amp.device.powerDown() == 0);
+    CHECK(!regmap.transitionPending());
+    CHECK(regmap.peek(parts::kIrq1Status1) & parts::kTempErr);
+    CHECK(!(regmap.peek(parts::kCs35l41PwrCtrl1) & parts::kCs35l41GlobalEn));
+    CHECK(!(regmap.peek(parts::kHaloCoreControl) & parts::kHaloCoreEnable));
+}
+
+void testPowerUpBusError()
+{
+    Cs35l41 amp;
+
+    /* A failed step stops the sequence before the DSP is started. */
+    amp.sim->failRange(parts::kCs35l41PwrCtrl1, parts::kCs35l41PwrCtrl1);
+    CHECK(amp.device.powerUp() < 0);
+    CHECK(!(amp.sim->peek(parts::kHaloCoreControl) & parts::kHaloCoreEnable));
+}
+
+void testSuspendResume()
+{
+    const DeviceDescriptor &desc = descriptorOf<Part::kCs35l41>();
+    Cs35l41 amp;
+    Cs35l41Sim &regmap = *amp.sim;
+
+    CHECK(amp.device.resume() == -ENODATA);
+    CHECK(amp.device.powerUp() == 0);
+
+    for (const RegDefault &r : desc.retained)
+        regmap.poke(r.reg, r.val);
+    regmap.poke(desc.retained[0].reg, ~desc.retained[0].val);
+    regmap.poke(kHaloXm + 0x40, 0xabcdef);
+    amp.device.retainOnSuspend(kHaloXm + 0x40, 4);
+
+    CHECK(amp.device.suspend() == 0);
+    CHECK(amp.device.snapshotBytes() == 8);
+
+    /* What the part loses while suspended. */
+    for (const RegDefault &r : desc.retained)
+        regmap.poke(r.reg, r.val);
+    regmap.poke(kHaloXm + 0x40, 0);
+
+    CHECK(amp.device.resume() == 0);
+    CHECK(!regmap.transitionPending());
+    CHECK(regmap.peek(desc.retained[0].reg) == ~desc.retained[0].val);
+    CHECK(regmap.peek(kHaloXm + 0x40) == 0xabcdef);
+    CHECK(regmap.peek(parts::kCs35l41PwrCtrl1) & parts::kCs35l41GlobalEn);
+    /* The snapshot is used once. */
+    CHECK(amp.device.resume() == -ENODATA);
+}
+
+void testResumePowerLost()
+{
+    Cs35l41 amp;
+    std::vector<uint8_t> image = makeWmfw({pattern(12, 1)});
+    WmfwFile wmfw;
+
+    CHECK(wmfw.parse(viewOf(image)) == 0);
+    CHECK(amp.device.powerUp() == 0);
+    CHECK(amp.device.dsp().loadFirmware(wmfw) == 0);
+
+    /* DSP memory survives a plain suspend, so the download is kept. */
+    CHECK(amp.device.suspend() == 0);
+    CHECK(amp.device.resume() == 0);
+    CHECK(amp.device.dsp().firmwareResident(wmfw));
+
+    CHECK(amp.device.suspend() == 0);
+    CHECK(amp.device.resume(true) == 0);
+    CHECK(!amp.device.dsp().firmwareResident(wmfw));
+}
+
+const TestCase kTests[] = {
+        {"power_up", testPowerUp},
+        {"power_down", testPowerDown},
+        {"power_up_bus_error", testPowerUpBusError},
+        {"suspend_resume", testSuspendResume},
+        {"resume_power_lost", testResumePowerLost},
+};
+
+} // namespace
+
+const TestSuite kDeviceTests("device", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,155 @@
+#include "cirrus/hal/dsp.h"
+
+#include <iterator>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+constexpr uint32_t kHaloXm = 0x02800000;
+constexpr uint32_t kAdsp2Xm = 0x00190000;
+/* ADSP2 parts address DSP memory in 16-bit units: 2 per 32-bit word. */
+constexpr unsigned kAdsp2Stride = 2;
+
+const std::vector<DspRegion> kAdsp2Regions = {
+        {wmfw::kAdsp2Zm, 0x00180000}, {wmfw::kAdsp2Xm, kAdsp2Xm}, {wmfw::kAdsp2Ym, 0x001a8000}};
+
+std::vector<DspRegion> haloRegions()
+{
+    return {std::begin(parts::kHaloRegions), std::end(parts::kHaloRegions)};
+}
+
+void pokeWords(SimRegmap &regmap, uint32_t reg, const uint32_t *words, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        regmap.poke(regmap.advance(reg, i * 4), words[i]);
+}
+
+void testHaloAlgorithms()
+{
+    SimRegmap regmap;
+    Dsp dsp(regmap, wmfw::kCoreHalo, haloRegions(), "halo");
+    const uint32_t header[] = {0x400000, 0x030000, 0x00000002, 0x40000a, 0x010203,
+                               0x000000, 0x001000, 0x000000,   0x001000, 2};
+    /* id, version, xm base, xm size, ym base, ym size */
+    const uint32_t algs[] = {0x1000, 0x010000, 0x100, 0x40, 0x200, 0x40,
+                             0x2000, 0x020000, 0x300, 0x40, 0x400, 0x40};
+    uint32_t reg;
+
+    pokeWords(regmap, kHaloXm, header, std::size(header));
+    pokeWords(regmap, kHaloXm + sizeof(header), algs, std::size(algs));
+
+    CHECK(dsp.readAlgorithms() == 0);
+    CHECK(dsp.firmwareId() == 0x40000a);
+    CHECK(dsp.algorithms().size() == 2);
+
+    const DspAlgorithm *alg = dsp.findAlgorithm(0x2000);
+    CHECK(alg != nullptr);
+    if (alg) {
+        CHECK(alg->version == 0x020000);
+        CHECK(alg->xmBase == 0x300);
+        CHECK(alg->ymBase == 0x400);
+    }
+    CHECK(dsp.findAlgorithm(0x3000) == nullptr);
+
+    BinBlock blk = {wmfw::kHaloXmPacked, 0, 0x1000, 0, 0, {}};
+    CHECK(dsp.blockToReg(blk, &reg) == 0);
+    CHECK(reg == ((0x02000000 + 0x100 * 3) & ~3u));
+}
+
+void testAdsp2Algorithms()
+{
+    SimRegmap regmap({}, kAdsp2Stride);
+    Dsp dsp(regmap, wmfw::kCoreAdsp2, kAdsp2Regions, "adsp2");
+    const uint32_t header[] = {0x200000, 0x000001, 0x5f003, 0x010000, 0x10, 0x20, 0x30, 1};
+    /* id, version, zm base, xm base, ym base */
+    const uint32_t algs[] = {0x3000, 0x010200, 0x11, 0x22, 0x33};
+    uint32_t reg;
+
+    pokeWords(regmap, kAdsp2Xm, header, std::size(header));
+    pokeWords(regmap, regmap.advance(kAdsp2Xm, sizeof(header)), algs, std::size(algs));
+
+    CHECK(dsp.readAlgorithms() == 0);
+    CHECK(dsp.firmwareId() == 0x5f003);
+    CHECK(dsp.algorithms().size() == 1);
+
+    const DspAlgorithm *alg = dsp.findAlgorithm(0x3000);
+    CHECK(alg != nullptr);
+    if (alg) {
+        CHECK(alg->version == 0x010200);
+        CHECK(alg->zmBase == 0x11);
+        CHECK(alg->xmBase == 0x22);
+        CHECK(alg->ymBase == 0x33);
+    }
+
+    BinBlock blk = {wmfw::kAdsp2Ym, 4, 0x3000, 0, 0, {}};
+    CHECK(dsp.blockToReg(blk, &reg) == 0);
+    CHECK(reg == 0x001a8000 + 0x33 * 2 + 4);
+}
+
+void testAdsp2Download()
+{
+    SimRegmap regmap({}, kAdsp2Stride);
+    Dsp dsp(regmap, wmfw::kCoreAdsp2, kAdsp2Regions, "adsp2");
+    std::vector<uint8_t> first = pattern(8, 1), second = pattern(12, 2);
+    std::vector<uint8_t> image = makeWmfw({first, second}, wmfw::kCoreAdsp2);
+    WmfwFile wmfw;
+
+    CHECK(wmfw.parse(viewOf(image)) == 0);
+    CHECK(dsp.loadFirmware(wmfw) == 0);
+
+    /* Back-to-back regions coalesce at the ADSP2 stride. */
+    CHECK(regmap.transactions() == 1);
+    CHECK(regmap.peek(kAdsp2Xm) == readBe32(&first[0]));
+    CHECK(regmap.peek(kAdsp2Xm + 2) == readBe32(&first[4]));
+    CHECK(regmap.peek(kAdsp2Xm + 4) == readBe32(&second[0]));
+    CHECK(regmap.peek(kAdsp2Xm + 8) == readBe32(&second[8]));
+}
+
+void testAdsp2Overlap()
+{
+    SimRegmap regmap({}, kAdsp2Stride);
+    Dsp dsp(regmap, wmfw::kCoreAdsp2, kAdsp2Regions, "adsp2");
+    /* Two words at 0x10: registers 0x10 and 0x12. */
+    std::vector<uint8_t> wide = makeBin({{0x10, pattern(8, 1)}});
+    std::vector<uint8_t> after = makeBin({{0x14, pattern(4, 2)}});
+    std::vector<uint8_t> inside = makeBin({{0x12, pattern(4, 3)}});
+    BinFile wideBin, afterBin, insideBin;
+    size_t written;
+
+    CHECK(wideBin.parse(viewOf(wide)) == 0);
+    CHECK(afterBin.parse(viewOf(after)) == 0);
+    CHECK(insideBin.parse(viewOf(inside)) == 0);
+
+    /* A block just past the first leaves it known, so it is skipped. */
+    CHECK(dsp.loadCoefficients(wideBin) == 0);
+    CHECK(dsp.loadCoefficients(afterBin) == 0);
+    written = regmap.bytesWritten();
+    CHECK(dsp.loadCoefficients(wideBin) == 0);
+    CHECK(regmap.bytesWritten() == written);
+
+    /* One over its second word does not. */
+    CHECK(dsp.loadCoefficients(insideBin) == 0);
+    written = regmap.bytesWritten();
+    CHECK(dsp.loadCoefficients(wideBin) == 0);
+    CHECK(regmap.bytesWritten() == written + 8);
+    CHECK(regmap.peek(0x12) == readBe32(&pattern(8, 1)[4]));
+}
+
+const TestCase kTests[] = {
+        {"halo_algorithms", testHaloAlgorithms},
+        {"adsp2_algorithms", testAdsp2Algorithms},
+        {"adsp2_download", testAdsp2Download},
+        {"adsp2_overlap", testAdsp2Overlap},
+};
+
+} // namespace
+
+const TestSuite kDspTests("dsp", kTests);
+
+} // namespace cirrus::hal::test
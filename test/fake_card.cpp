@@ -0,0 +1,466 @@
+#include "fake_card.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <set>
+#include <sound/asound.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace cirrus::hal::test {
+
+namespace {
+
+/* Guards the active card and PCM and the fds opened on them. */
+std::mutex gCardLock;
+FakeCard *gCard;
+std::set<int> gCardFds;
+FakePcm *gPcm;
+std::set<int> gPcmFds;
+std::map<std::string, std::string> gRedirects;
+std::map<std::string, std::function<void()>> gOpenHooks;
+
+bool isCardPath(const char *path)
+{
+    char expect[32];
+
+    snprintf(expect, sizeof(expect), "/dev/snd/controlC%u", FakeCard::kCard);
+    return strcmp(path, expect) == 0;
+}
+
+bool isPcmPath(const char *path)
+{
+    char expect[32];
+
+    snprintf(expect, sizeof(expect), "/dev/snd/pcmC%uD0c", FakeCard::kCard);
+    return strcmp(path, expect) == 0;
+}
+
+unsigned hwParam(const struct snd_pcm_hw_params *params, int param)
+{
+    return params->intervals[param - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].max;
+}
+
+} // namespace
+
+FakeCard::FakeCard()
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+    gCard = this;
+}
+
+FakeCard::~FakeCard()
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+    gCard = nullptr;
+}
+
+FakeCard::Element *FakeCard::find(uint32_t numid)
+{
+    auto it = mElements.find(numid);
+    return it == mElements.end() ? nullptr : &it->second;
+}
+
+const FakeCard::Element *FakeCard::find(uint32_t numid) const
+{
+    auto it = mElements.find(numid);
+    return it == mElements.end() ? nullptr : &it->second;
+}
+
+uint32_t FakeCard::add(const std::string &name, int type, uint32_t count, uint32_t access)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    Element &e = mElements[mNextNumid];
+
+    e.name = name;
+    e.type = type;
+    e.count = count;
+    e.access = access | SNDRV_CTL_ELEM_ACCESS_READWRITE;
+    if (type == SNDRV_CTL_ELEM_TYPE_BYTES)
+        e.bytes.assign(count, 0);
+    else
+        e.values.assign(count, 0);
+
+    return mNextNumid++;
+}
+
+void FakeCard::remove(uint32_t numid)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mElements.erase(numid);
+}
+
+ControlInfo FakeCard::info(uint32_t numid) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    const Element *e = find(numid);
+
+    return e ? ControlInfo{numid, e->type, e->count, e->access} : ControlInfo{};
+}
+
+std::vector<long> FakeCard::values(uint32_t numid) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    const Element *e = find(numid);
+
+    return e ? e->values : std::vector<long>();
+}
+
+void FakeCard::setValues(uint32_t numid, const std::vector<long> &values)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (Element *e = find(numid))
+        e->values = values;
+}
+
+std::vector<uint8_t> FakeCard::bytes(uint32_t numid) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    const Element *e = find(numid);
+
+    return e ? e->bytes : std::vector<uint8_t>();
+}
+
+void FakeCard::setBytes(uint32_t numid, const std::vector<uint8_t> &bytes)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (Element *e = find(numid))
+        e->bytes = bytes;
+}
+
+size_t FakeCard::reads(uint32_t numid) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    const Element *e = find(numid);
+
+    return e ? e->reads : 0;
+}
+
+size_t FakeCard::writes(uint32_t numid) const
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    const Element *e = find(numid);
+
+    return e ? e->writes : 0;
+}
+
+void FakeCard::failReads(uint32_t numid, int err)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (Element *e = find(numid))
+        e->readErr = err;
+}
+
+void FakeCard::failWrites(uint32_t numid, int err)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (Element *e = find(numid))
+        e->writeErr = err;
+}
+
+int FakeCard::ioctl(unsigned long request, void *arg)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (request == SNDRV_CTL_IOCTL_ELEM_LIST) {
+        auto *list = static_cast<struct snd_ctl_elem_list *>(arg);
+        unsigned used = 0;
+
+        for (const auto &[numid, e] : mElements) {
+            if (used == list->space)
+                break;
+
+            struct snd_ctl_elem_id &id = list->pids[used++];
+            memset(&id, 0, sizeof(id));
+            id.numid = numid;
+            id.iface = SNDRV_CTL_ELEM_IFACE_MIXER;
+            snprintf(reinterpret_cast<char *>(id.name), sizeof(id.name), "%s", e.name.c_str());
+        }
+        list->used = used;
+        list->count = mElements.size();
+        return 0;
+    }
+
+    if (request == SNDRV_CTL_IOCTL_ELEM_INFO) {
+        auto *info = static_cast<struct snd_ctl_elem_info *>(arg);
+        const Element *e = find(info->id.numid);
+
+        if (!e)
+            return ENOENT;
+        snprintf(reinterpret_cast<char *>(info->id.name), sizeof(info->id.name), "%s",
+                 e->name.c_str());
+        info->type = e->type;
+        info->count = e->count;
+        info->access = e->access;
+        return 0;
+    }
+
+    if (request == SNDRV_CTL_IOCTL_ELEM_READ || request == SNDRV_CTL_IOCTL_ELEM_WRITE) {
+        auto *ev = static_cast<struct snd_ctl_elem_value *>(arg);
+        bool write = request == SNDRV_CTL_IOCTL_ELEM_WRITE;
+        Element *e = find(ev->id.numid);
+
+        if (!e)
+            return ENOENT;
+        (write ? e->writes : e->reads)++;
+        if (write ? e->writeErr : e->readErr)
+            return write ? e->writeErr : e->readErr;
+
+        for (uint32_t i = 0; i < e->count; i++) {
+            if (e->type == SNDRV_CTL_ELEM_TYPE_BYTES) {
+                if (write)
+                    e->bytes[i] = ev->value.bytes.data[i];
+                else
+                    ev->value.bytes.data[i] = e->bytes[i];
+            } else if (e->type == SNDRV_CTL_ELEM_TYPE_ENUMERATED) {
+                if (write)
+                    e->values[i] = ev->value.enumerated.item[i];
+                else
+                    ev->value.enumerated.item[i] = e->values[i];
+            } else {
+                if (write)
+                    e->values[i] = ev->value.integer.value[i];
+                else
+                    ev->value.integer.value[i] = e->values[i];
+            }
+        }
+        return 0;
+    }
+
+    if (request == SNDRV_CTL_IOCTL_TLV_READ || request == SNDRV_CTL_IOCTL_TLV_WRITE) {
+        auto *tlv = static_cast<struct snd_ctl_tlv *>(arg);
+        bool write = request == SNDRV_CTL_IOCTL_TLV_WRITE;
+        Element *e = find(tlv->numid);
+
+        if (!e)
+            return ENOENT;
+        if (!(e->access & SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE) || tlv->length > e->bytes.size())
+            return EINVAL;
+        (write ? e->writes : e->reads)++;
+        if (write ? e->writeErr : e->readErr)
+            return write ? e->writeErr : e->readErr;
+
+        /* A TLV write replaces the whole control, however short. */
+        if (write) {
+            std::fill(e->bytes.begin(), e->bytes.end(), 0);
+            memcpy(e->bytes.data(), tlv->tlv, tlv->length);
+        } else {
+            memcpy(tlv->tlv, e->bytes.data(), tlv->length);
+        }
+        return 0;
+    }
+
+    return ENOTTY;
+}
+
+FakePcm::FakePcm()
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+    gPcm = this;
+}
+
+FakePcm::~FakePcm()
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+    gPcm = nullptr;
+}
+
+void FakePcm::setBoundary(size_t boundary)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mBoundary = boundary;
+}
+
+void FakePcm::setHwPtr(size_t hwPtr)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+    mHwPtr = hwPtr;
+}
+
+int FakePcm::ioctl(unsigned long request, void *arg)
+{
+    std::lock_guard<std::mutex> guard(mLock);
+
+    if (request == SNDRV_PCM_IOCTL_HW_PARAMS) {
+        auto *params = static_cast<struct snd_pcm_hw_params *>(arg);
+
+        /* Accept whatever was asked for. */
+        mBufferFrames = hwParam(params, SNDRV_PCM_HW_PARAM_PERIOD_SIZE) *
+                        hwParam(params, SNDRV_PCM_HW_PARAM_PERIODS);
+        return 0;
+    }
+
+    if (request == SNDRV_PCM_IOCTL_SW_PARAMS) {
+        auto *params = static_cast<struct snd_pcm_sw_params *>(arg);
+
+        params->boundary = mBoundary ? mBoundary : mBufferFrames * 1024;
+        return 0;
+    }
+
+    if (request == SNDRV_PCM_IOCTL_SYNC_PTR) {
+        auto *sync = static_cast<struct snd_pcm_sync_ptr *>(arg);
+
+        sync->s.status.hw_ptr = mHwPtr;
+        return 0;
+    }
+
+    if (request == SNDRV_PCM_IOCTL_PREPARE || request == SNDRV_PCM_IOCTL_START ||
+        request == SNDRV_PCM_IOCTL_DROP)
+        return 0;
+
+    return ENOTTY;
+}
+
+void redirectOpen(const std::string &path, const std::string &target)
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+
+    if (target.empty())
+        gRedirects.erase(path);
+    else
+        gRedirects[path] = target;
+}
+
+void afterOpen(const std::string &path, std::function<void()> hook)
+{
+    std::lock_guard<std::mutex> guard(gCardLock);
+
+    if (hook)
+        gOpenHooks[path] = std::move(hook);
+    else
+        gOpenHooks.erase(path);
+}
+
+} // namespace cirrus::hal::test
+
+using cirrus::hal::test::gCard;
+using cirrus::hal::test::gCardFds;
+using cirrus::hal::test::gCardLock;
+using cirrus::hal::test::gOpenHooks;
+using cirrus::hal::test::gPcm;
+using cirrus::hal::test::gPcmFds;
+using cirrus::hal::test::gRedirects;
+
+extern "C" int open(const char *path, int flags, ...)
+{
+    std::function<void()> after;
+    mode_t mode = 0;
+    int fd;
+
+    if ((flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE) {
+        va_list ap;
+
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(gCardLock);
+
+        if (gCard && cirrus::hal::test::isCardPath(path)) {
+            fd = syscall(SYS_openat, AT_FDCWD, "/dev/null", O_RDWR | O_CLOEXEC);
+            if (fd >= 0)
+                gCardFds.insert(fd);
+            return fd;
+        }
+
+        if (gPcm && cirrus::hal::test::isPcmPath(path)) {
+            fd = syscall(SYS_openat, AT_FDCWD, "/dev/null", O_RDWR | O_CLOEXEC);
+            if (fd >= 0)
+                gPcmFds.insert(fd);
+            return fd;
+        }
+
+        auto it = gRedirects.find(path);
+        if (it != gRedirects.end())
+            return syscall(SYS_openat, AT_FDCWD, it->second.c_str(), flags, mode);
+
+        auto hook = gOpenHooks.find(path);
+        if (hook != gOpenHooks.end())
+            after = hook->second;
+    }
+
+    fd = syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+    if (fd >= 0 && after)
+        after();
+    return fd;
+}
+
+extern "C" int close(int fd)
+{
+    {
+        std::lock_guard<std::mutex> guard(gCardLock);
+        gCardFds.erase(fd);
+        gPcmFds.erase(fd);
+    }
+
+    return syscall(SYS_close, fd);
+}
+
+extern "C" int ioctl(int fd, unsigned long request, ...) noexcept
+{
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    {
+        std::lock_guard<std::mutex> guard(gCardLock);
+
+        if (gCardFds.count(fd)) {
+            int err = gCard ? gCard->ioctl(request, arg) : ENODEV;
+            if (err) {
+                errno = err;
+                return -1;
+            }
+            return 0;
+        }
+
+        if (gPcmFds.count(fd)) {
+            int err = gPcm ? gPcm->ioctl(request, arg) : ENODEV;
+            if (err) {
+                errno = err;
+                return -1;
+            }
+            return 0;
+        }
+    }
+
+    return syscall(SYS_ioctl, fd, request, arg);
+}
+
+/*
+ * The PCM's DMA buffer is plain anonymous memory. Its status and control
+ * pages cannot be mapped, so positions come from SYNC_PTR.
+ */
+extern "C" void *mmap(void *addr, size_t len, int prot, int flags, int fd, off_t offset) noexcept
+{
+    {
+        std::lock_guard<std::mutex> guard(gCardLock);
+
+        if (gPcmFds.count(fd)) {
+            if (offset != 0) {
+                errno = ENXIO;
+                return MAP_FAILED;
+            }
+            fd = -1;
+            flags = MAP_PRIVATE | MAP_ANONYMOUS;
+            prot |= PROT_WRITE;
+        }
+    }
+
+    return reinterpret_cast<void *>(syscall(SYS_mmap, addr, len, prot, flags, fd, offset));
+}
@@ -0,0 +1,113 @@
+/*
+ * ALSA devices for the Mixer and IvCapture tests.
+ *
+ * While a FakeCard exists, opening /dev/snd/controlC<kCard> gives an fd
+ * whose control ioctls are served from the card's element table instead
+ * of the kernel. Likewise, while a FakePcm exists, /dev/snd/pcmC<kCard>D0c
+ * is a capture stream whose hardware pointer the test moves by hand. The
+ * test binary interposes open(), ioctl(), mmap() and close() for this;
+ * every other fd passes straight through to the system calls.
+ * The same open() can also send other fixed paths, such as trace_marker,
+ * to a file the test controls.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cirrus/hal/control_table.h"
+
+namespace cirrus::hal::test {
+
+class FakeCard {
+public:
+    static constexpr unsigned kCard = 63;
+
+    FakeCard();
+    ~FakeCard();
+
+    FakeCard(const FakeCard &) = delete;
+    FakeCard &operator=(const FakeCard &) = delete;
+
+    /* Add an element and return its numid; numids are never reused. */
+    uint32_t add(const std::string &name, int type, uint32_t count, uint32_t access = 0);
+    void remove(uint32_t numid);
+    ControlInfo info(uint32_t numid) const;
+
+    /* Element values, bypassing the ioctls, e.g. for another client's write. */
+    std::vector<long> values(uint32_t numid) const;
+    void setValues(uint32_t numid, const std::vector<long> &values);
+    std::vector<uint8_t> bytes(uint32_t numid) const;
+    void setBytes(uint32_t numid, const std::vector<uint8_t> &bytes);
+
+    /* ELEM_READ/TLV_READ and ELEM_WRITE/TLV_WRITE calls on @numid, failed or not. */
+    size_t reads(uint32_t numid) const;
+    size_t writes(uint32_t numid) const;
+
+    /* Fail every read or write of @numid with @err (a positive errno); 0 stops. */
+    void failReads(uint32_t numid, int err);
+    void failWrites(uint32_t numid, int err);
+
+    /* Serve one control ioctl; returns 0 or a positive errno. */
+    int ioctl(unsigned long request, void *arg);
+
+private:
+    struct Element {
+        std::string name;
+        int type;
+        uint32_t count;
+        uint32_t access;
+        std::vector<long> values;
+        std::vector<uint8_t> bytes;
+        size_t reads = 0;
+        size_t writes = 0;
+        int readErr = 0;
+        int writeErr = 0;
+    };
+
+    Element *find(uint32_t numid);
+    const Element *find(uint32_t numid) const;
+
+    mutable std::mutex mLock;
+    std::map<uint32_t, Element> mElements;
+    uint32_t mNextNumid = 1;
+};
+
+class FakePcm {
+public:
+    FakePcm();
+    ~FakePcm();
+
+    FakePcm(const FakePcm &) = delete;
+    FakePcm &operator=(const FakePcm &) = delete;
+
+    /* Position wrap reported by SW_PARAMS; 0 picks 1024 buffers' worth. */
+    void setBoundary(size_t boundary);
+    /* Frames captured so far, as the kernel's hw_ptr. */
+    void setHwPtr(size_t hwPtr);
+
+    /* Serve one PCM ioctl; returns 0 or a positive errno. */
+    int ioctl(unsigned long request, void *arg);
+
+private:
+    mutable std::mutex mLock;
+    size_t mBufferFrames = 0;
+    size_t mBoundary = 0;
+    size_t mHwPtr = 0;
+};
+
+/* Open @target whenever @path is opened; an empty @target stops. */
+void redirectOpen(const std::string &path, const std::string &target);
+
+/*
+ * Call @hook on the opening thread each time @path has been opened, before
+ * open() returns; an empty @hook stops.
+ */
+void afterOpen(const std::string &path, std::function<void()> hook);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,161 @@
+#include "cirrus/hal/hal_core.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void addAmps(HalCore &core)
+{
+    CHECK(core.addDevice(std::make_unique<Device>(descriptorOf<Part::kCs35l41>(), "amp0",
+                                                  "i2c-0", std::make_unique<SimRegmap>())) == 0);
+    CHECK(core.addDevice(std::make_unique<Device>(descriptorOf<Part::kCs40l26>(), "haptics",
+                                                  "i2c-1", std::make_unique<SimRegmap>())) == 0);
+}
+
+/* Whether another thread would get @name from tryLock() right now. */
+bool freeElsewhere(const HalCore &core, const char *name)
+{
+    bool got = false;
+
+    std::thread([&core, &got, name] { got = static_cast<bool>(core.tryLock(name)); }).join();
+    return got;
+}
+
+void testRegistry()
+{
+    HalCore core;
+
+    addAmps(core);
+    CHECK((core.deviceNames() == std::vector<std::string>{"amp0", "haptics"}));
+    CHECK(core.addDevice(std::make_unique<Device>(descriptorOf<Part::kCs35l41>(), "amp0",
+                                                  "i2c-2", std::make_unique<SimRegmap>())) ==
+          -EEXIST);
+
+    CHECK(core.lock("amp0")->name() == "amp0");
+    CHECK(core.lockShared("haptics")->bus() == "i2c-1");
+    CHECK(!core.lock("missing"));
+    CHECK(!core.tryLock("missing"));
+    CHECK(!core.lockShared("missing"));
+
+    CHECK(core.removeDevice("missing") == -ENODEV);
+    CHECK(core.removeDevice("amp0") == 0);
+    CHECK(!core.lock("amp0"));
+    CHECK((core.deviceNames() == std::vector<std::string>{"haptics"}));
+}
+
+void testTryLock()
+{
+    HalCore core;
+
+    addAmps(core);
+    {
+        HalCore::DeviceLock amp = core.lock("amp0");
+
+        /* Held exclusively: others are turned away, other devices are not. */
+        CHECK(static_cast<bool>(amp));
+        CHECK(!freeElsewhere(core, "amp0"));
+        CHECK(freeElsewhere(core, "haptics"));
+    }
+    CHECK(freeElsewhere(core, "amp0"));
+
+    {
+        HalCore::DeviceReadLock reader = core.lockShared("amp0");
+
+        /* Shared holders also keep exclusive lockers out. */
+        CHECK(static_cast<bool>(reader));
+        CHECK(!freeElsewhere(core, "amp0"));
+    }
+    CHECK(freeElsewhere(core, "amp0"));
+}
+
+void testRemoveWaits()
+{
+    HalCore core;
+    std::atomic<bool> removed{false};
+
+    addAmps(core);
+    HalCore::DeviceLock amp = core.lock("amp0");
+    std::thread remover([&core, &removed] {
+        CHECK(core.removeDevice("amp0") == 0);
+        removed = true;
+    });
+
+    /* Unregistered at once, but not destroyed until the holder lets go. */
+    while (core.deviceNames().size() != 1)
+        std::this_thread::yield();
+    CHECK(!core.lock("amp0"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!removed);
+    CHECK(amp->name() == "amp0");
+
+    amp = HalCore::DeviceLock();
+    remover.join();
+    CHECK(removed);
+}
+
+void testSubmit()
+{
+    HalCore core;
+    BusScheduler scheduler;
+    std::mutex lock;
+    std::condition_variable cond;
+    bool blocked = true;
+    int ran = 0;
+
+    addAmps(core);
+    auto count = [&ran](Device &) {
+        ran++;
+        return 0;
+    };
+
+    CHECK(core.submit(scheduler, "missing", count) == -ENODEV);
+
+    CHECK(core.submit(scheduler, "amp0", [&ran](Device &device) {
+        ran++;
+        return device.regmap().write(0x100, 1);
+    }) == 0);
+    CHECK(scheduler.wait() == 0);
+    CHECK(ran == 1);
+
+    /* Hold the bus so the next job is still queued when amp0 goes away. */
+    scheduler.submit("i2c-0", [&] {
+        std::unique_lock<std::mutex> guard(lock);
+        cond.wait(guard, [&blocked] { return !blocked; });
+        return 0;
+    });
+    CHECK(core.submit(scheduler, "amp0", count) == 0);
+    CHECK(core.removeDevice("amp0") == 0);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        blocked = false;
+    }
+    cond.notify_all();
+
+    CHECK(scheduler.wait() == -ENODEV);
+    CHECK(ran == 1);
+}
+
+const TestCase kTests[] = {
+        {"registry", testRegistry},
+        {"try_lock", testTryLock},
+        {"remove_waits", testRemoveWaits},
+        {"submit", testSubmit},
+};
+
+} // namespace
+
+const TestSuite kHalCoreTests("hal_core", kTests);
+
+} // namespace cirrus::hal::test
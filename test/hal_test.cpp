@@ -0,0 +1,72 @@
+/*
+ * Behaviour tests for the HAL.
+ *
+ * Everything runs against SimRegmap and synthetic images built by the
+ * tests, so the results are deterministic and need no hardware. One
+ * "<suite>.<name> PASS|FAIL" line per test is written to test_output.txt
+ * (or the path given as the first argument); the exit status is non-zero
+ * if any check failed.
+ */
+#include <cstdio>
+#include <iterator>
+
+#include "test_util.h"
+
+using namespace cirrus::hal::test;
+
+namespace {
+
+const TestSuite *const kSuites[] = {
+        &kBulkWriterTests,
+        &kCoeffConvertTests,
+        &kContentHashTests,
+        &kControlShadowTests,
+        &kDeviceTests,
+        &kDspTests,
+        &kHalCoreTests,
+        &kHapticStreamTests,
+        &kIvCaptureTests,
+        &kLz4StreamTests,
+        &kMailboxTests,
+        &kMixerTests,
+        &kParamChannelTests,
+        &kRegisterSnapshotTests,
+        &kSimRegmapTests,
+        &kTraceTests,
+        &kTuningCacheTests,
+        &kTuningPrewarmTests,
+        &kWmfwTests,
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    FILE *out = fopen(argc > 1 ? argv[1] : "test_output.txt", "w");
+    int tests = 0, failed = 0;
+
+    if (!out) {
+        perror("test output");
+        return 1;
+    }
+
+    for (const TestSuite *suite : kSuites) {
+        for (size_t i = 0; i < suite->count; i++) {
+            const TestCase &test = suite->tests[i];
+            char name[64];
+            int before = failures();
+
+            test.run();
+            bool ok = failures() == before;
+            tests++;
+            failed += !ok;
+            snprintf(name, sizeof(name), "%s.%s", suite->name, test.name);
+            fprintf(out, "%s %s\n", name, ok ? "PASS" : "FAIL");
+            printf("%-40s %s\n", name, ok ? "PASS" : "FAIL");
+        }
+    }
+
+    fclose(out);
+    printf("%d tests, %d failed\n", tests, failed);
+    return failed ? 1 : 0;
+}
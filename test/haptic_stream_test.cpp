@@ -0,0 +1,115 @@
+#include "cirrus/hal/haptic_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+constexpr uint32_t kRing = 0x02800000;
+constexpr uint32_t kRingWords = 16;
+constexpr uint32_t kWriteIndex = 0x02800100;
+constexpr uint32_t kReadIndex = 0x02800104;
+constexpr uint32_t kControl = 0x02800108;
+
+const HapticStreamConfig kConfig = {kRing,  kRingWords, kWriteIndex, kReadIndex,
+                                    kControl, 1,        2,           1000000};
+
+/*
+ * Firmware that plays everything written so far each time the host
+ * polls its read index, logging the words in the order it played them.
+ */
+class PlayerSim : public SimRegmap {
+public:
+    int read(uint32_t reg, uint32_t *val) override
+    {
+        if (reg == kReadIndex) {
+            uint32_t to = peek(kWriteIndex);
+
+            for (; mRead != to; mRead = (mRead + 1) % kRingWords)
+                mPlayed.push_back(peek(kRing + mRead * 4));
+            poke(kReadIndex, mRead);
+        }
+        return SimRegmap::read(reg, val);
+    }
+
+    const std::vector<uint32_t> &played() const { return mPlayed; }
+    void reserve(size_t words) { mPlayed.reserve(words); }
+
+private:
+    uint32_t mRead = 0;
+    std::vector<uint32_t> mPlayed;
+};
+
+void testStream()
+{
+    PlayerSim regmap;
+    HapticStream stream(regmap, kConfig, 4);
+    std::vector<int32_t> wave(400);
+    size_t pos = 0;
+
+    for (size_t i = 0; i < wave.size(); i++)
+        wave[i] = static_cast<int32_t>(i * 0x10101) - 0x100000;
+    regmap.reserve(wave.size());
+
+    CHECK(stream.play([&](int32_t *words, size_t max) {
+        size_t n = std::min(max, wave.size() - pos);
+
+        std::copy(&wave[pos], &wave[pos] + n, words);
+        pos += n;
+        return n;
+    }) == 0);
+    CHECK(regmap.peek(kControl) == 1);
+
+    /* The feeder's refills run without allocating. */
+    size_t allocations = test::allocations();
+    while (stream.active())
+        std::this_thread::yield();
+    CHECK(test::allocations() == allocations);
+
+    /* Let the firmware play out the last refill. */
+    uint32_t readIndex;
+    CHECK(regmap.read(kReadIndex, &readIndex) == 0);
+    CHECK(stream.stop() == 0);
+    CHECK(regmap.peek(kControl) == 2);
+
+    /* Every word went through the ring in order, as 24-bit samples. */
+    CHECK(regmap.played().size() == wave.size());
+    for (size_t i = 0; i < std::min(wave.size(), regmap.played().size()); i++)
+        CHECK(regmap.played()[i] == (static_cast<uint32_t>(wave[i]) & 0xffffff));
+}
+
+void testZeroRate()
+{
+    SimRegmap regmap;
+    HapticStreamConfig config = kConfig;
+    bool called = false;
+
+    config.rate = 0;
+    HapticStream stream(regmap, config, 4);
+
+    CHECK(stream.play([&](int32_t *, size_t) {
+        called = true;
+        return size_t(0);
+    }) == -EINVAL);
+    CHECK(!called);
+    CHECK(!stream.active());
+    CHECK(regmap.transactions() == 0);
+}
+
+const TestCase kTests[] = {
+        {"stream", testStream},
+        {"zero_rate", testZeroRate},
+};
+
+} // namespace
+
+const TestSuite kHapticStreamTests("haptic_stream", kTests);
+
+} // namespace cirrus::hal::test
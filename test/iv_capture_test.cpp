@@ -0,0 +1,124 @@
+#include "cirrus/hal/iv_capture.h"
+
+#include "fake_card.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+constexpr size_t kPeriod = 64;
+constexpr size_t kBuffer = kPeriod * 4;
+/* The most a reader may trail by: the DMA is filling the next period. */
+constexpr size_t kLimit = kBuffer - kPeriod;
+
+const IvCaptureConfig kConfig = {FakeCard::kCard, 0, 2, 48000, IvCaptureConfig::kS16,
+                                 kPeriod,         4};
+
+void testOpen()
+{
+    FakePcm pcm;
+    IvCapture capture;
+
+    CHECK(capture.open(kConfig) == 0);
+    CHECK(capture.frameBytes() == 4);
+    CHECK(capture.bufferFrames() == kBuffer);
+    CHECK(capture.boundary() == kBuffer * 1024);
+    CHECK(capture.start() == 0);
+
+    pcm.setHwPtr(kBuffer + 5);
+    CHECK(capture.position() == kBuffer + 5);
+    CHECK(capture.frame(kBuffer + 5) == capture.frame(5));
+    CHECK(capture.frame(1) == capture.frame(0) + 4);
+    CHECK(capture.stop() == 0);
+}
+
+void testOverrunLimit()
+{
+    FakePcm pcm;
+    IvCapture capture;
+    const uint8_t *data;
+
+    CHECK(capture.open(kConfig) == 0);
+    IvReader reader(capture);
+
+    /* Trailing by exactly the limit is still safe. */
+    pcm.setHwPtr(kLimit);
+    CHECK(reader.available() == kLimit);
+    CHECK(reader.acquire(&data) == kLimit);
+    CHECK(data == capture.frame(0));
+    CHECK(reader.release(kLimit));
+    CHECK(reader.overruns() == 0);
+
+    /* One frame more and the oldest is being overwritten. */
+    pcm.setHwPtr(kLimit + kLimit + 1);
+    CHECK(reader.available() == kLimit);
+    CHECK(reader.acquire(&data) == kPeriod);
+    CHECK(reader.overruns() == 1);
+    CHECK(data == capture.frame(kLimit + kLimit + 1 - kPeriod));
+    CHECK(reader.release(kPeriod));
+    CHECK(reader.available() == 0);
+}
+
+void testReleaseOverrun()
+{
+    FakePcm pcm;
+    IvCapture capture;
+    const uint8_t *data;
+
+    CHECK(capture.open(kConfig) == 0);
+    IvReader reader(capture);
+
+    pcm.setHwPtr(10);
+    CHECK(reader.acquire(&data) == 10);
+
+    /* The DMA passed the held frames before they were consumed. */
+    pcm.setHwPtr(kLimit + 1);
+    CHECK(!reader.release(10));
+    CHECK(reader.overruns() == 1);
+    CHECK(reader.available() == kPeriod);
+
+    /* At the limit, a release still succeeds. */
+    CHECK(reader.acquire(&data) == kPeriod);
+    pcm.setHwPtr(kLimit + 1 - kPeriod + kLimit);
+    CHECK(reader.release(kPeriod));
+    CHECK(reader.overruns() == 1);
+}
+
+void testWrap()
+{
+    FakePcm pcm;
+    IvCapture capture;
+    const uint8_t *data;
+
+    /* A small boundary, so positions wrap within the test. */
+    pcm.setBoundary(kBuffer * 2);
+    pcm.setHwPtr(kBuffer * 2 - 20);
+    CHECK(capture.open(kConfig) == 0);
+    IvReader reader(capture);
+
+    /* Frames up to the end of the buffer, then the part that wraps. */
+    pcm.setHwPtr(30);
+    CHECK(reader.available() == 50);
+    CHECK(reader.acquire(&data) == 20);
+    CHECK(data == capture.frame(kBuffer - 20));
+    CHECK(reader.release(20));
+    CHECK(reader.acquire(&data) == 30);
+    CHECK(data == capture.frame(0));
+    CHECK(reader.release(30));
+    CHECK(reader.available() == 0);
+    CHECK(reader.overruns() == 0);
+}
+
+const TestCase kTests[] = {
+        {"open", testOpen},
+        {"overrun_limit", testOverrunLimit},
+        {"release_overrun", testReleaseOverrun},
+        {"wrap", testWrap},
+};
+
+} // namespace
+
+const TestSuite kIvCaptureTests("iv_capture", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,216 @@
+#include "cirrus/hal/lz4_stream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iterator>
+
+#include "cirrus/hal/byte_order.h"
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/device_descriptor.h"
+#include "cirrus/hal/dsp.h"
+#include "cirrus/hal/sim_regmap.h"
+#include "cirrus/hal/wmfw.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+const std::vector<DspRegion> kHaloRegions(std::begin(parts::kHaloRegions),
+                                           std::end(parts::kHaloRegions));
+
+struct Lz4Block {
+    std::vector<uint8_t> data;
+    bool compressed;
+};
+
+constexpr uint8_t kLz4Linked = 0x40;
+constexpr uint8_t kLz4Independent = 0x60;
+constexpr uint8_t kLz4BlockChecksum = 0x10;
+constexpr uint8_t kLz4ContentChecksum = 0x04;
+
+/* An LZ4 frame with 64 KiB maximum blocks; @content feeds the checksum. */
+std::vector<uint8_t> lz4Frame(uint8_t flg, const std::vector<Lz4Block> &blocks,
+                              const std::vector<uint8_t> &content)
+{
+    std::vector<uint8_t> f = {0x04, 0x22, 0x4d, 0x18, flg, 0x40};
+
+    f.push_back((xxh32({&f[4], 2}) >> 8) & 0xff);
+
+    for (const Lz4Block &block : blocks) {
+        size_t pos = f.size();
+
+        f.resize(pos + 4);
+        writeLe32(&f[pos], static_cast<uint32_t>(block.data.size()) |
+                                   (block.compressed ? 0 : 0x80000000u));
+        f.insert(f.end(), block.data.begin(), block.data.end());
+        if (flg & kLz4BlockChecksum) {
+            pos = f.size();
+            f.resize(pos + 4);
+            writeLe32(&f[pos], xxh32(viewOf(block.data)));
+        }
+    }
+
+    f.resize(f.size() + 4, 0);
+    if (flg & kLz4ContentChecksum) {
+        size_t pos = f.size();
+
+        f.resize(pos + 4);
+        writeLe32(&f[pos], xxh32(viewOf(content)));
+    }
+
+    return f;
+}
+
+/* @data as uncompressed blocks of @blockSize, so block edges split headers. */
+std::vector<uint8_t> lz4Stored(const std::vector<uint8_t> &data, size_t blockSize)
+{
+    std::vector<Lz4Block> blocks;
+
+    for (size_t pos = 0; pos < data.size(); pos += blockSize) {
+        size_t len = std::min(blockSize, data.size() - pos);
+        blocks.push_back({{data.begin() + pos, data.begin() + pos + len}, false});
+    }
+
+    return lz4Frame(kLz4Independent | kLz4ContentChecksum, blocks, data);
+}
+
+int readAll(Lz4Stream &stream, std::vector<uint8_t> *out)
+{
+    uint8_t buf[5];
+    int ret;
+
+    out->clear();
+    while ((ret = stream.read(buf, sizeof(buf))) > 0)
+        out->insert(out->end(), buf, buf + ret);
+    return ret;
+}
+
+std::vector<uint8_t> dump(SimRegmap &regmap, uint32_t reg, size_t words)
+{
+    std::vector<uint8_t> out(words * 4);
+
+    for (size_t i = 0; i < words; i++)
+        writeBe32(&out[i * 4], regmap.peek(reg + i * 4));
+    return out;
+}
+
+void testLz4Blocks()
+{
+    Lz4Stream stream;
+    std::vector<uint8_t> out;
+
+    /* "ab", then a 10 byte match at offset 2 that overlaps itself, then "c". */
+    std::vector<uint8_t> overlap = {0x26, 'a', 'b', 0x02, 0x00, 0x10, 'c'};
+    std::vector<uint8_t> expect = {'a', 'b', 'a', 'b', 'a', 'b', 'a',
+                                   'b', 'a', 'b', 'a', 'b', 'c'};
+    std::vector<uint8_t> frame = lz4Frame(kLz4Independent | kLz4ContentChecksum,
+                                          {{overlap, true}}, expect);
+
+    CHECK(stream.parse(viewOf(frame)) == 0);
+    CHECK(readAll(stream, &out) == 0);
+    CHECK(out == expect);
+    CHECK(stream.position() == expect.size());
+
+    /* The second block of a linked frame copies from the first. */
+    std::vector<uint8_t> first = pattern(12, 9);
+    std::vector<uint8_t> linked = {0x08, 0x0c, 0x00};
+    std::vector<uint8_t> content = first;
+    content.insert(content.end(), first.begin(), first.end());
+    frame = lz4Frame(kLz4Linked | kLz4ContentChecksum | kLz4BlockChecksum,
+                     {{first, false}, {linked, true}}, content);
+
+    CHECK(stream.parse(viewOf(frame)) == 0);
+    CHECK(readAll(stream, &out) == 0);
+    CHECK(out == content);
+
+    /* The same block in an independent frame reaches before its start. */
+    frame = lz4Frame(kLz4Independent, {{first, false}, {linked, true}}, content);
+    CHECK(stream.parse(viewOf(frame)) == 0);
+    CHECK(readAll(stream, &out) == -EINVAL);
+}
+
+void testLz4Corruption()
+{
+    std::vector<uint8_t> content = pattern(64, 5);
+    std::vector<uint8_t> frame =
+            lz4Frame(kLz4Independent | kLz4BlockChecksum | kLz4ContentChecksum,
+                     {{content, false}}, content);
+    std::vector<uint8_t> bad, out;
+    Lz4Stream stream;
+
+    CHECK(stream.parse(viewOf(frame)) == 0);
+    CHECK(readAll(stream, &out) == 0);
+    CHECK(out == content);
+
+    bad = frame;
+    bad[5] ^= 0x10;
+    CHECK(stream.parse(viewOf(bad)) < 0);
+
+    bad = frame;
+    bad[6] ^= 0xff;
+    CHECK(stream.parse(viewOf(bad)) == -EBADMSG);
+
+    /* A flipped payload byte fails the block checksum before it is used. */
+    bad = frame;
+    bad[7 + 4 + 10] ^= 1;
+    CHECK(stream.parse(viewOf(bad)) == 0);
+    CHECK(readAll(stream, &out) == -EBADMSG);
+    CHECK(out.empty());
+
+    bad = frame;
+    bad.back() ^= 1;
+    CHECK(stream.parse(viewOf(bad)) == 0);
+    CHECK(readAll(stream, &out) == -EBADMSG);
+
+    bad.assign(frame.begin(), frame.begin() + 7 + 4 + 20);
+    CHECK(stream.parse(viewOf(bad)) == 0);
+    CHECK(readAll(stream, &out) == -EINVAL);
+
+    bad.assign(frame.begin(), frame.begin() + 5);
+    CHECK(stream.parse(viewOf(bad)) == -EINVAL);
+}
+
+void testLz4Download()
+{
+    std::vector<uint8_t> image = makeWmfw({pattern(96, 1), pattern(48, 2), pattern(36, 3)});
+    std::vector<uint8_t> binImage = makeBin({{0x100, pattern(8, 6)}, {0x120, pattern(12, 7)}});
+    SimRegmap plainMap, streamMap;
+    Dsp plain(plainMap, wmfw::kCoreHalo, kHaloRegions, "plain");
+    Dsp streamed(streamMap, wmfw::kCoreHalo, kHaloRegions, "streamed");
+    WmfwFile wmfw;
+    BinFile bin;
+    Lz4Stream stream;
+
+    CHECK(wmfw.parse(viewOf(image)) == 0);
+    CHECK(plain.loadFirmware(wmfw) == 0);
+    CHECK(bin.parse(viewOf(binImage)) == 0);
+    CHECK(plain.loadCoefficients(bin) == 0);
+
+    /* Odd block sizes split region headers and words across blocks. */
+    std::vector<uint8_t> frame = lz4Stored(image, 7);
+    CHECK(stream.parse(viewOf(frame)) == 0);
+    CHECK(!streamed.firmwareResident(stream));
+    CHECK(streamed.loadFirmware(stream) == 0);
+    CHECK(streamed.firmwareResident(stream));
+
+    std::vector<uint8_t> binFrame = lz4Stored(binImage, 5);
+    CHECK(stream.parse(viewOf(binFrame)) == 0);
+    CHECK(streamed.loadCoefficients(stream) == 0);
+
+    CHECK(dump(streamMap, 0x02000000, 48) == dump(plainMap, 0x02000000, 48));
+    CHECK(dump(streamMap, 0x100, 12) == dump(plainMap, 0x100, 12));
+    CHECK(plainMap.peek(0x100) != 0);
+}
+
+const TestCase kTests[] = {
+        {"blocks", testLz4Blocks},
+        {"corruption", testLz4Corruption},
+        {"download", testLz4Download},
+};
+
+} // namespace
+
+const TestSuite kLz4StreamTests("lz4_stream", kTests);
+
+} // namespace cirrus::hal::test
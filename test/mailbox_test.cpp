@@ -0,0 +1,157 @@
+#include "cirrus/hal/mailbox.h"
+
+#include <cerrno>
+#include <vector>
+
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+constexpr uint32_t kQueue = 0x02900000;
+constexpr uint32_t kQueueWords = 8;
+constexpr uint32_t kWriteIndex = 0x02900100;
+constexpr uint32_t kReadIndex = 0x02900104;
+constexpr uint32_t kMailbox = 0x02900108;
+
+const MailboxConfig kQueueConfig = {kQueue, kQueueWords, kWriteIndex, kReadIndex,
+                                    kMailbox, 1,         1000};
+const MailboxConfig kRegisterConfig = {0, 0, 0, 0, kMailbox, 0, 300};
+
+/* Single-register firmware: logs each command and, if acking, clears it. */
+class RegisterSim : public SimRegmap {
+public:
+    int write(uint32_t reg, uint32_t val) override
+    {
+        int ret = SimRegmap::write(reg, val);
+
+        if (ret == 0 && reg == kMailbox)
+            mCommands.push_back(val);
+        return ret;
+    }
+
+    int read(uint32_t reg, uint32_t *val) override
+    {
+        if (reg == kMailbox && mAck)
+            poke(kMailbox, 0);
+        return SimRegmap::read(reg, val);
+    }
+
+    void setAck(bool ack) { mAck = ack; }
+    const std::vector<uint32_t> &commands() const { return mCommands; }
+
+private:
+    bool mAck = true;
+    std::vector<uint32_t> mCommands;
+};
+
+void testQueue()
+{
+    SimRegmap regmap;
+    Mailbox mailbox(regmap, kQueueConfig);
+
+    for (uint32_t cmd : {0x11u, 0x22u, 0x33u})
+        mailbox.post(cmd);
+    CHECK(mailbox.flush() == 0);
+    CHECK(mailbox.pending() == 0);
+    CHECK(regmap.peek(kQueue) == 0x11);
+    CHECK(regmap.peek(kQueue + 4) == 0x22);
+    CHECK(regmap.peek(kQueue + 8) == 0x33);
+    CHECK(regmap.peek(kWriteIndex) == 3);
+    CHECK(regmap.peek(kMailbox) == 1);
+
+    /* The firmware catches up; the next batch wraps around the ring. */
+    regmap.poke(kReadIndex, 3);
+    for (uint32_t cmd = 0x40; cmd < 0x46; cmd++)
+        mailbox.post(cmd);
+    CHECK(mailbox.flush() == 0);
+    CHECK(regmap.peek(kQueue + 7 * 4) == 0x44);
+    CHECK(regmap.peek(kQueue) == 0x45);
+    CHECK(regmap.peek(kWriteIndex) == 1);
+}
+
+void testQueueFull()
+{
+    SimRegmap regmap;
+    Mailbox mailbox(regmap, kQueueConfig);
+
+    /* One slot always stays free, so only 7 of 10 fit before a timeout. */
+    for (uint32_t cmd = 1; cmd <= 10; cmd++)
+        mailbox.post(cmd);
+    CHECK(mailbox.flush() == -ETIMEDOUT);
+    CHECK(mailbox.pending() == 3);
+    CHECK(regmap.peek(kWriteIndex) == 7);
+
+    /* Unsent commands go out once there is room, after the sent ones. */
+    regmap.poke(kReadIndex, 7);
+    CHECK(mailbox.flush() == 0);
+    CHECK(mailbox.pending() == 0);
+    CHECK(regmap.peek(kQueue + 7 * 4) == 8);
+    CHECK(regmap.peek(kQueue) == 9);
+    CHECK(regmap.peek(kQueue + 4) == 10);
+    CHECK(regmap.peek(kWriteIndex) == 2);
+}
+
+void testRegister()
+{
+    RegisterSim regmap;
+    Mailbox mailbox(regmap, kRegisterConfig);
+
+    mailbox.post(0xa);
+    mailbox.post(0xb);
+    CHECK(mailbox.flush() == 0);
+    CHECK(mailbox.pending() == 0);
+    CHECK((regmap.commands() == std::vector<uint32_t>{0xa, 0xb}));
+}
+
+void testRegisterTimeout()
+{
+    RegisterSim regmap;
+    Mailbox mailbox(regmap, kRegisterConfig);
+
+    /* A command the firmware never acks is dropped, never replayed. */
+    regmap.setAck(false);
+    mailbox.post(0xa);
+    mailbox.post(0xb);
+    CHECK(mailbox.flush() == -ETIMEDOUT);
+    CHECK(mailbox.pending() == 1);
+    CHECK((regmap.commands() == std::vector<uint32_t>{0xa}));
+
+    regmap.setAck(true);
+    CHECK(mailbox.flush() == 0);
+    CHECK(mailbox.pending() == 0);
+    CHECK((regmap.commands() == std::vector<uint32_t>{0xa, 0xb}));
+}
+
+void testRegisterWriteFailure()
+{
+    RegisterSim regmap;
+    Mailbox mailbox(regmap, kRegisterConfig);
+
+    /* A command that never reached the mailbox stays queued. */
+    regmap.failRange(kMailbox, kMailbox);
+    mailbox.post(0xa);
+    CHECK(mailbox.flush() == -EIO);
+    CHECK(mailbox.pending() == 1);
+    CHECK(regmap.commands().empty());
+
+    regmap.clearFailures();
+    CHECK(mailbox.flush() == 0);
+    CHECK((regmap.commands() == std::vector<uint32_t>{0xa}));
+}
+
+const TestCase kTests[] = {
+        {"queue", testQueue},
+        {"queue_full", testQueueFull},
+        {"register", testRegister},
+        {"register_timeout", testRegisterTimeout},
+        {"register_write_failure", testRegisterWriteFailure},
+};
+
+} // namespace
+
+const TestSuite kMailboxTests("mailbox", kTests);
+
+} // namespace cirrus::hal::test
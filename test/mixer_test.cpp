@@ -0,0 +1,119 @@
+#include "cirrus/hal/mixer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <sound/asound.h>
+
+#include "fake_card.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void testLookup()
+{
+    FakeCard card;
+    uint32_t gain = card.add("AMP PCM Gain", SNDRV_CTL_ELEM_TYPE_INTEGER, 1);
+    Mixer mixer;
+
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    const ControlInfo *ctl = mixer.find("AMP PCM Gain");
+    CHECK(ctl && ctl->numid == gain && ctl->count == 1);
+    CHECK(mixer.find("DSP1 Firmware") == nullptr);
+
+    /* Controls added by a firmware load appear after refresh(). */
+    card.add("DSP1 Firmware", SNDRV_CTL_ELEM_TYPE_ENUMERATED, 1);
+    CHECK(mixer.find("DSP1 Firmware") == nullptr);
+    CHECK(mixer.refresh() == 0);
+    CHECK(mixer.find("DSP1 Firmware") != nullptr);
+
+    CHECK(mixer.set("AMP PCM Gain", 17) == 0);
+    CHECK(card.values(gain) == std::vector<long>({17}));
+    CHECK(mixer.set("Nonexistent", 1) == -ENOENT);
+}
+
+void testPartialValues()
+{
+    FakeCard card;
+    uint32_t numid = card.add("Volume", SNDRV_CTL_ELEM_TYPE_INTEGER, 3);
+    Mixer mixer;
+    long values[3] = {1, 2, 3};
+    long out[3];
+
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    ControlInfo ctl = card.info(numid);
+
+    /* A full write needs no read first. */
+    CHECK(mixer.setValues(ctl, values, 3) == 0);
+    CHECK(card.reads(numid) == 0);
+
+    /* Someone else changes the last element... */
+    card.setValues(numid, {1, 2, 30});
+
+    /* ...and a write of the first element keeps it. */
+    values[0] = 10;
+    CHECK(mixer.setValues(ctl, values, 1) == 0);
+    CHECK(card.values(numid) == std::vector<long>({10, 2, 30}));
+    CHECK(mixer.getValues(ctl, out, 3) == 0);
+    CHECK(out[0] == 10 && out[1] == 2 && out[2] == 30);
+
+    /* A partial write that cannot read the rest writes nothing. */
+    card.failReads(numid, EIO);
+    size_t writes = card.writes(numid);
+    CHECK(mixer.setValues(ctl, values, 2) == -EIO);
+    CHECK(card.writes(numid) == writes);
+    CHECK(card.values(numid) == std::vector<long>({10, 2, 30}));
+
+    CHECK(mixer.setValues(ctl, values, 4) == -EINVAL);
+}
+
+void testPartialBytes()
+{
+    FakeCard card;
+    uint32_t numid = card.add("DSP1 Coeffs", SNDRV_CTL_ELEM_TYPE_BYTES, 8);
+    Mixer mixer;
+    const uint8_t head[] = {0xaa, 0xbb};
+
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    ControlInfo ctl = card.info(numid);
+
+    card.setBytes(numid, {1, 2, 3, 4, 5, 6, 7, 8});
+    CHECK(mixer.setBytes(ctl, head, sizeof(head)) == 0);
+    CHECK(card.bytes(numid) == std::vector<uint8_t>({0xaa, 0xbb, 3, 4, 5, 6, 7, 8}));
+
+    card.failReads(numid, EIO);
+    CHECK(mixer.setBytes(ctl, head, sizeof(head)) == -EIO);
+    CHECK(card.writes(numid) == 1);
+}
+
+void testTlvBytes()
+{
+    FakeCard card;
+    uint32_t numid = card.add("DSP1 Cal", SNDRV_CTL_ELEM_TYPE_BYTES, 16,
+                              SNDRV_CTL_ELEM_ACCESS_TLV_READWRITE);
+    Mixer mixer;
+    const uint8_t data[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    uint8_t back[16] = {};
+
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    ControlInfo ctl = card.info(numid);
+
+    CHECK(mixer.setBytes(ctl, data, sizeof(data)) == 0);
+    CHECK(mixer.getBytes(ctl, back, sizeof(back)) == 0);
+    CHECK(memcmp(back, data, sizeof(back)) == 0);
+    CHECK(mixer.setBytes(ctl, data, 17) == -EINVAL);
+}
+
+const TestCase kTests[] = {
+        {"lookup", testLookup},
+        {"partial_values", testPartialValues},
+        {"partial_bytes", testPartialBytes},
+        {"tlv_bytes", testTlvBytes},
+};
+
+} // namespace
+
+const TestSuite kMixerTests("mixer", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,102 @@
+#include "cirrus/hal/param_channel.h"
+
+#include <sound/asound.h>
+#include <thread>
+
+#include "fake_card.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+/* Wait for the control thread to try reading @numid @count times. */
+void waitForReads(const FakeCard &card, uint32_t numid, size_t count)
+{
+    while (card.reads(numid) < count)
+        std::this_thread::yield();
+}
+
+void testPartialUpdate()
+{
+    FakeCard card;
+    uint32_t numid = card.add("AMP Gains", SNDRV_CTL_ELEM_TYPE_INTEGER, 4);
+    ControlInfo ctl = card.info(numid);
+    ParamChannel channel;
+    Mixer mixer;
+
+    card.setValues(numid, {1, 2, 3, 4});
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    CHECK(channel.start(mixer) == 0);
+
+    CHECK(channel.setValue(ctl, 10, 1));
+
+    /* Another client writes the control between two updates. */
+    while (card.writes(numid) < 1)
+        std::this_thread::yield();
+    card.setValues(numid, {5, 10, 7, 8});
+
+    CHECK(channel.setValue(ctl, 20, 0));
+    channel.stop();
+
+    CHECK(card.values(numid) == std::vector<long>({20, 10, 7, 8}));
+}
+
+void testPartialWord()
+{
+    FakeCard card;
+    uint32_t numid = card.add("DSP1 Coeffs", SNDRV_CTL_ELEM_TYPE_BYTES, 8);
+    ControlInfo ctl = card.info(numid);
+    ParamChannel channel;
+    Mixer mixer;
+
+    card.setBytes(numid, {1, 2, 3, 4, 5, 6, 7, 8});
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    CHECK(channel.start(mixer) == 0);
+    CHECK(channel.setWord(ctl, 0x11223344, 1));
+    /* Out of range, and the wrong kind for a byte control. */
+    CHECK(channel.setWord(ctl, 0, 2));
+    CHECK(channel.setValue(ctl, 0, 0));
+    channel.stop();
+
+    CHECK(card.bytes(numid) == std::vector<uint8_t>({1, 2, 3, 4, 0x11, 0x22, 0x33, 0x44}));
+}
+
+void testReadFailure()
+{
+    FakeCard card;
+    uint32_t numid = card.add("AMP Gains", SNDRV_CTL_ELEM_TYPE_INTEGER, 3);
+    ControlInfo ctl = card.info(numid);
+    ParamChannel channel;
+    Mixer mixer;
+
+    card.setValues(numid, {1, 2, 3});
+    CHECK(mixer.open(FakeCard::kCard) == 0);
+    size_t reads = card.reads(numid);
+    CHECK(channel.start(mixer) == 0);
+
+    /* Without a read-back the update is dropped, not merged with zeros. */
+    card.failReads(numid, EIO);
+    CHECK(channel.setValue(ctl, 10, 0));
+    waitForReads(card, numid, reads + 1);
+    card.failReads(numid, 0);
+
+    /* The next update reads again. */
+    CHECK(channel.setValue(ctl, 30, 2));
+    channel.stop();
+
+    CHECK(card.writes(numid) == 1);
+    CHECK(card.values(numid) == std::vector<long>({1, 2, 30}));
+}
+
+const TestCase kTests[] = {
+        {"partial_update", testPartialUpdate},
+        {"partial_word", testPartialWord},
+        {"read_failure", testReadFailure},
+};
+
+} // namespace
+
+const TestSuite kParamChannelTests("param_channel", kTests);
+
+} // namespace cirrus::hal::test
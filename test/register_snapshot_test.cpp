@@ -0,0 +1,89 @@
+#include "cirrus/hal/register_snapshot.h"
+
+#include <cerrno>
+
+#include "cirrus/hal/sim_regmap.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void testSnapshotCapture()
+{
+    static constexpr RegDefault kDefaults[] = {
+            {0x100, 0}, {0x104, 1}, {0x108, 2}, {0x10c, 3},
+            {0x110, 4}, {0x114, 5}, {0x200, 7},
+    };
+    SimRegmap regmap;
+    RegisterSnapshot snapshot;
+
+    for (const RegDefault &r : kDefaults)
+        regmap.poke(r.reg, r.val);
+
+    CHECK(snapshot.captureRegisters(regmap, kDefaults) == 0);
+    CHECK(snapshot.empty());
+
+    /* Two defaults between changes are filled; three split the run. */
+    regmap.poke(0x100, 9);
+    regmap.poke(0x10c, 9);
+    regmap.poke(0x200, 8);
+    CHECK(snapshot.captureRegisters(regmap, kDefaults) == 0);
+    CHECK(snapshot.runs() == 2);
+    CHECK(snapshot.bytes() == 20);
+
+    snapshot.clear();
+    regmap.poke(0x10c, 3);
+    regmap.poke(0x110, 9);
+    CHECK(snapshot.captureRegisters(regmap, kDefaults) == 0);
+    CHECK(snapshot.runs() == 3);
+    CHECK(snapshot.bytes() == 12);
+
+    CHECK(snapshot.captureRange(regmap, 0x300, 6) == -EINVAL);
+}
+
+void testSnapshotRestore()
+{
+    static constexpr RegDefault kDefaults[] = {
+            {0x100, 0}, {0x104, 1}, {0x108, 2}, {0x10c, 3}, {0x200, 7},
+    };
+    SimRegmap regmap;
+    RegisterSnapshot snapshot;
+
+    for (const RegDefault &r : kDefaults)
+        regmap.poke(r.reg, r.val);
+    regmap.poke(0x100, 0x11);
+    regmap.poke(0x10c, 0x22);
+    regmap.poke(0x200, 0x33);
+    regmap.poke(0x204, 0x44);
+    regmap.poke(0x208, 0x55);
+
+    CHECK(snapshot.captureRegisters(regmap, kDefaults) == 0);
+    CHECK(snapshot.captureRange(regmap, 0x204, 8) == 0);
+
+    for (const RegDefault &r : kDefaults)
+        regmap.poke(r.reg, r.val);
+    regmap.poke(0x204, 0);
+    regmap.poke(0x208, 0);
+    regmap.resetStats();
+
+    /* The range continues the 0x200 run, so it goes out with it. */
+    CHECK(snapshot.restore(regmap) == 0);
+    CHECK(regmap.transactions() == 2);
+    CHECK(regmap.peek(0x100) == 0x11);
+    CHECK(regmap.peek(0x104) == 1);
+    CHECK(regmap.peek(0x10c) == 0x22);
+    CHECK(regmap.peek(0x200) == 0x33);
+    CHECK(regmap.peek(0x208) == 0x55);
+}
+
+const TestCase kTests[] = {
+        {"capture", testSnapshotCapture},
+        {"restore", testSnapshotRestore},
+};
+
+} // namespace
+
+const TestSuite kRegisterSnapshotTests("register_snapshot", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,179 @@
+#include "cirrus/hal/sim_regmap.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void testReadBack()
+{
+    SimRegmap regmap;
+    uint8_t burst[8] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+    uint8_t back[8] = {};
+    uint32_t val = 0;
+
+    CHECK(regmap.write(0x100, 0x12345678) == 0);
+    CHECK(regmap.read(0x100, &val) == 0);
+    CHECK(val == 0x12345678);
+
+    /* Raw transfers are big-endian words at consecutive registers. */
+    CHECK(regmap.rawWrite(0x3ffc, burst, sizeof(burst)) == 0);
+    CHECK(regmap.peek(0x3ffc) == 0x01020304);
+    CHECK(regmap.peek(0x4000) == 0x05060708);
+    CHECK(regmap.rawRead(0x3ffc, back, sizeof(back)) == 0);
+    CHECK(memcmp(back, burst, sizeof(burst)) == 0);
+
+    CHECK(regmap.peek(0x8000) == 0);
+    regmap.clear();
+    CHECK(regmap.peek(0x100) == 0);
+}
+
+void testBurstLimits()
+{
+    SimBusConfig config;
+    config.maxBurst = 16;
+    SimRegmap regmap(config);
+    uint8_t buf[20] = {};
+
+    CHECK(regmap.maxRawWrite() == 16);
+    CHECK(regmap.rawWrite(0x100, buf, 16) == 0);
+    CHECK(regmap.rawWrite(0x100, buf, 20) == -EINVAL);
+    CHECK(regmap.rawRead(0x100, buf, 20) == -EINVAL);
+    CHECK(regmap.rawWrite(0x102, buf, 4) == -EINVAL);
+    CHECK(regmap.rawWrite(0x100, buf, 6) == -EINVAL);
+    CHECK(regmap.rawWrite(0x100, buf, 0) == -EINVAL);
+
+    /* Rejected bursts never reach the bus. */
+    CHECK(regmap.transactions() == 1);
+    CHECK(regmap.bytesWritten() == 16);
+}
+
+void testFailTransaction()
+{
+    SimRegmap regmap;
+    uint32_t val;
+
+    CHECK(regmap.write(0x100, 1) == 0);
+    regmap.failTransaction(2, -ETIMEDOUT);
+    CHECK(regmap.write(0x100, 2) == 0);
+    CHECK(regmap.write(0x100, 3) == -ETIMEDOUT);
+    CHECK(regmap.peek(0x100) == 2);
+    /* One-shot: the next transaction goes through. */
+    CHECK(regmap.read(0x100, &val) == 0);
+
+    /* The count survives resetStats() and still runs from the call. */
+    regmap.failTransaction(3);
+    CHECK(regmap.write(0x104, 1) == 0);
+    regmap.resetStats();
+    CHECK(regmap.write(0x104, 2) == 0);
+    CHECK(regmap.write(0x104, 3) == -EIO);
+    CHECK(regmap.write(0x104, 4) == 0);
+
+    regmap.failTransaction(1);
+    regmap.clearFailures();
+    CHECK(regmap.write(0x104, 5) == 0);
+}
+
+void testFailRange()
+{
+    SimRegmap regmap;
+    uint8_t buf[16] = {};
+    uint32_t val;
+
+    regmap.failRange(0x208, 0x20c, -EREMOTEIO);
+    CHECK(regmap.write(0x204, 1) == 0);
+    CHECK(regmap.read(0x208, &val) == -EREMOTEIO);
+    CHECK(regmap.write(0x210, 1) == 0);
+    /* A burst overlapping the range by one register fails whole. */
+    CHECK(regmap.rawWrite(0x1fc, buf, 16) == -EREMOTEIO);
+    CHECK(regmap.rawWrite(0x1f8, buf, 16) == 0);
+    CHECK(regmap.rawWrite(0x1fc, buf, 12) == 0);
+
+    regmap.clearFailures();
+    CHECK(regmap.read(0x208, &val) == 0);
+}
+
+void testStats()
+{
+    SimBusConfig config;
+    config.transactionNs = 1000;
+    config.byteNs = 10;
+    SimRegmap regmap(config);
+    uint8_t buf[32] = {};
+    uint32_t val;
+
+    CHECK(regmap.write(0x100, 1) == 0);
+    CHECK(regmap.rawWrite(0x200, buf, 32) == 0);
+    CHECK(regmap.read(0x100, &val) == 0);
+    CHECK(regmap.rawRead(0x200, buf, 16) == 0);
+
+    CHECK(regmap.transactions() == 4);
+    CHECK(regmap.bytesWritten() == 36);
+    CHECK(regmap.bytesRead() == 20);
+    CHECK(regmap.busNs() == 4 * 1000 + 56 * 10);
+
+    /* Failed transfers still occupy the bus but move no data. */
+    regmap.failTransaction(1);
+    CHECK(regmap.write(0x100, 2) == -EIO);
+    CHECK(regmap.transactions() == 5);
+    CHECK(regmap.bytesWritten() == 36);
+    CHECK(regmap.busNs() == 5 * 1000 + 60 * 10);
+
+    /* Poking is free. */
+    regmap.poke(0x300, 1);
+    CHECK(regmap.peek(0x300) == 1);
+    CHECK(regmap.transactions() == 5);
+
+    regmap.resetStats();
+    CHECK(regmap.transactions() == 0);
+    CHECK(regmap.bytesWritten() == 0);
+    CHECK(regmap.bytesRead() == 0);
+    CHECK(regmap.busNs() == 0);
+    CHECK(regmap.peek(0x100) == 1);
+}
+
+void testRealTimeUnlocked()
+{
+    SimBusConfig config;
+    config.transactionNs = 200000000;
+    config.realTime = true;
+    SimRegmap regmap(config);
+    std::atomic<bool> done{false};
+
+    std::thread writer([&] {
+        regmap.write(0x100, 1);
+        done = true;
+    });
+
+    /* The transfer is accounted before the bus time is spent... */
+    while (regmap.transactions() == 0)
+        std::this_thread::yield();
+    /* ...and neither that nor peek() waits for it. */
+    regmap.peek(0x100);
+    CHECK(!done);
+
+    writer.join();
+    CHECK(regmap.peek(0x100) == 1);
+    CHECK(regmap.busNs() == 200000000);
+}
+
+const TestCase kTests[] = {
+        {"read_back", testReadBack},
+        {"burst_limits", testBurstLimits},
+        {"fail_transaction", testFailTransaction},
+        {"fail_range", testFailRange},
+        {"stats", testStats},
+        {"real_time_unlocked", testRealTimeUnlocked},
+};
+
+} // namespace
+
+const TestSuite kSimRegmapTests("sim_regmap", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,116 @@
+#include "test_util.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "cirrus/hal/byte_order.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+int gFailures;
+std::atomic<size_t> gAllocations;
+
+} // namespace
+
+bool check(bool ok, const char *expr, const char *file, int line)
+{
+    if (!ok) {
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+        gFailures++;
+    }
+    return ok;
+}
+
+int failures()
+{
+    return gFailures;
+}
+
+size_t allocations()
+{
+    return gAllocations.load();
+}
+
+std::vector<uint8_t> pattern(size_t len, uint8_t seed)
+{
+    std::vector<uint8_t> data(len);
+
+    for (size_t i = 0; i < len; i++)
+        data[i] = static_cast<uint8_t>(seed + i * 7);
+    return data;
+}
+
+std::vector<uint8_t> makeWmfw(const std::vector<std::vector<uint8_t>> &payloads, uint8_t core)
+{
+    bool halo = core == wmfw::kCoreHalo;
+    std::vector<uint8_t> f(40, 0);
+    uint32_t offset = 0;
+
+    memcpy(f.data(), "WMFW", 4);
+    writeLe32(&f[4], 40);
+    f[10] = core;
+    f[11] = 3;
+
+    for (const std::vector<uint8_t> &payload : payloads) {
+        size_t pos = f.size();
+
+        f.resize(pos + 8);
+        writeLe32(&f[pos], offset);
+        f[pos + 3] = halo ? wmfw::kHaloXmPacked : wmfw::kAdsp2Xm;
+        writeLe32(&f[pos + 4], static_cast<uint32_t>(payload.size()));
+        f.insert(f.end(), payload.begin(), payload.end());
+        offset += static_cast<uint32_t>(payload.size() / (halo ? 3 : 4));
+    }
+
+    return f;
+}
+
+std::vector<uint8_t> makeBin(const std::vector<std::pair<uint16_t, std::vector<uint8_t>>> &blocks)
+{
+    std::vector<uint8_t> f(12, 0);
+
+    memcpy(f.data(), "WMDR", 4);
+    writeLe32(&f[4], 12);
+    f[11] = 2;
+
+    for (const auto &block : blocks) {
+        size_t pos = f.size();
+
+        f.resize(pos + 20, 0);
+        writeLe16(&f[pos], block.first);
+        writeLe16(&f[pos + 2], wmfw::kAbsolute << 8);
+        writeLe32(&f[pos + 4], 0x1234);
+        writeLe32(&f[pos + 8], 0x050600);
+        writeLe32(&f[pos + 16], static_cast<uint32_t>(block.second.size()));
+        f.insert(f.end(), block.second.begin(), block.second.end());
+        /* Payloads are padded to a word. */
+        f.resize((f.size() + 3) & ~size_t(3), 0);
+    }
+
+    return f;
+}
+
+} // namespace cirrus::hal::test
+
+void *operator new(size_t size)
+{
+    cirrus::hal::test::gAllocations++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
@@ -0,0 +1,83 @@
+/*
+ * Shared pieces of the behaviour tests: the CHECK macro, the suite table
+ * each <module>_test.cpp exports, and builders for synthetic images.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "cirrus/hal/mapped_file.h"
+#include "cirrus/hal/wmfw.h"
+
+namespace cirrus::hal::test {
+
+bool check(bool ok, const char *expr, const char *file, int line);
+
+#define CHECK(cond) ::cirrus::hal::test::check((cond), #cond, __FILE__, __LINE__)
+
+/* Failed checks since start-up. */
+int failures();
+
+/* Calls to the global operator new since start-up, from any thread. */
+size_t allocations();
+
+struct TestCase {
+    const char *name;
+    void (*run)();
+};
+
+struct TestSuite {
+    template <size_t N>
+    constexpr TestSuite(const char *name, const TestCase (&cases)[N])
+        : name(name), tests(cases), count(N)
+    {
+    }
+
+    const char *name;
+    const TestCase *tests;
+    size_t count;
+};
+
+/* One per module, defined in <module>_test.cpp. */
+extern const TestSuite kBulkWriterTests;
+extern const TestSuite kCoeffConvertTests;
+extern const TestSuite kContentHashTests;
+extern const TestSuite kControlShadowTests;
+extern const TestSuite kDeviceTests;
+extern const TestSuite kDspTests;
+extern const TestSuite kHalCoreTests;
+extern const TestSuite kHapticStreamTests;
+extern const TestSuite kIvCaptureTests;
+extern const TestSuite kLz4StreamTests;
+extern const TestSuite kMailboxTests;
+extern const TestSuite kMixerTests;
+extern const TestSuite kParamChannelTests;
+extern const TestSuite kRegisterSnapshotTests;
+extern const TestSuite kSimRegmapTests;
+extern const TestSuite kTraceTests;
+extern const TestSuite kTuningCacheTests;
+extern const TestSuite kTuningPrewarmTests;
+extern const TestSuite kWmfwTests;
+
+inline ByteView viewOf(const std::vector<uint8_t> &data)
+{
+    return {data.data(), data.size()};
+}
+
+/* @len bytes that differ from any other @seed's. */
+std::vector<uint8_t> pattern(size_t len, uint8_t seed);
+
+/*
+ * A version 3 .wmfw with one XM region per entry of @payloads, back to
+ * back: packed XM on Halo, unpacked XM on ADSP2.
+ */
+std::vector<uint8_t> makeWmfw(const std::vector<std::vector<uint8_t>> &payloads,
+                              uint8_t core = wmfw::kCoreHalo);
+
+/* A revision 2 .bin of absolute-addressed {register, payload} blocks. */
+std::vector<uint8_t> makeBin(const std::vector<std::pair<uint16_t, std::vector<uint8_t>>> &blocks);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,119 @@
+#include "cirrus/hal/trace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+#include "fake_card.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+const char *const kMarkerPaths[] = {
+        "/sys/kernel/tracing/trace_marker",
+        "/sys/kernel/debug/tracing/trace_marker",
+};
+
+std::string tempFile()
+{
+    char path[] = "/tmp/cirrus-trace-XXXXXX";
+    int fd = mkstemp(path);
+
+    if (fd < 0)
+        return "";
+    ::close(fd);
+    return path;
+}
+
+std::string contents(const std::string &path)
+{
+    std::string out;
+    char buf[256];
+    FILE *f = fopen(path.c_str(), "r");
+
+    if (!f)
+        return out;
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;)
+        out.append(buf, n);
+    fclose(f);
+    return out;
+}
+
+void testStats()
+{
+    traceReset();
+    traceRecord(TraceOp::kPowerUp, 1000);
+    traceRecord(TraceOp::kPowerUp, 1000);
+    traceRecord(TraceOp::kPowerUp, 1000);
+    traceRecord(TraceOp::kPowerUp, 5000);
+
+    TraceStats stats = traceStats(TraceOp::kPowerUp);
+    CHECK(stats.count == 4);
+    CHECK(stats.totalNs == 8000);
+    CHECK(stats.maxNs == 5000);
+    /* Percentiles report the upper bound of their power-of-two bucket. */
+    CHECK(stats.p50Ns == 1023);
+    CHECK(stats.p99Ns == 8191);
+
+    {
+        TraceScope scope(TraceOp::kPowerDown);
+    }
+    CHECK(traceStats(TraceOp::kPowerDown).count == 1);
+
+    traceReset();
+    CHECK(traceStats(TraceOp::kPowerUp).count == 0);
+    CHECK(traceStats(TraceOp::kPowerUp).maxNs == 0);
+    CHECK(traceStats(TraceOp::kPowerDown).count == 0);
+}
+
+void testMarkers()
+{
+    std::string marker = tempFile(), other = tempFile();
+    std::string pid = std::to_string(getpid());
+
+    CHECK(!marker.empty() && !other.empty());
+    for (const char *path : kMarkerPaths)
+        redirectOpen(path, marker);
+
+    int fd = -1;
+    {
+        CHECK(traceSetMarkers(true) == 0);
+        TraceScope scope(TraceOp::kPowerUp, "amp0");
+
+        /*
+         * Turning markers off mid-scope must still end the slice, and must
+         * not free the fd number for a file opened meanwhile.
+         */
+        CHECK(traceSetMarkers(false) == 0);
+        fd = open(other.c_str(), O_WRONLY | O_CLOEXEC);
+        CHECK(fd >= 0);
+
+        TraceScope quiet(TraceOp::kPowerDown);
+    }
+    if (fd >= 0)
+        ::close(fd);
+
+    CHECK(contents(marker) == "B|" + pid + "|cirrus:power_up amp0E|" + pid);
+    CHECK(contents(other).empty());
+
+    for (const char *path : kMarkerPaths)
+        redirectOpen(path, "");
+    unlink(marker.c_str());
+    unlink(other.c_str());
+    traceReset();
+}
+
+const TestCase kTests[] = {
+        {"stats", testStats},
+        {"markers", testMarkers},
+};
+
+} // namespace
+
+const TestSuite kTraceTests("trace", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,110 @@
+#include "cirrus/hal/tuning_cache.h"
+
+#include <cerrno>
+#include <string>
+#include <unistd.h>
+
+#include "cirrus/hal/content_hash.h"
+#include "cirrus/hal/file_util.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+const std::vector<uint8_t> kFirmware = makeWmfw({pattern(36, 1), pattern(24, 2)});
+const std::vector<uint8_t> kTuning = makeBin({{0x10, pattern(16, 3)}, {0x20, pattern(8, 4)}});
+
+/* A cache holding kFirmware as "fw" and kTuning as "tuning". */
+std::vector<uint8_t> makeCache()
+{
+    std::string base = "/tmp/cirrus-test-" + std::to_string(getpid());
+    std::string fwPath = base + ".wmfw", binPath = base + ".bin";
+    TuningCacheWriter writer;
+    std::vector<uint8_t> cache;
+
+    if (CHECK(writeFileAtomic(fwPath, kFirmware.data(), kFirmware.size()) == 0) &&
+        CHECK(writeFileAtomic(binPath, kTuning.data(), kTuning.size()) == 0) &&
+        CHECK(writer.addTuning("tuning", binPath) == 0) &&
+        CHECK(writer.addFirmware("fw", fwPath) == 0))
+        cache = writer.serialize();
+
+    unlink(fwPath.c_str());
+    unlink(binPath.c_str());
+    return cache;
+}
+
+void testLookup()
+{
+    std::vector<uint8_t> image = makeCache();
+    TuningCache cache;
+    TuningEntry entry;
+    WmfwFile wmfw;
+    BinFile bin;
+
+    CHECK(cache.parse(viewOf(image)) == 0);
+    CHECK(cache.size() == 2);
+
+    /* Sorted by name, whatever order they were added in. */
+    CHECK(cache.entry(0, &entry) == 0);
+    CHECK(entry.name == "fw");
+    CHECK(entry.kind == TuningEntry::kFirmware);
+    CHECK(entry.image.size == kFirmware.size());
+    CHECK(entry.hash == contentHash(viewOf(kFirmware)));
+    CHECK(cache.entry(2, &entry) == -EINVAL);
+
+    CHECK(cache.find("tuning", &entry) == 0);
+    CHECK(entry.kind == TuningEntry::kTuning);
+    CHECK(cache.find("missing", &entry) == -ENOENT);
+
+    CHECK(cache.firmware("fw", &wmfw) == 0);
+    CHECK(wmfw.hash() == contentHash(viewOf(kFirmware)));
+    CHECK(cache.tuning("tuning", &bin) == 0);
+    CHECK(cache.tuning("fw", &bin) == -EINVAL);
+    CHECK(cache.firmware("missing", &wmfw) == -ENOENT);
+}
+
+void testCorruptIndex()
+{
+    std::vector<uint8_t> image = makeCache();
+    TuningCache cache;
+
+    /* The first name byte is covered by the index hash. */
+    image[32 + 2 * 32] ^= 1;
+    CHECK(cache.parse(viewOf(image)) == -EINVAL);
+    CHECK(cache.size() == 0);
+
+    image[1] = 'X';
+    CHECK(cache.parse(viewOf(image)) == -EINVAL);
+}
+
+void testCorruptImage()
+{
+    std::vector<uint8_t> image = makeCache();
+    TuningCache cache;
+    TuningEntry entry;
+    WmfwFile wmfw;
+    BinFile bin;
+
+    CHECK(cache.parse(viewOf(image)) == 0);
+    CHECK(cache.find("tuning", &entry) == 0);
+
+    /* Images are not part of the index hash: the damage shows on bind. */
+    image[entry.image.data - image.data() + entry.image.size - 1] ^= 0x80;
+    CHECK(cache.parse(viewOf(image)) == 0);
+    CHECK(cache.tuning("tuning", &bin) == -EBADMSG);
+    CHECK(cache.tuning("tuning", &bin) == -EBADMSG);
+    CHECK(cache.firmware("fw", &wmfw) == 0);
+}
+
+const TestCase kTests[] = {
+        {"lookup", testLookup},
+        {"corrupt_index", testCorruptIndex},
+        {"corrupt_image", testCorruptImage},
+};
+
+} // namespace
+
+const TestSuite kTuningCacheTests("tuning_cache", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,144 @@
+#include "cirrus/hal/tuning_prewarm.h"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "cirrus/hal/file_util.h"
+#include "fake_card.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+std::string tuningPath(const char *name)
+{
+    return "/tmp/cirrus-test-" + std::to_string(getpid()) + "-" + name + ".bin";
+}
+
+bool writeTuning(const std::string &path, uint8_t seed)
+{
+    std::vector<uint8_t> bin = makeBin({{0x10, pattern(8, seed)}});
+
+    return writeFileAtomic(path, bin.data(), bin.size()) == 0;
+}
+
+bool hasPayload(const BinFile &bin, uint8_t seed)
+{
+    std::vector<uint8_t> want = pattern(8, seed);
+
+    return bin.blocks().size() == 1 && bin.blocks()[0].data.size == want.size() &&
+           memcmp(bin.blocks()[0].data.data, want.data(), want.size()) == 0;
+}
+
+void testHintTake()
+{
+    std::string hinted = tuningPath("hinted"), cold = tuningPath("cold");
+    std::shared_ptr<const BinFile> bin;
+    TuningPrewarmer prewarmer;
+
+    CHECK(writeTuning(hinted, 1));
+    CHECK(writeTuning(cold, 2));
+
+    prewarmer.hint(hinted);
+    CHECK(prewarmer.take(hinted, &bin) == 0);
+    CHECK(bin && hasPayload(*bin, 1));
+    CHECK(prewarmer.hits() == 1);
+
+    /* Never hinted: staged on the caller's thread, then kept. */
+    CHECK(prewarmer.take(cold, &bin) == 0);
+    CHECK(bin && hasPayload(*bin, 2));
+    CHECK(prewarmer.misses() == 1);
+    CHECK(prewarmer.take(cold, &bin) == 0);
+    CHECK(prewarmer.hits() == 2);
+
+    unlink(hinted.c_str());
+    unlink(cold.c_str());
+}
+
+void testStageFailure()
+{
+    std::string missing = tuningPath("missing");
+    std::shared_ptr<const BinFile> bin;
+    TuningPrewarmer prewarmer;
+
+    /* A failed staging is reported once, then retried from scratch. */
+    prewarmer.hint(missing);
+    CHECK(prewarmer.take(missing, &bin) == -ENOENT);
+    CHECK(prewarmer.hits() == 1);
+    CHECK(prewarmer.take(missing, &bin) == -ENOENT);
+    CHECK(prewarmer.misses() == 1);
+}
+
+void testDropDuringStaging()
+{
+    struct {
+        std::mutex lock;
+        std::condition_variable cond;
+        int opens = 0;
+        bool released = false;
+    } staging;
+    std::string path = tuningPath("replaced");
+    std::shared_ptr<const BinFile> bin;
+    TuningPrewarmer prewarmer;
+
+    CHECK(writeTuning(path, 1));
+
+    /*
+     * Hold the first staging after it has opened the old file. Slow the
+     * second one down, so a stale result would be what take() sees.
+     */
+    afterOpen(path, [&staging] {
+        std::unique_lock<std::mutex> lock(staging.lock);
+
+        if (++staging.opens == 1) {
+            staging.cond.notify_all();
+            staging.cond.wait_for(lock, std::chrono::seconds(5),
+                                  [&staging] { return staging.released; });
+        } else {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    });
+
+    prewarmer.hint(path);
+    {
+        std::unique_lock<std::mutex> lock(staging.lock);
+        CHECK(staging.cond.wait_for(lock, std::chrono::seconds(5),
+                                    [&staging] { return staging.opens == 1; }));
+    }
+
+    /* The file is replaced while its old contents are being staged. */
+    CHECK(writeTuning(path, 2));
+    prewarmer.drop(path);
+    prewarmer.hint(path);
+    {
+        std::lock_guard<std::mutex> lock(staging.lock);
+        staging.released = true;
+    }
+    staging.cond.notify_all();
+
+    CHECK(prewarmer.take(path, &bin) == 0);
+    CHECK(bin && hasPayload(*bin, 2));
+
+    afterOpen(path, {});
+    unlink(path.c_str());
+}
+
+const TestCase kTests[] = {
+        {"hint_take", testHintTake},
+        {"stage_failure", testStageFailure},
+        {"drop_during_staging", testDropDuringStaging},
+};
+
+} // namespace
+
+const TestSuite kTuningPrewarmTests("tuning_prewarm", kTests);
+
+} // namespace cirrus::hal::test
@@ -0,0 +1,118 @@
+#include "cirrus/hal/wmfw.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include "cirrus/hal/byte_order.h"
+#include "test_util.h"
+
+namespace cirrus::hal::test {
+
+namespace {
+
+void testWmfwParse()
+{
+    std::vector<uint8_t> image = makeWmfw({pattern(12, 1), pattern(6, 2)});
+    WmfwFile wmfw;
+
+    CHECK(wmfw.parse(viewOf(image)) == 0);
+    CHECK(wmfw.core() == wmfw::kCoreHalo);
+    CHECK(wmfw.version() == 3);
+    CHECK(wmfw.regions().size() == 2);
+    if (wmfw.regions().size() == 2) {
+        const WmfwRegion &second = wmfw.regions()[1];
+
+        CHECK(second.type == wmfw::kHaloXmPacked);
+        CHECK(second.offset == 4);
+        CHECK(second.data.size == 6);
+        /* Zero-copy: the payload points into the image. */
+        CHECK(second.data.data == &image[40 + 8 + 12 + 8]);
+        CHECK(memcmp(second.data.data, pattern(6, 2).data(), 6) == 0);
+    }
+}
+
+void testWmfwRejects()
+{
+    std::vector<uint8_t> image = makeWmfw({pattern(12, 1), pattern(6, 2)});
+    std::vector<uint8_t> bad;
+    WmfwFile wmfw;
+
+    bad = image;
+    memcpy(bad.data(), "WMFX", 4);
+    CHECK(wmfw.parse(viewOf(bad)) == -EINVAL);
+
+    bad = image;
+    bad[11] = 4;
+    CHECK(wmfw.parse(viewOf(bad)) == -EINVAL);
+
+    bad = image;
+    writeLe32(&bad[4], 36);
+    CHECK(wmfw.parse(viewOf(bad)) == -EINVAL);
+
+    /* The second region claims more data than the file holds. */
+    bad = image;
+    writeLe32(&bad[40 + 8 + 12 + 4], 7);
+    CHECK(wmfw.parse(viewOf(bad)) == -EINVAL);
+    CHECK(wmfw.regions().empty());
+
+    bad.assign(image.begin(), image.begin() + 20);
+    CHECK(wmfw.parse(viewOf(bad)) == -EINVAL);
+}
+
+void testBinParse()
+{
+    std::vector<uint8_t> image = makeBin({{0x100, pattern(6, 3)}, {0x200, pattern(8, 4)}});
+    BinFile bin;
+
+    CHECK(bin.parse(viewOf(image)) == 0);
+    CHECK(bin.revision() == 2);
+    CHECK(bin.blocks().size() == 2);
+    if (bin.blocks().size() == 2) {
+        const BinBlock &first = bin.blocks()[0];
+        const BinBlock &second = bin.blocks()[1];
+
+        CHECK(first.type == wmfw::kAbsolute << 8);
+        CHECK(first.offset == 0x100);
+        CHECK(first.algId == 0x1234);
+        CHECK(first.algVersion == 0x0506);
+        CHECK(first.data.size == 6);
+        /* The second block follows the first one's padding. */
+        CHECK(second.offset == 0x200);
+        CHECK(second.data.size == 8);
+        CHECK(memcmp(second.data.data, pattern(8, 4).data(), 8) == 0);
+    }
+    CHECK(bin.blockHashes().size() == 2);
+}
+
+void testBinRejects()
+{
+    std::vector<uint8_t> image = makeBin({{0x100, pattern(6, 3)}, {0x200, pattern(8, 4)}});
+    std::vector<uint8_t> bad;
+    BinFile bin;
+
+    bad = image;
+    memcpy(bad.data(), "WMFW", 4);
+    CHECK(bin.parse(viewOf(bad)) == -EINVAL);
+
+    bad = image;
+    bad[11] = 3;
+    CHECK(bin.parse(viewOf(bad)) == -EINVAL);
+
+    bad = image;
+    writeLe32(&bad[12 + 16], 0x1000);
+    CHECK(bin.parse(viewOf(bad)) == -EINVAL);
+    CHECK(bin.blocks().empty());
+}
+
+const TestCase kTests[] = {
+        {"wmfw_parse", testWmfwParse},
+        {"wmfw_rejects", testWmfwRejects},
+        {"bin_parse", testBinParse},
+        {"bin_rejects", testBinRejects},
+};
+
+} // namespace
+
+const TestSuite kWmfwTests("wmfw", kTests);
+
+} // namespace cirrus::hal::test